@@ -0,0 +1,501 @@
+/*                     B A T C H E X P O R T . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file BatchExport.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the headless image export implementation
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <brlcad/Database/MemoryDatabase.h>
+
+#include "BatchExport.h"
+#include "DisplayManager.h"
+#include "MemoryUsage.h"
+#include "Parallel.h"
+#include "PerformanceGate.h"
+#include "PlotGeometry.h"
+
+
+const size_t MaxDatabases  = 4; // loaded copies of the database, every one holds the whole file
+const size_t QueuedObjects = 2; // plotted objects per plotting thread waiting for the rendering
+
+
+// the databases of the plotting threads, a MemoryDatabase may not be used by two threads at once
+class DatabasePool {
+public:
+    DatabasePool(const QString& fileName,
+                 size_t         capacity) : m_fileName(fileName.toUtf8()), m_capacity(capacity), m_mutex(), m_available(), m_databases(), m_loaded(0) {}
+
+    // waits for a released database if there are as many as the capacity allows
+    std::unique_ptr<BRLCAD::MemoryDatabase> Acquire(void) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_available.wait(lock, [this]() {
+                return !m_databases.empty() || (m_loaded < m_capacity);
+            });
+
+            if (!m_databases.empty()) {
+                std::unique_ptr<BRLCAD::MemoryDatabase> ret = std::move(m_databases.back());
+
+                m_databases.pop_back();
+
+                return ret;
+            }
+
+            ++m_loaded;
+        }
+
+        std::unique_ptr<BRLCAD::MemoryDatabase> ret(new BRLCAD::MemoryDatabase);
+
+        if (!ret->Load(m_fileName.data())) {
+            ret.reset();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_loaded;
+            }
+
+            m_available.notify_one();
+        }
+
+        return ret;
+    }
+
+    void Release(std::unique_ptr<BRLCAD::MemoryDatabase> database) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_databases.push_back(std::move(database));
+        }
+
+        m_available.notify_one();
+    }
+
+    size_t Loaded(void) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_loaded;
+    }
+
+private:
+    QByteArray                                            m_fileName;
+    size_t                                                m_capacity;
+    std::mutex                                            m_mutex;
+    std::condition_variable                               m_available;
+    std::vector<std::unique_ptr<BRLCAD::MemoryDatabase> > m_databases;
+    size_t                                                m_loaded;
+};
+
+
+// the plots of an object on their way from a plotting thread to the rendering
+struct PlottedObject {
+    size_t                     index;
+    std::vector<PlotGeometry*> plots;  // empty if the object couldn't be plotted
+    size_t                     bytes;
+};
+
+
+// a bounded queue between the plotting threads and the rendering, it limits the plots held at once
+class PlotQueue {
+public:
+    PlotQueue(size_t capacity,
+              size_t producerCount) : m_capacity(capacity), m_producerCount(producerCount), m_mutex(), m_notFull(), m_notEmpty(), m_objects(), m_bytes(0) {}
+
+    // waits while the queue is full
+    void Push(PlottedObject& object) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_notFull.wait(lock, [this]() {
+                return m_objects.size() < m_capacity;
+            });
+
+            m_bytes += object.bytes;
+            m_objects.push_back(PlottedObject());
+            m_objects.back().index = object.index;
+            m_objects.back().bytes = object.bytes;
+            m_objects.back().plots.swap(object.plots);
+        }
+
+        m_notEmpty.notify_one();
+    }
+
+    // waits for the next object, false if all producers are done and the queue is empty
+    bool Pop(PlottedObject& object) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_notEmpty.wait(lock, [this]() {
+                return !m_objects.empty() || (m_producerCount == 0);
+            });
+
+            if (m_objects.empty())
+                return false;
+
+            object.index = m_objects.front().index;
+            object.bytes = m_objects.front().bytes;
+            object.plots.swap(m_objects.front().plots);
+            m_objects.pop_front();
+            m_bytes -= object.bytes;
+        }
+
+        m_notFull.notify_one();
+
+        return true;
+    }
+
+    void ProducerDone(void) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_producerCount;
+        }
+
+        m_notEmpty.notify_all();
+    }
+
+    // of the plots in the queue
+    size_t Bytes(void) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_bytes;
+    }
+
+private:
+    size_t                    m_capacity;
+    size_t                    m_producerCount;
+    std::mutex                m_mutex;
+    std::condition_variable   m_notFull;
+    std::condition_variable   m_notEmpty;
+    std::deque<PlottedObject> m_objects;
+    size_t                    m_bytes;
+};
+
+
+static const char* ViewName
+(
+    BatchExport::View view
+) {
+    const char* ret = "iso";
+
+    switch (view) {
+        case BatchExport::View::Top:
+            ret = "top";
+            break;
+
+        case BatchExport::View::Side:
+            ret = "side";
+            break;
+
+        case BatchExport::View::Front:
+            ret = "front";
+            break;
+
+        case BatchExport::View::Isometric:
+            break;
+    }
+
+    return ret;
+}
+
+
+BatchExport::BatchExport
+(
+    const QString&           fileName,
+    const QStringList&       objects,
+    const std::vector<View>& views,
+    const QSize&             imageSize,
+    const QString&           outputDirectory
+) : m_fileName(fileName),
+    m_objects(objects),
+    m_views(views),
+    m_imageSize(imageSize),
+    m_outputDirectory(outputDirectory),
+    m_reportFile() {}
+
+
+void BatchExport::SetReportFile
+(
+    const QString& fileName
+) {
+    m_reportFile = fileName;
+}
+
+
+int BatchExport::Run(void) {
+    QTextStream   out(stdout);
+    QTextStream   err(stderr);
+    QElapsedTimer totalTimer;
+    DatabasePool  databases(m_fileName, MaxDatabases);
+
+    totalTimer.start();
+
+    // the object list
+    std::unique_ptr<BRLCAD::MemoryDatabase> database = databases.Acquire();
+
+    if (!database) {
+        err << "Can't load " << m_fileName << "\n";
+        return 1;
+    }
+
+    QStringList objects = m_objects;
+
+    if (objects.isEmpty()) {
+        BRLCAD::ConstDatabase::TopObjectIterator topObjectIterator = database->FirstTopObject();
+
+        while (topObjectIterator.Good()) {
+            objects.append(QString::fromUtf8(topObjectIterator.Name()));
+            ++topObjectIterator;
+        }
+    }
+
+    databases.Release(std::move(database));
+
+    if (!QDir().mkpath(m_outputDirectory)) {
+        err << "Can't create " << m_outputDirectory << "\n";
+        return 1;
+    }
+
+    // the region plots of the objects, made by a few plotting threads while the rendering goes on
+    // the queue holds a few objects, this way the plots in memory don't grow with the number of objects
+    size_t                   producerCount = std::max<size_t>(1, std::min(std::min(WorkerCount(), MaxDatabases), static_cast<size_t>(objects.size())));
+    PlotQueue                plotQueue(QueuedObjects * producerCount, producerCount);
+    std::atomic<size_t>      nextObject(0);
+    std::atomic<qint64>      plotTime(0);
+    QElapsedTimer            plotTimer;
+    std::vector<std::thread> producers;
+
+    plotTimer.start();
+
+    for (size_t i = 0; i < producerCount; ++i) {
+        producers.push_back(std::thread([&databases, &objects, &plotQueue, &nextObject, &plotTime, &plotTimer]() {
+            for (size_t index = nextObject++; index < static_cast<size_t>(objects.size()); index = nextObject++) {
+                PlottedObject                           object   = {index, std::vector<PlotGeometry*>(), 0};
+                std::unique_ptr<BRLCAD::MemoryDatabase> database = databases.Acquire();
+
+                if (database) {
+                    QByteArray objectName = objects.at(static_cast<int>(index)).toUtf8(); // at() doesn't detach the list
+
+                    object.plots = PlotGeometry::PlotRegions(*database, objectName.data());
+                    databases.Release(std::move(database));
+
+                    for (std::vector<PlotGeometry*>::const_iterator it = object.plots.begin(); it != object.plots.end(); ++it) {
+                        (*it)->Prepare();
+                        object.bytes += (*it)->Bytes();
+                    }
+                }
+
+                plotQueue.Push(object);
+            }
+
+            // until the last object was plotted
+            qint64 elapsed  = plotTimer.nsecsElapsed();
+            qint64 previous = plotTime;
+
+            while ((previous < elapsed) && !plotTime.compare_exchange_weak(previous, elapsed))
+                ;
+
+            plotQueue.ProducerDone();
+        }));
+    }
+
+    MemoryUsage memoryUsage;
+    size_t      plotBytes = 0; // the most held at once
+
+    // the rendering needs the thread of the QApplication
+    QWidget window;
+    window.setAttribute(Qt::WA_DontShowOnScreen);
+    window.resize(m_imageSize.width(), m_imageSize.height());
+
+    GeometryModel   model;
+    DisplayManager* display = new DisplayManager(&window);
+
+    display->resize(m_imageSize.width(), m_imageSize.height());
+    display->SetModel(&model);
+    window.show();
+    QApplication::processEvents(); // initializes the OpenGL context
+
+    QDir                           outputDirectory(m_outputDirectory);
+    std::deque<std::future<bool> > encodings;
+    size_t                         imageCount   = 0;
+    size_t                         failureCount = 0;
+    qint64                         renderTime   = 0;
+    QElapsedTimer                  renderTimer;
+    qint64                         frameTime    = 0; // summed up over the images
+    qint64                         maxFrameTime = 0;
+    size_t                         gpuBytes     = 0; // of the largest object
+    size_t                         stagingBytes = 0;
+
+    PlottedObject object = {0, std::vector<PlotGeometry*>(), 0};
+
+    while (plotQueue.Pop(object)) {
+        if (object.plots.empty()) {
+            err << "Can't plot " << objects.at(static_cast<int>(object.index)) << "\n";
+            ++failureCount;
+            continue;
+        }
+
+        plotBytes = std::max(plotBytes, plotQueue.Bytes() + object.bytes);
+        memoryUsage.SetObjectBytes(objects.at(static_cast<int>(object.index)).toUtf8().data(), object.bytes);
+
+        renderTimer.start();
+
+        // the model takes the plots over, they are uploaded once for all views and freed with the next object
+        model.Clear();
+        model.Append(std::vector<Geometry*>(object.plots.begin(), object.plots.end()));
+
+        object.plots.clear();
+        display->Redraw();
+
+        QString baseName = objects.at(static_cast<int>(object.index));
+        baseName.replace('/', '_');
+
+        for (std::vector<View>::const_iterator view = m_views.begin(); view != m_views.end(); ++view) {
+            switch (*view) {
+                case View::Top:
+                    display->SetToXYPlane();
+                    break;
+
+                case View::Side:
+                    display->SetToXZPlane();
+                    break;
+
+                case View::Front:
+                    display->SetToYZPlane();
+                    break;
+
+                case View::Isometric:
+                    display->SetToIsometric();
+            }
+
+            QImage  image    = display->grabFramebuffer();
+            QString fileName = outputDirectory.filePath(baseName + "_" + ViewName(*view) + ".png");
+
+            frameTime    += display->Statistics().frameTime;
+            maxFrameTime  = std::max(maxFrameTime, display->Statistics().frameTime);
+            gpuBytes      = std::max(gpuBytes, display->Scene()->GpuBytes());
+            stagingBytes  = std::max(stagingBytes, display->Statistics().peakStagingBytes);
+
+            // the encoding runs besides the rendering, a few images at a time
+            if (encodings.size() >= WorkerCount()) {
+                if (!encodings.front().get())
+                    ++failureCount;
+
+                encodings.pop_front();
+            }
+
+            encodings.push_back(std::async(std::launch::async, [image, fileName]() {
+                return image.save(fileName, "PNG");
+            }));
+
+            ++imageCount;
+        }
+
+        renderTime += renderTimer.nsecsElapsed();
+    }
+
+    for (std::vector<std::thread>::iterator it = producers.begin(); it != producers.end(); ++it)
+        it->join();
+
+    while (!encodings.empty()) {
+        if (!encodings.front().get())
+            ++failureCount;
+
+        encodings.pop_front();
+    }
+
+    model.Clear();
+
+    double totalSeconds = totalTimer.nsecsElapsed() / 1000000000.;
+
+    out << "Exported " << imageCount << " images of " << objects.size() << " objects in " << totalSeconds << " s: "
+        << ((totalSeconds > 0.) ? imageCount / totalSeconds : 0.) << " images/s "
+        << "(plotting " << plotTime / 1000000000. << " s, rendering " << renderTime / 1000000000. << " s)\n";
+
+    if (!m_reportFile.isEmpty()) {
+        QJsonObject seconds;
+        QJsonObject frameMilliseconds;
+        QJsonObject report;
+
+        memoryUsage.SetBytes(MemoryUsage::Subsystem::Database, databases.Loaded() * static_cast<size_t>(QFileInfo(m_fileName).size()));
+        memoryUsage.SetBytes(MemoryUsage::Subsystem::Plots, plotBytes);
+        memoryUsage.SetBytes(MemoryUsage::Subsystem::GpuBuffers, gpuBytes);
+
+        seconds["total"]          = totalSeconds;
+        seconds["plotting"]       = plotTime / 1000000000.;
+        seconds["rendering"]      = renderTime / 1000000000.;
+        frameMilliseconds["mean"] = (imageCount > 0) ? frameTime / 1000000. / imageCount : 0.;
+        frameMilliseconds["max"]  = maxFrameTime / 1000000.;
+
+        report["file"]              = m_fileName;
+        report["objects"]           = objects.size();
+        report["images"]            = static_cast<double>(imageCount);
+        report["failures"]          = static_cast<double>(failureCount);
+        report["imagesPerSecond"]   = (totalSeconds > 0.) ? imageCount / totalSeconds : 0.;
+        report["seconds"]           = seconds;
+        report["frameMilliseconds"] = frameMilliseconds;
+        report["peakStagingBytes"]  = static_cast<double>(stagingBytes);
+        report["memory"]            = memoryUsage.ToJson();
+
+        if (!PerformanceGate::WriteJson(m_reportFile, report)) {
+            err << "Can't write " << m_reportFile << "\n";
+            ++failureCount;
+        }
+    }
+
+    if (failureCount > 0) {
+        err << failureCount << " objects or images failed\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+
+bool BatchExport::ParseView
+(
+    const QString& name,
+    View&          view
+) {
+    bool ret = true;
+
+    if (name == "top")
+        view = View::Top;
+    else if (name == "side")
+        view = View::Side;
+    else if (name == "front")
+        view = View::Front;
+    else if (name == "iso")
+        view = View::Isometric;
+    else
+        ret = false;
+
+    return ret;
+}
@@ -0,0 +1,73 @@
+/*                       B A T C H E X P O R T . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file BatchExport.h
+ *
+ *  BRL-CAD GUI:
+ *      the headless image export declaration
+ *
+ *  Renders every object in every view preset into a PNG file.  The objects
+ *  are plotted by a few threads, every one with its own copy of the
+ *  database, and handed over to the rendering through a bounded queue: only
+ *  a few objects' plots and database copies are held at once.  Every plot is
+ *  uploaded once and drawn in all views by a display manager on a hidden
+ *  window, and freed with the next object.  The images are encoded in
+ *  parallel to the rendering of the next object.  The timings and the memory usage
+ *  can be written into a JSON report for the benchmarks.
+ */
+
+#ifndef BATCHEXPORT_INCLUDED
+#define BATCHEXPORT_INCLUDED
+
+#include <vector>
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+
+class BatchExport {
+public:
+    enum class View {
+        Top,
+        Side,
+        Front,
+        Isometric
+    };
+
+    BatchExport(const QString&           fileName,
+                const QStringList&       objects,   // all top objects if empty
+                const std::vector<View>& views,
+                const QSize&             imageSize,
+                const QString&           outputDirectory);
+
+    // a JSON file with the measurements, none if empty
+    void        SetReportFile(const QString& fileName);
+
+    // the exit code of the program
+    int         Run(void);
+
+    static bool ParseView(const QString& name,
+                          View&          view);
+
+private:
+    QString           m_fileName;
+    QStringList       m_objects;
+    std::vector<View> m_views;
+    QSize             m_imageSize;
+    QString           m_outputDirectory;
+    QString           m_reportFile;
+};
+
+
+#endif // BATCHEXPORT_INCLUDED
@@ -0,0 +1,476 @@
+/*         B O U N D I N G V O L U M E H I E R A R C H Y . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file BoundingVolumeHierarchy.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a spatial index over the primitives of the geometries implementation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+
+#include "Parallel.h"
+#include "BoundingVolumeHierarchy.h"
+
+
+typedef BoundingVolumeHierarchy::Node      Node;
+typedef BoundingVolumeHierarchy::Primitive Primitive;
+
+
+const unsigned int LeafSize = 4;
+const float        MaxFloat = std::numeric_limits<float>::max();
+
+
+static void Include
+(
+    Node&            node,
+    const QVector3D& point
+) {
+    node.minCorner.setX(std::min(node.minCorner.x(), point.x()));
+    node.minCorner.setY(std::min(node.minCorner.y(), point.y()));
+    node.minCorner.setZ(std::min(node.minCorner.z(), point.z()));
+
+    node.maxCorner.setX(std::max(node.maxCorner.x(), point.x()));
+    node.maxCorner.setY(std::max(node.maxCorner.y(), point.y()));
+    node.maxCorner.setZ(std::max(node.maxCorner.z(), point.z()));
+}
+
+
+static void Include
+(
+    Node&            node,
+    const Primitive& primitive
+) {
+    for (unsigned int i = 0; i < primitive.cornerCount; ++i)
+        Include(node, primitive.corners[i]);
+}
+
+
+static void Include
+(
+    Node&       node,
+    const Node& box
+) {
+    Include(node, box.minCorner);
+    Include(node, box.maxCorner);
+}
+
+
+static QVector3D Centroid
+(
+    const Primitive& primitive
+) {
+    QVector3D ret = primitive.corners[0];
+
+    for (unsigned int i = 1; i < primitive.cornerCount; ++i)
+        ret += primitive.corners[i];
+
+    return ret / static_cast<float>(primitive.cornerCount);
+}
+
+
+// builds the nodes over items[first, first + count) and reorders the items
+// item bounds are added with Include(node, item), the split position comes from the centroids
+template<class Item>
+static void BuildNodes
+(
+    std::vector<Node>&            nodes,
+    std::vector<Item>&            items,
+    const std::vector<QVector3D>& centroids,
+    std::vector<unsigned int>&    order,
+    unsigned int                  first,
+    unsigned int                  count
+) {
+    size_t index = nodes.size();
+    Node   node  = {QVector3D(MaxFloat, MaxFloat, MaxFloat), QVector3D(-MaxFloat, -MaxFloat, -MaxFloat), first, 0, 0};
+    Node   centroidBox(node);
+
+    for (unsigned int i = first; i < first + count; ++i) {
+        Include(node, items[order[i]]);
+        Include(centroidBox, centroids[order[i]]);
+    }
+
+    nodes.push_back(node);
+
+    if (count <= LeafSize)
+        nodes[index].count = count;
+    else {
+        QVector3D extent = centroidBox.maxCorner - centroidBox.minCorner;
+        int       axis   = 0;
+
+        if ((extent.y() > extent.x()) && (extent.y() >= extent.z()))
+            axis = 1;
+        else if (extent.z() > extent.x())
+            axis = 2;
+
+        unsigned int half = count / 2;
+
+        std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                         [&centroids, axis](unsigned int a, unsigned int b) {return centroids[a][axis] < centroids[b][axis];});
+
+        BuildNodes(nodes, items, centroids, order, first, half);
+        nodes[index].right = static_cast<unsigned int>(nodes.size());
+        BuildNodes(nodes, items, centroids, order, first + half, count - half);
+    }
+}
+
+
+// the line through the display point, in model coordinates, against a box grown by radius
+static bool LineHitsBox
+(
+    const QVector3D& origin,
+    const QVector3D& direction,
+    const Node&      node,
+    float            radius
+) {
+    float tMin = -MaxFloat;
+    float tMax = MaxFloat;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float minimum = node.minCorner[axis] - radius;
+        float maximum = node.maxCorner[axis] + radius;
+
+        if (fabs(direction[axis]) < std::numeric_limits<float>::epsilon()) {
+            if ((origin[axis] < minimum) || (origin[axis] > maximum))
+                return false;
+        }
+        else {
+            float t1 = (minimum - origin[axis]) / direction[axis];
+            float t2 = (maximum - origin[axis]) / direction[axis];
+
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+
+            if (tMin > tMax)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+static double SegmentDistance
+(
+    double           px,
+    double           py,
+    const QVector3D& a,
+    const QVector3D& b
+) {
+    double dx     = b.x() - a.x();
+    double dy     = b.y() - a.y();
+    double length = dx * dx + dy * dy;
+    double t      = 0.;
+
+    if (length > 0.)
+        t = std::min(std::max(((px - a.x()) * dx + (py - a.y()) * dy) / length, 0.), 1.);
+
+    double ex = a.x() + t * dx - px;
+    double ey = a.y() + t * dy - py;
+
+    return sqrt(ex * ex + ey * ey);
+}
+
+
+// the distance in the display's x-y plane, and the depth of the primitive
+static double DisplayDistance
+(
+    const Primitive&  primitive,
+    const QMatrix4x4& model2Display,
+    const QPoint&     displayPoint,
+    float&            depth
+) {
+    QVector3D corners[3];
+    double    px = displayPoint.x();
+    double    py = displayPoint.y();
+
+    depth = -MaxFloat;
+
+    for (unsigned int i = 0; i < primitive.cornerCount; ++i) {
+        corners[i] = model2Display.map(primitive.corners[i]);
+        depth      = std::max(depth, corners[i].z());
+    }
+
+    double ret = 0.;
+
+    if (primitive.cornerCount == 1) {
+        double dx = corners[0].x() - px;
+        double dy = corners[0].y() - py;
+
+        ret = sqrt(dx * dx + dy * dy);
+    }
+    else if (primitive.cornerCount == 2)
+        ret = SegmentDistance(px, py, corners[0], corners[1]);
+    else {
+        double d1 = (corners[1].x() - corners[0].x()) * (py - corners[0].y()) - (corners[1].y() - corners[0].y()) * (px - corners[0].x());
+        double d2 = (corners[2].x() - corners[1].x()) * (py - corners[1].y()) - (corners[2].y() - corners[1].y()) * (px - corners[1].x());
+        double d3 = (corners[0].x() - corners[2].x()) * (py - corners[2].y()) - (corners[0].y() - corners[2].y()) * (px - corners[2].x());
+        bool   inside = ((d1 >= 0.) && (d2 >= 0.) && (d3 >= 0.)) || ((d1 <= 0.) && (d2 <= 0.) && (d3 <= 0.));
+
+        if (!inside) {
+            ret = std::min(SegmentDistance(px, py, corners[0], corners[1]),
+                           std::min(SegmentDistance(px, py, corners[1], corners[2]), SegmentDistance(px, py, corners[2], corners[0])));
+        }
+    }
+
+    return ret;
+}
+
+
+class CollectPrimitivesCallback : public PrimitiveCallback {
+public:
+    CollectPrimitivesCallback(std::vector<Primitive>& primitives) : m_primitives(primitives) {}
+
+    virtual void Point(const QVector3D& point) {
+        Primitive primitive = {{point, point, point}, 1};
+
+        m_primitives.push_back(primitive);
+    }
+
+    virtual void Line(const QVector3D& start,
+                      const QVector3D& end) {
+        Primitive primitive = {{start, end, end}, 2};
+
+        m_primitives.push_back(primitive);
+    }
+
+    virtual void Triangle(const QVector3D& a,
+                          const QVector3D& b,
+                          const QVector3D& c) {
+        Primitive primitive = {{a, b, c}, 3};
+
+        m_primitives.push_back(primitive);
+    }
+
+private:
+    std::vector<Primitive>& m_primitives;
+};
+
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(void) : m_trees(), m_topNodes(), m_topOrder() {}
+
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy(void) {}
+
+
+void BoundingVolumeHierarchy::Insert
+(
+    const std::vector<const Geometry*>& geometries
+) {
+    std::vector<std::unique_ptr<Tree>> newTrees(geometries.size());
+
+    ParallelFor(geometries.size(), [&geometries, &newTrees](size_t index) {
+        std::unique_ptr<Tree>     tree(new Tree);
+        std::vector<Primitive>    primitives;
+        CollectPrimitivesCallback callback(primitives);
+
+        tree->geometry = geometries[index];
+        geometries[index]->Primitives(callback);
+
+        std::vector<QVector3D>    centroids(primitives.size());
+        std::vector<unsigned int> order(primitives.size());
+
+        for (size_t i = 0; i < primitives.size(); ++i) {
+            centroids[i] = Centroid(primitives[i]);
+            order[i]     = static_cast<unsigned int>(i);
+        }
+
+        if (primitives.size() > 0) {
+            BuildNodes(tree->nodes, primitives, centroids, order, 0, static_cast<unsigned int>(primitives.size()));
+
+            // store the primitives in leaf order
+            tree->primitives.reserve(primitives.size());
+
+            for (size_t i = 0; i < order.size(); ++i)
+                tree->primitives.push_back(primitives[order[i]]);
+        }
+
+        newTrees[index] = std::move(tree);
+    });
+
+    for (size_t i = 0; i < newTrees.size(); ++i)
+        m_trees.push_back(std::move(newTrees[i]));
+
+    BuildTop();
+}
+
+
+void BoundingVolumeHierarchy::Remove
+(
+    const std::vector<const Geometry*>& geometries
+) {
+    std::set<const Geometry*>                    removed(geometries.begin(), geometries.end());
+    std::vector<std::unique_ptr<Tree>>::iterator end = std::remove_if(m_trees.begin(), m_trees.end(), [&removed](const std::unique_ptr<Tree>& tree) {
+        return removed.find(tree->geometry) != removed.end();
+    });
+
+    // the top tree is built once for all of them
+    if (end != m_trees.end()) {
+        m_trees.erase(end, m_trees.end());
+        BuildTop();
+    }
+}
+
+
+// the successors have the same primitives, they keep their geometries' trees
+void BoundingVolumeHierarchy::Replace
+(
+    const std::vector<GeometryModel::Replacement>& replacements
+) {
+    std::map<const Geometry*, const Geometry*> successors;
+
+    for (std::vector<GeometryModel::Replacement>::const_iterator it = replacements.begin(); it != replacements.end(); ++it)
+        successors[it->first] = it->second;
+
+    for (std::vector<std::unique_ptr<Tree>>::iterator it = m_trees.begin(); it != m_trees.end(); ++it) {
+        std::map<const Geometry*, const Geometry*>::const_iterator successor = successors.find((*it)->geometry);
+
+        if (successor != successors.end())
+            (*it)->geometry = successor->second;
+    }
+}
+
+
+void BoundingVolumeHierarchy::Clear(void) {
+    m_trees.clear();
+    m_topNodes.clear();
+    m_topOrder.clear();
+}
+
+
+size_t BoundingVolumeHierarchy::PrimitiveCount(void) const {
+    size_t ret = 0;
+
+    for (size_t i = 0; i < m_trees.size(); ++i)
+        ret += m_trees[i]->primitives.size();
+
+    return ret;
+}
+
+
+size_t BoundingVolumeHierarchy::Bytes(void) const {
+    size_t ret = m_topNodes.capacity() * sizeof(Node) + m_topOrder.capacity() * sizeof(size_t);
+
+    for (size_t i = 0; i < m_trees.size(); ++i)
+        ret += sizeof(Tree) + m_trees[i]->nodes.capacity() * sizeof(Node) + m_trees[i]->primitives.capacity() * sizeof(Primitive);
+
+    return ret;
+}
+
+
+const Geometry* BoundingVolumeHierarchy::Nearest
+(
+    const QMatrix4x4& model2Display,
+    const QMatrix4x4& display2Model,
+    const QPoint&     displayPoint,
+    double            maxDistance
+) const {
+    const Geometry* ret = 0;
+
+    if (m_topNodes.size() > 0) {
+        // with the parallel projection the display point is a line in the model
+        QVector3D origin    = display2Model.map(QVector3D(displayPoint.x(), displayPoint.y(), 0.f));
+        QVector3D direction = display2Model.map(QVector3D(displayPoint.x(), displayPoint.y(), 1.f)) - origin;
+        float     pixelSize = std::max((display2Model.map(QVector3D(displayPoint.x() + 1.f, displayPoint.y(), 0.f)) - origin).length(),
+                                       (display2Model.map(QVector3D(displayPoint.x(), displayPoint.y() + 1.f, 0.f)) - origin).length());
+        double    bestDistance = maxDistance;
+        float     bestDepth    = -MaxFloat;
+
+        std::vector<unsigned int> topStack(1, 0);
+        std::vector<unsigned int> stack;
+
+        while (!topStack.empty()) {
+            unsigned int topIndex = topStack.back();
+            const Node&  topNode  = m_topNodes[topIndex];
+
+            topStack.pop_back();
+
+            if (!LineHitsBox(origin, direction, topNode, static_cast<float>(bestDistance * pixelSize)))
+                continue;
+
+            if (topNode.count == 0) {
+                topStack.push_back(topNode.right);
+                topStack.push_back(topIndex + 1);
+                continue;
+            }
+
+            for (unsigned int t = topNode.first; t < topNode.first + topNode.count; ++t) {
+                const Tree& tree = *m_trees[m_topOrder[t]];
+
+                stack.assign(1, 0);
+
+                while (!stack.empty()) {
+                    unsigned int index = stack.back();
+                    const Node&  node  = tree.nodes[index];
+
+                    stack.pop_back();
+
+                    if (!LineHitsBox(origin, direction, node, static_cast<float>(bestDistance * pixelSize)))
+                        continue;
+
+                    if (node.count == 0) {
+                        stack.push_back(node.right);
+                        stack.push_back(index + 1);
+                        continue;
+                    }
+
+                    for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+                        float  depth;
+                        double distance = DisplayDistance(tree.primitives[i], model2Display, displayPoint, depth);
+
+                        if ((distance < bestDistance) || ((distance == bestDistance) && (depth > bestDepth) && (ret != 0))) {
+                            bestDistance = distance;
+                            bestDepth    = depth;
+                            ret          = tree.geometry;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+void BoundingVolumeHierarchy::BuildTop(void) {
+    std::vector<Node>         roots;
+    std::vector<QVector3D>    centroids;
+    std::vector<unsigned int> order;
+
+    m_topNodes.clear();
+    m_topOrder.clear();
+
+    for (size_t i = 0; i < m_trees.size(); ++i) {
+        if (m_trees[i]->nodes.size() > 0) {
+            roots.push_back(m_trees[i]->nodes[0]);
+            centroids.push_back((m_trees[i]->nodes[0].minCorner + m_trees[i]->nodes[0].maxCorner) / 2.f);
+            order.push_back(static_cast<unsigned int>(order.size()));
+            m_topOrder.push_back(i);
+        }
+    }
+
+    if (roots.size() > 0) {
+        BuildNodes(m_topNodes, roots, centroids, order, 0, static_cast<unsigned int>(roots.size()));
+
+        // the leaves refer to the trees in order
+        std::vector<size_t> treeIndices(m_topOrder);
+
+        for (size_t i = 0; i < order.size(); ++i)
+            m_topOrder[i] = treeIndices[order[i]];
+    }
+}
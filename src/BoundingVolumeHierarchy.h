@@ -0,0 +1,88 @@
+/*           B O U N D I N G V O L U M E H I E R A R C H Y . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file BoundingVolumeHierarchy.h
+ *
+ *  BRL-CAD GUI:
+ *      a spatial index over the primitives of the geometries declaration
+ *
+ *  There is one hierarchy of axis aligned boxes per geometry, and one over
+ *  the geometries' boxes on top of them.  This way a geometry can be added
+ *  or removed without touching the primitives of the other ones.
+ */
+
+#ifndef BOUNDINGVOLUMEHIERARCHY_INCLUDED
+#define BOUNDINGVOLUMEHIERARCHY_INCLUDED
+
+#include <memory>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QPoint>
+#include <QVector3D>
+
+#include "GeometryModel.h"
+
+
+class BoundingVolumeHierarchy {
+public:
+    BoundingVolumeHierarchy(void);
+    ~BoundingVolumeHierarchy(void);
+
+    // the hierarchies of the new geometries are build in parallel
+    void            Insert(const std::vector<const Geometry*>& geometries);
+    void            Remove(const std::vector<const Geometry*>& geometries);
+    void            Replace(const std::vector<GeometryModel::Replacement>& replacements);
+    void            Clear(void);
+
+    size_t          PrimitiveCount(void) const;
+    size_t          Bytes(void) const;
+
+    // the geometry nearest to a display point within maxDistance pixels, 0 if there is none
+    const Geometry* Nearest(const QMatrix4x4& model2Display,
+                            const QMatrix4x4& display2Model,
+                            const QPoint&     displayPoint,
+                            double            maxDistance) const;
+
+    struct Node {
+        QVector3D    minCorner;
+        QVector3D    maxCorner;
+        unsigned int first;  // the first item of a leaf
+        unsigned int count;  // 0 for inner nodes
+        unsigned int right;  // the right child of an inner node, the left one follows the node
+    };
+
+    struct Primitive {
+        QVector3D    corners[3];
+        unsigned int cornerCount; // 1: point, 2: line, 3: triangle
+    };
+
+private:
+    struct Tree {
+        const Geometry*        geometry;
+        std::vector<Node>      nodes;
+        std::vector<Primitive> primitives;
+    };
+
+    std::vector<std::unique_ptr<Tree>> m_trees;
+    std::vector<Node>                  m_topNodes;
+    std::vector<size_t>                m_topOrder; // the top nodes' leaves point into this
+
+    void BuildTop(void);
+
+    BoundingVolumeHierarchy(const BoundingVolumeHierarchy&);
+    BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy&);
+};
+
+
+#endif // BOUNDINGVOLUMEHIERARCHY_INCLUDED
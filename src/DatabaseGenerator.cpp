@@ -0,0 +1,335 @@
+/*                D A T A B A S E G E N E R A T O R . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file DatabaseGenerator.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a generator of synthetic databases for scale tests
+ *
+ *  Writes a .g file with a given number of primitives on a grid.  They are
+ *  united into regions, the regions into combinations and so on up to the
+ *  given depth, the combinations of the last level are the top objects.  A
+ *  member of a combination may be an object used by another one already,
+ *  like the instances in a real model.  The same parameters give the same
+ *  database on every platform.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <brlcad/Database/Arb8.h>
+#include <brlcad/Database/Combination.h>
+#include <brlcad/Database/MemoryDatabase.h>
+#include <brlcad/Database/Sphere.h>
+
+
+const double Spacing  = 10.;  // of the primitives' grid
+const double MaxReuse = 0.9;  // every combination needs a new member
+
+
+// splitmix64, the distributions of <random> differ between the standard libraries
+class Random {
+public:
+    Random(unsigned long long seed) : m_state(seed) {}
+
+    unsigned long long Next(void) {
+        unsigned long long ret = (m_state += 0x9e3779b97f4a7c15ULL);
+
+        ret = (ret ^ (ret >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        ret = (ret ^ (ret >> 27)) * 0x94d049bb133111ebULL;
+
+        return ret ^ (ret >> 31);
+    }
+
+    // in [0, 1)
+    double Uniform(void) {
+        return (Next() >> 11) * (1. / 9007199254740992.);
+    }
+
+    double Uniform(double minimum,
+                   double maximum) {
+        return minimum + Uniform() * (maximum - minimum);
+    }
+
+    // in [0, count)
+    size_t Index(size_t count) {
+        return static_cast<size_t>(Next() % count);
+    }
+
+private:
+    unsigned long long m_state;
+};
+
+
+struct Parameters {
+    size_t             primitives;
+    size_t             depth;      // the levels of combinations, the first one are the regions
+    size_t             fanOut;     // the members of a combination
+    double             reuse;      // the probability of a member being used by another combination too
+    size_t             nameLength; // the minimal length of the names
+    unsigned long long seed;
+    std::string        fileName;
+
+    Parameters(void) : primitives(10000), depth(4), fanOut(8), reuse(0.1), nameLength(0), seed(1), fileName() {}
+};
+
+
+struct Counts {
+    size_t primitives;
+    size_t regions;
+    size_t combinations;
+    size_t instances;  // the members used more than once
+    size_t topObjects;
+    size_t failures;
+
+    Counts(void) : primitives(0), regions(0), combinations(0), instances(0), topObjects(0), failures(0) {}
+};
+
+
+static void Usage
+(
+    const char* program
+) {
+    std::cerr << "Usage: " << program << " [options] file.g\n"
+              << "  --primitives <n>   the number of primitives (default 10000)\n"
+              << "  --depth <n>        the levels of combinations above the primitives (default 4)\n"
+              << "  --fan-out <n>      the members of a combination (default 8)\n"
+              << "  --reuse <ratio>    the probability of a member being used twice, 0 to " << MaxReuse << " (default 0.1)\n"
+              << "  --name-length <n>  the minimal length of the object names (default 0)\n"
+              << "  --seed <n>         the start of the random sequence (default 1)\n";
+}
+
+
+static bool ParseArguments
+(
+    int         argc,
+    char*       argv[],
+    Parameters& parameters
+) {
+    bool ret = true;
+
+    for (int i = 1; (i < argc) && ret; ++i) {
+        const char* argument = argv[i];
+
+        if (argument[0] != '-') {
+            if (parameters.fileName.empty())
+                parameters.fileName = argument;
+            else
+                ret = false;
+        }
+        else if (i + 1 < argc) {
+            const char* value = argv[++i];
+
+            if (strcmp(argument, "--primitives") == 0)
+                parameters.primitives = strtoul(value, 0, 10);
+            else if (strcmp(argument, "--depth") == 0)
+                parameters.depth = strtoul(value, 0, 10);
+            else if (strcmp(argument, "--fan-out") == 0)
+                parameters.fanOut = strtoul(value, 0, 10);
+            else if (strcmp(argument, "--reuse") == 0)
+                parameters.reuse = strtod(value, 0);
+            else if (strcmp(argument, "--name-length") == 0)
+                parameters.nameLength = strtoul(value, 0, 10);
+            else if (strcmp(argument, "--seed") == 0)
+                parameters.seed = strtoull(value, 0, 10);
+            else
+                ret = false;
+        }
+        else
+            ret = false;
+    }
+
+    return ret && !parameters.fileName.empty() && (parameters.primitives > 0) && (parameters.depth > 0) && (parameters.fanOut > 1)
+           && (parameters.reuse >= 0.) && (parameters.reuse <= MaxReuse);
+}
+
+
+// prefix, index and suffix, padded in the middle
+static std::string ObjectName
+(
+    const std::string& prefix,
+    size_t             index,
+    const char*        suffix,
+    size_t             nameLength
+) {
+    std::string ret = prefix + std::to_string(index);
+
+    if (ret.size() + strlen(suffix) < nameLength) {
+        ret += '_';
+
+        for (size_t i = 0; ret.size() + strlen(suffix) < nameLength; ++i)
+            ret += static_cast<char>('a' + (index + i) % 26);
+    }
+
+    ret += suffix;
+
+    return ret;
+}
+
+
+static std::vector<std::string> AddPrimitives
+(
+    BRLCAD::MemoryDatabase& database,
+    const Parameters&       parameters,
+    Random&                 random,
+    Counts&                 counts
+) {
+    std::vector<std::string> ret;
+    size_t                   side = static_cast<size_t>(ceil(cbrt(static_cast<double>(parameters.primitives))));
+
+    ret.reserve(parameters.primitives);
+
+    for (size_t i = 0; i < parameters.primitives; ++i) {
+        BRLCAD::Vector3D center(Spacing * (i % side), Spacing * ((i / side) % side), Spacing * (i / (side * side)));
+        std::string      name = ObjectName("s", i, ".s", parameters.nameLength);
+        bool             added;
+
+        // spheres and boxes in turn
+        if (i % 2 == 0) {
+            BRLCAD::Sphere sphere(center, random.Uniform(0.2, 0.45) * Spacing);
+
+            sphere.SetName(name.c_str());
+            added = database.Add(sphere);
+        }
+        else {
+            double           halfSize = random.Uniform(0.15, 0.45) * Spacing;
+            BRLCAD::Vector3D minCorner(center.coordinates[0] - halfSize, center.coordinates[1] - halfSize, center.coordinates[2] - halfSize);
+            BRLCAD::Vector3D maxCorner(center.coordinates[0] + halfSize, center.coordinates[1] + halfSize, center.coordinates[2] + halfSize);
+            BRLCAD::Arb8     box(minCorner, maxCorner);
+
+            box.SetName(name.c_str());
+            added = database.Add(box);
+        }
+
+        if (added) {
+            ret.push_back(name);
+            ++counts.primitives;
+        }
+        else
+            ++counts.failures;
+    }
+
+    return ret;
+}
+
+
+// unites the members into combinations of the next level, returns them
+static std::vector<std::string> AddLevel
+(
+    BRLCAD::MemoryDatabase&         database,
+    const std::vector<std::string>& members,
+    size_t                          level,
+    const Parameters&               parameters,
+    Random&                         random,
+    Counts&                         counts
+) {
+    std::vector<std::string> ret;
+    std::string              prefix  = (level == 0) ? std::string("r") : "c" + std::to_string(level) + "_";
+    const char*              suffix  = (level == 0) ? ".r" : ".c";
+    size_t                   nextNew = 0; // the members before it are used already
+
+    while (nextNew < members.size()) {
+        BRLCAD::Combination combination;
+        std::string         name = ObjectName(prefix, ret.size(), suffix, parameters.nameLength);
+
+        combination.SetName(name.c_str());
+        combination.AddLeaf(members[nextNew++].c_str());
+
+        for (size_t i = 1; i < parameters.fanOut; ++i) {
+            if (random.Uniform() < parameters.reuse) {
+                combination.AddLeaf(members[random.Index(nextNew)].c_str());
+                ++counts.instances;
+            }
+            else if (nextNew < members.size())
+                combination.AddLeaf(members[nextNew++].c_str());
+            else
+                break;
+        }
+
+        if (level == 0) {
+            combination.SetIsRegion(true);
+            combination.SetHasColor(true);
+            combination.SetRed(random.Uniform(0.2, 1.));
+            combination.SetGreen(random.Uniform(0.2, 1.));
+            combination.SetBlue(random.Uniform(0.2, 1.));
+        }
+
+        if (database.Add(combination)) {
+            ret.push_back(name);
+
+            if (level == 0)
+                ++counts.regions;
+            else
+                ++counts.combinations;
+        }
+        else
+            ++counts.failures;
+    }
+
+    return ret;
+}
+
+
+int main(int argc, char* argv[])
+{
+    Parameters parameters;
+
+    if (!ParseArguments(argc, argv, parameters)) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BRLCAD::MemoryDatabase                database;
+    Random                                random(parameters.seed);
+    Counts                                counts;
+    std::string                           title = "Synthetic database: " + std::to_string(parameters.primitives) + " primitives, depth "
+                                                  + std::to_string(parameters.depth) + ", fan-out " + std::to_string(parameters.fanOut);
+
+    database.SetTitle(title.c_str());
+
+    std::vector<std::string> members = AddPrimitives(database, parameters, random, counts);
+
+    for (size_t level = 0; (level < parameters.depth) && !members.empty(); ++level) {
+        members = AddLevel(database, members, level, parameters, random, counts);
+
+        // a single object can't be united any further
+        if (members.size() == 1)
+            break;
+    }
+
+    counts.topObjects = members.size();
+
+    if (!database.Save(parameters.fileName.c_str())) {
+        std::cerr << "Can't write " << parameters.fileName << "\n";
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Wrote " << parameters.fileName << " in " << seconds << " s: "
+              << counts.primitives << " primitives, " << counts.regions << " regions, " << counts.combinations << " combinations, "
+              << counts.instances << " reused members, " << counts.topObjects << " top objects\n";
+
+    if (counts.failures > 0) {
+        std::cerr << counts.failures << " objects could not be added\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -17,14 +17,54 @@
  *      the display functions class implementation
  */
 
+#include <algorithm>
 #include <cmath>
 
+#include <QElapsedTimer>
+
 #include "DisplayManager.h"
+#include "Parallel.h"
+#include "RenderThread.h"
 
 
 const float MaxFloat   = std::numeric_limits<float>::max();
 const float SmallFloat = std::numeric_limits<float>::epsilon();
 
+const int    ClickTolerance = 3;        // pixels a mouse may move during a click
+const double DepthRange     = 1000000.; // the glOrtho() near and far planes
+const int    RefineDelay    = 300;      // in milliseconds after the last frame which lacked detail
+const size_t RecordingWave  = 4;        // geometry parts per worker thread recorded before they are merged
+
+
+// the recording of one geometry on a worker thread
+struct WorkerRecording {
+    SceneRecording*                        recording;
+    std::vector<DisplayManager::Attribute> attributeStack;
+    float                                  detailTolerance; // the finest level of the recording
+};
+
+// set while the thread records a geometry, the Draw* functions collect into its SceneRecording
+static thread_local WorkerRecording* CurrentRecording = 0;
+
+
+// a part of the published geometry is drawn into the recording on this thread, starting with the attributes of ResetAttributes()
+// the display manager's state isn't used there, e.g. the geometry mustn't push trafos
+static void RecordGeometry
+(
+    DisplayManager& displayManager,
+    const Geometry& geometry,
+    size_t          part,
+    float           detailTolerance,
+    SceneRecording& recording
+) {
+    DisplayManager::Attribute baseAttribute   = {QColor("black"), 0};
+    WorkerRecording           workerRecording = {&recording, std::vector<DisplayManager::Attribute>(1, baseAttribute), detailTolerance};
+
+    CurrentRecording = &workerRecording;
+    geometry.DrawPart(displayManager, part);
+    CurrentRecording = 0;
+}
+
 
 static double Distance
 (
@@ -66,16 +106,161 @@ static QMatrix4x4 Projection
 }
 
 
+// the extent of vertices after an affine trafo
+// the vertices are collected in blocks, and every lane of a block has its own minima and maxima:
+// the inner loops have no dependencies between their iterations, the compiler turns them into SIMD instructions
+class ProjectedExtentCallback : public PrimitiveCallback {
+public:
+    ProjectedExtentCallback(const QMatrix4x4& trafo) : m_count(0), m_empty(true) {
+        for (int row = 0; row < 3; ++row) {
+            for (int column = 0; column < 4; ++column)
+                m_trafo[row][column] = trafo(row, column);
+
+            for (size_t lane = 0; lane < ExtentLanes; ++lane) {
+                m_minimum[row][lane] = MaxFloat;
+                m_maximum[row][lane] = -MaxFloat;
+            }
+        }
+    }
+
+    virtual void Point(const QVector3D& point) {
+        Add(point);
+    }
+
+    virtual void Line(const QVector3D& start,
+                      const QVector3D& end) {
+        Add(start);
+        Add(end);
+    }
+
+    virtual void Triangle(const QVector3D& a,
+                          const QVector3D& b,
+                          const QVector3D& c) {
+        Add(a);
+        Add(b);
+        Add(c);
+    }
+
+    bool Empty(void) const {
+        return m_empty && (m_count == 0);
+    }
+
+    // extends the corners, they stay unchanged if there was no vertex
+    void Extent(QVector3D& minCorner,
+                QVector3D& maxCorner) {
+        Flush();
+
+        if (!m_empty) {
+            float minimum[3];
+            float maximum[3];
+
+            for (int row = 0; row < 3; ++row) {
+                minimum[row] = *std::min_element(m_minimum[row], m_minimum[row] + ExtentLanes);
+                maximum[row] = *std::max_element(m_maximum[row], m_maximum[row] + ExtentLanes);
+            }
+
+            minCorner.setX(std::min(minCorner.x(), minimum[0]));
+            minCorner.setY(std::min(minCorner.y(), minimum[1]));
+            minCorner.setZ(std::min(minCorner.z(), minimum[2]));
+
+            maxCorner.setX(std::max(maxCorner.x(), maximum[0]));
+            maxCorner.setY(std::max(maxCorner.y(), maximum[1]));
+            maxCorner.setZ(std::max(maxCorner.z(), maximum[2]));
+        }
+    }
+
+private:
+    static const size_t ExtentLanes = 16;   // the floats of two AVX registers
+    static const size_t ExtentBlock = 1024; // a multiple of ExtentLanes
+
+    float  m_trafo[3][4];
+    float  m_x[ExtentBlock];
+    float  m_y[ExtentBlock];
+    float  m_z[ExtentBlock];
+    size_t m_count;
+    float  m_minimum[3][ExtentLanes];
+    float  m_maximum[3][ExtentLanes];
+    bool   m_empty;
+
+    void Add(const QVector3D& point) {
+        m_x[m_count] = point.x();
+        m_y[m_count] = point.y();
+        m_z[m_count] = point.z();
+        ++m_count;
+
+        if (m_count == ExtentBlock)
+            Flush();
+    }
+
+    void Flush(void) {
+        if (m_count > 0) {
+            // the last lanes get the first vertex again, it doesn't change the extent
+            while ((m_count % ExtentLanes) != 0) {
+                m_x[m_count] = m_x[0];
+                m_y[m_count] = m_y[0];
+                m_z[m_count] = m_z[0];
+                ++m_count;
+            }
+
+            for (int row = 0; row < 3; ++row) {
+                // local copies, they can't alias the coordinates
+                const float a = m_trafo[row][0];
+                const float b = m_trafo[row][1];
+                const float c = m_trafo[row][2];
+                const float d = m_trafo[row][3];
+                float       minimum[ExtentLanes];
+                float       maximum[ExtentLanes];
+
+                std::copy(m_minimum[row], m_minimum[row] + ExtentLanes, minimum);
+                std::copy(m_maximum[row], m_maximum[row] + ExtentLanes, maximum);
+
+                for (size_t i = 0; i < m_count; i += ExtentLanes) {
+                    for (size_t lane = 0; lane < ExtentLanes; ++lane) {
+                        float value = a * m_x[i + lane] + b * m_y[i + lane] + c * m_z[i + lane] + d;
+
+                        minimum[lane] = (value < minimum[lane]) ? value : minimum[lane];
+                        maximum[lane] = (value > maximum[lane]) ? value : maximum[lane];
+                    }
+                }
+
+                std::copy(minimum, minimum + ExtentLanes, m_minimum[row]);
+                std::copy(maximum, maximum + ExtentLanes, m_maximum[row]);
+            }
+
+            m_count = 0;
+            m_empty = false;
+        }
+    }
+};
+
+
 DisplayManager::DisplayManager
 (
-    QWidget* parent
+    QWidget*                      parent,
+    std::shared_ptr<SceneBuffers> scene
 ) : QOpenGLWidget(parent),
     QOpenGLFunctions(),
-    m_displayListId(0),
-    m_updateDisplayList(false),
+    m_scene(scene),
+    m_coarseDetail(false),
+    m_statistics(),
+    m_uploadStatistics(),
+    m_refining(false),
+    m_refineThread(),
+    m_renderThread(0),
     m_eyePoint(0.f, 0.f, 0.f),
     m_targetPoint(0.f, 0.f, -1.f),
     m_paintAction(PaintAction::None),
+    m_dragAction(DragAction::None),
+    m_pendingDrag(DragAction::None),
+    m_dragStart(),
+    m_dragApplied(),
+    m_dragCurrent(),
+    m_wheelZooms(),
+    m_dragBoxes(),
+    m_refineTimer(0),
+    m_frameCached(false),
+    m_cachedGeneration(0),
+    m_cachedTrafo(),
     m_trafoStack(),
     m_setDisplayAttributes(false),
     m_model(0),
@@ -83,6 +268,16 @@ DisplayManager::DisplayManager
     m_setAttributes(false) {
     QRect geometry = parent->geometry();
 
+    // the framebuffer keeps the last frame, paintGL() leaves it as it is if nothing has changed
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
+
+    // a zoom goes on with the coarse levels, the finer ones are asked for when it has come to rest
+    m_refineTimer = new QTimer(this);
+    m_refineTimer->setSingleShot(true);
+    m_refineTimer->setInterval(RefineDelay);
+    connect(m_refineTimer, &QTimer::timeout,
+            this,          [this]() { emit DetailNeeded(this); });
+
     m_displayMin = QPoint(geometry.x(), geometry.y());
     m_displayMax = QPoint(geometry.x() + geometry.width(), geometry.y() + geometry.height());
 
@@ -104,12 +299,26 @@ DisplayManager::DisplayManager
 
     m_displayUnit.setZ(1.f);
 
+    if (!m_scene)
+        m_scene = std::make_shared<SceneBuffers>();
+
+    m_scene->Attach(this);
+
     ResetTrafos();
     ResetAttributes();
 }
 
 
 DisplayManager::~DisplayManager(void) {
+    if (m_refineThread.joinable())
+        m_refineThread.join();
+
+    if (m_renderThread != 0)
+        m_renderThread->Forget(this);
+
+    makeCurrent();
+    m_scene->Detach(this);
+    doneCurrent();
 }
 
 
@@ -119,14 +328,41 @@ void DisplayManager::Flush(void) {
 
 
 void DisplayManager::Show(void) {
-    Redraw();
+    m_frameCached = false;
+    update();
 }
 
 
 void DisplayManager::Redraw(void) {
-    m_updateDisplayList = true;
+    m_scene->Invalidate();
+    m_scene->UpdateViews();
+}
+
+
+void DisplayManager::SetRenderThread
+(
+    RenderThread* renderThread
+) {
+    if ((m_renderThread != 0) && (m_renderThread != renderThread))
+        m_renderThread->Forget(this);
+
+    m_renderThread = renderThread;
+    Show();
+}
+
+
+void DisplayManager::FrameRendered
+(
+    const FrameStatistics& statistics
+) {
+    m_statistics = statistics;
+
+    if (m_statistics.coarseGroups > 0)
+        m_refineTimer->start();
 
+    // paintGL() presents it
     update();
+    emit FrameDrawn(this, m_statistics);
 }
 
 
@@ -140,6 +376,11 @@ void DisplayManager::SetToXYPlane(void) {
 }
 
 
+void DisplayManager::SetToIsometric(void) {
+    m_paintAction = PaintAction::IsometricFit;
+}
+
+
 void DisplayManager::SetToXZPlane(void) {
     m_paintAction = PaintAction::XzFit;
 }
@@ -249,10 +490,82 @@ GeometryModel* DisplayManager::SetModel
 
 
 void DisplayManager::Draw(void) {
-    for (std::list<Geometry*>::const_iterator it = m_model->Begin(); it != m_model->End(); ++it) {
-        if (*it != 0)
-            (*it)->Draw(*this);
+    // the snapshot stays as it is while the model changes
+    std::shared_ptr<const GeometryModel::GeometryList> geometries = m_model->Snapshot();
+
+    for (GeometryModel::GeometryList::const_iterator it = geometries->begin(); it != geometries->end(); ++it)
+        (*it)->Draw(*this);
+}
+
+
+// the thread holds the geometries of the current snapshot, they don't change while it records them
+// the levels are swapped in only if the scene hasn't been recorded anew in between
+void DisplayManager::RefineDetail
+(
+    const std::vector<const Geometry*>& geometries
+) {
+    if (m_refining || geometries.empty() || !m_scene->Valid())
+        return;
+
+    if (m_refineThread.joinable())
+        m_refineThread.join();
+
+    std::shared_ptr<const GeometryModel::GeometryList> snapshot = m_model->Snapshot();
+    std::vector<const Geometry*>                       sorted(geometries);
+    std::vector<const Geometry*>                       originals;
+    GeometryModel::GeometryList                        recorded;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    for (GeometryModel::GeometryList::const_iterator it = snapshot->begin(); it != snapshot->end(); ++it) {
+        if (std::binary_search(sorted.begin(), sorted.end(), it->get())) {
+            originals.push_back(it->get());
+            recorded.push_back(*it);
+        }
     }
+
+    float  detailTolerance = m_scene->DetailTolerance();
+    size_t generation      = m_scene->Generation();
+
+    m_refining     = true;
+    m_refineThread = std::thread([this, originals, recorded, detailTolerance, generation]() {
+        std::shared_ptr<std::vector<SceneRecording> > recordings = std::make_shared<std::vector<SceneRecording> >(recorded.size());
+
+        // all parts of a geometry in one recording, it replaces the geometry's groups at once
+        for (size_t i = 0; i < recorded.size(); ++i) {
+            for (size_t part = 0; part < recorded[i]->Parts(); ++part)
+                RecordGeometry(*this, *recorded[i], part, detailTolerance, (*recordings)[i]);
+        }
+
+        // back on the UI thread, with the context of the buffers
+        // the geometries are held until then, a new one at the address of a replaced one would be taken for it
+        QMetaObject::invokeMethod(this, [this, originals, recorded, recordings, generation]() {
+            m_refining = false;
+
+            if (m_scene->Valid() && (m_scene->Generation() == generation)) {
+                makeCurrent();
+
+                {
+                    std::lock_guard<std::mutex> lock(m_scene->Mutex());
+
+                    m_scene->Refine(originals, *recordings, m_uploadStatistics);
+                }
+
+                doneCurrent();
+                m_scene->UpdateViews();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+
+std::shared_ptr<SceneBuffers> DisplayManager::Scene(void) const {
+    return m_scene;
+}
+
+
+const FrameStatistics& DisplayManager::Statistics(void) const {
+    return m_statistics;
 }
 
 
@@ -261,15 +574,64 @@ void DisplayManager::ModelMinMax
     QVector3D& minCorner,
     QVector3D& maxCorner
 ) const {
-    for (std::list<Geometry*>::const_iterator it = m_model->Begin(); it != m_model->End(); ++it) {
-        if (*it != 0)
-            (*it)->MinMax(minCorner, maxCorner);
+    std::shared_ptr<const GeometryModel::GeometryList> geometries = m_model->Snapshot();
+
+    for (GeometryModel::GeometryList::const_iterator it = geometries->begin(); it != geometries->end(); ++it)
+        (*it)->MinMax(minCorner, maxCorner);
+}
+
+
+void DisplayManager::ProjectedMinMax
+(
+    const QMatrix4x4& trafo,
+    QVector3D&        minCorner,
+    QVector3D&        maxCorner
+) const {
+    std::shared_ptr<const GeometryModel::GeometryList> geometries = m_model->Snapshot();
+    BoundingBox                                        empty      = {QVector3D(MaxFloat, MaxFloat, MaxFloat), QVector3D(-MaxFloat, -MaxFloat, -MaxFloat)};
+    std::vector<BoundingBox>                           extents(geometries->size(), empty);
+
+    // the geometries are reduced in parallel, their extents sequentially
+    ParallelFor(geometries->size(), [&geometries, &trafo, &extents](size_t i) {
+        ProjectedExtentCallback callback(trafo);
+
+        (*geometries)[i]->Primitives(callback);
+
+        // a released plot has no primitives left, but its bounding box
+        if (callback.Empty()) {
+            QVector3D boxMin(MaxFloat, MaxFloat, MaxFloat);
+            QVector3D boxMax(-MaxFloat, -MaxFloat, -MaxFloat);
+
+            (*geometries)[i]->MinMax(boxMin, boxMax);
+
+            if (boxMin.x() <= boxMax.x()) {
+                for (int corner = 0; corner < 8; ++corner)
+                    callback.Point(QVector3D((corner & 1) ? boxMax.x() : boxMin.x(),
+                                             (corner & 2) ? boxMax.y() : boxMin.y(),
+                                             (corner & 4) ? boxMax.z() : boxMin.z()));
+            }
+        }
+
+        callback.Extent(extents[i].minCorner, extents[i].maxCorner);
+    });
+
+    for (std::vector<BoundingBox>::const_iterator it = extents.begin(); it != extents.end(); ++it) {
+        if (it->minCorner.x() <= it->maxCorner.x()) {
+            minCorner.setX(std::min(minCorner.x(), it->minCorner.x()));
+            minCorner.setY(std::min(minCorner.y(), it->minCorner.y()));
+            minCorner.setZ(std::min(minCorner.z(), it->minCorner.z()));
+
+            maxCorner.setX(std::max(maxCorner.x(), it->maxCorner.x()));
+            maxCorner.setY(std::max(maxCorner.y(), it->maxCorner.y()));
+            maxCorner.setZ(std::max(maxCorner.z(), it->maxCorner.z()));
+        }
     }
 }
 
 
 void DisplayManager::initializeGL(void) {
     initializeOpenGLFunctions();
+    m_frameCached = false;
     glClearColor(1.f, 1.f, 1.f, 1.f);
     SetDisplayProjection();
     glColor4f(0.5f, 0.5f, 0.5f, 1.f);
@@ -291,340 +653,282 @@ void DisplayManager::initializeGL(void) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    m_displayListId = glGenLists(1);
 }
 
 
 void DisplayManager::paintGL(void) {
-    if (m_updateDisplayList) {
-        m_updateDisplayList = false;
-
-        glNewList(m_displayListId, GL_COMPILE);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glColor4f(0.5f, 0.5f, 0.5f, 1.f);
+    QElapsedTimer timer;
+    timer.start();
 
-        QMatrix4x4 inverse = m_trafoStack[Devicemm2Device].inverted();
-        m_trafoStack[Devicemm2Device] = QMatrix4x4();
-        m_trafoStack[Devicemm2Device].scale(m_displayUnit);
-        PropagateTrafo(Devicemm2Device, inverse);
+    m_trafoStack.SetScale(Devicemm2Device, m_displayUnit);
 
-        m_setDisplayAttributes = true;
+    ApplyPaintAction();
+    ApplyPendingInput();
 
-        if (m_paintAction == PaintAction::XyFit) {
-            ResetTrafos();
-            ResetAttributes();
-
-            QVector3D minCorner(MaxFloat, MaxFloat, MaxFloat);
-            QVector3D maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
-            ModelMinMax(minCorner, maxCorner);
+    // the reduced representation of a drag is fast enough for this thread
+    if ((m_renderThread != 0) && (m_dragAction == DragAction::None)) {
+        PresentRendered();
+        return;
+    }
 
-            if (minCorner.x() > maxCorner.x()) {
-                minCorner.setX(0.f);
-                maxCorner.setX(0.f);
-            }
+    // neither the model nor the view has changed: the framebuffer shows the frame still
+    if (m_frameCached && (m_dragAction == DragAction::None) && m_scene->Valid() &&
+        (m_cachedGeneration == m_scene->Generation()) && (m_cachedTrafo == m_trafoStack.Forward(ParallelProjection)))
+        return;
 
-            if (minCorner.y() > maxCorner.y()) {
-                minCorner.setY(0.f);
-                maxCorner.setY(0.f);
-            }
+    m_statistics       = m_uploadStatistics;
+    m_uploadStatistics = FrameStatistics();
 
-            if (minCorner.z() > maxCorner.z()) {
-                minCorner.setZ(0.f);
-                maxCorner.setZ(0.f);
-            }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glColor4f(0.5f, 0.5f, 0.5f, 1.f);
 
-            QVector3D modelCenter = (minCorner + maxCorner) / 2.f;
-            QVector3D modelSize   = maxCorner - minCorner;
-            QVector3D eyePoint(modelCenter.x(), modelCenter.y(), maxCorner.z());
-            QVector3D targetPoint = modelCenter;
+    // the geometry is in model coordinates, the view is applied here
+    // this way a changed projection doesn't require a new upload
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(m_trafoStack.Forward(ParallelProjection).constData());
 
-            if (modelSize.z() == 0.f)
-                targetPoint.setZ(targetPoint.z() - 1.f);
+    if (m_dragAction != DragAction::None)
+        DrawReduced();
+    else {
+        // the first view of the share group which gets here uploads the model for all of them
+        if (!m_scene->Valid())
+            Record(m_statistics);
 
-            EyePoint(eyePoint);
-            TargetPoint(targetPoint);
+        QVector3D viewMin;
+        QVector3D viewMax;
 
-            QVector3D minModel = Display2Model(m_displayMin);
-            QVector3D maxModel = Display2Model(m_displayMax);
+        ViewVolume(viewMin, viewMax);
+        ResetAttributes();
+        m_scene->Draw(m_trafoStack.Forward(ParallelProjection), viewMin, viewMax, m_statistics);
 
-            if (minModel.x() > maxModel.x()) {
-                double temp = minModel.x();
+        if (m_statistics.coarseGroups > 0)
+            m_refineTimer->start();
+    }
 
-                minModel.setX(maxModel.x());
-                maxModel.setX(temp);
-            }
+    // the reduced representation is for the drag only
+    m_frameCached      = (m_dragAction == DragAction::None);
+    m_cachedGeneration = m_scene->Generation();
+    m_cachedTrafo      = m_trafoStack.Forward(ParallelProjection);
 
-            if (minModel.y() > maxModel.y()) {
-                double temp = minModel.y();
+    m_statistics.frameTime = timer.nsecsElapsed();
+    emit FrameDrawn(this, m_statistics);
+}
 
-                minModel.setY(maxModel.y());
-                maxModel.setY(temp);
-            }
 
-            QVector3D center = (minModel + maxModel) / 2.f;
-            double    dX     = maxModel.x() - minModel.x();
-            double    dY     = maxModel.y() - minModel.y();
-            double    fX     = 1.;
-            double    fY     = 1.;
+// every part of a geometry is converted and recorded on a worker thread, the merging keeps their order
+// a wave of parts at a time, this way the recordings hold neither a copy of the whole model nor one of a large geometry
+void DisplayManager::Record
+(
+    FrameStatistics& statistics
+) {
+    m_scene->Clear();
 
-            if (modelSize.x() > SmallFloat)
-                fX = dX / modelSize.x();
+    m_setDisplayAttributes = true;
+    ResetAttributes();
 
-            if (modelSize.y() > SmallFloat)
-                fY = dY / modelSize.y();
+    std::shared_ptr<const GeometryModel::GeometryList> geometries      = m_model->Snapshot();
+    float                                              detailTolerance = m_scene->DetailTolerance();
+    size_t                                             waveSize        = RecordingWave * WorkerCount();
+    std::vector<std::pair<const Geometry*, size_t> >   parts;
 
-            ShiftOnDisplay(center);
-            ScaleOnDisplay(std::min(fX, fY));
-            ShiftOnDisplay(-eyePoint);
-        }
-        else if (m_paintAction == PaintAction::XzFit) {
-            ResetTrafos();
-            ResetAttributes();
+    for (GeometryModel::GeometryList::const_iterator it = geometries->begin(); it != geometries->end(); ++it) {
+        for (size_t part = 0; part < (*it)->Parts(); ++part)
+            parts.push_back(std::make_pair(it->get(), part));
+    }
 
-            QVector3D minCorner(MaxFloat, MaxFloat, MaxFloat);
-            QVector3D maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
-            ModelMinMax(minCorner, maxCorner);
+    for (size_t first = 0; first < parts.size(); first += waveSize) {
+        size_t                       count = std::min(waveSize, parts.size() - first);
+        std::vector<SceneRecording>  recordings(count);
+        std::vector<const Geometry*> owners(count);
 
-            if (minCorner.x() > maxCorner.x()) {
-                minCorner.setX(0.f);
-                maxCorner.setX(0.f);
-            }
+        ParallelFor(count, [this, &parts, &recordings, first, detailTolerance](size_t i) {
+            RecordGeometry(*this, *parts[first + i].first, parts[first + i].second, detailTolerance, recordings[i]);
+        });
 
-            if (minCorner.y() > maxCorner.y()) {
-                minCorner.setY(0.f);
-                maxCorner.setY(0.f);
-            }
+        for (size_t i = 0; i < count; ++i)
+            owners[i] = parts[first + i].first;
 
-            if (minCorner.z() > maxCorner.z()) {
-                minCorner.setZ(0.f);
-                maxCorner.setZ(0.f);
-            }
+        m_scene->Merge(recordings, owners);
+    }
 
-            QVector3D modelCenter = (minCorner + maxCorner) / 2.f;
-            QVector3D modelSize   = maxCorner - minCorner;
-            QVector3D eyePoint(modelCenter.x(), minCorner.y(), modelCenter.z());
-            QVector3D targetPoint = modelCenter;
+    m_scene->Upload(statistics);
+}
 
-            if (modelSize.y() == 0.f)
-                targetPoint.setY(targetPoint.y() + 1.f);
 
-            EyePoint(eyePoint);
-            TargetPoint(targetPoint);
+// the view volume in device coordinates as set in SetDisplayProjection()
+void DisplayManager::ViewVolume
+(
+    QVector3D& viewMin,
+    QVector3D& viewMax
+) const {
+    viewMin = QVector3D(std::min(m_displayMin.x(), m_displayMax.x()), std::min(m_displayMin.y(), m_displayMax.y()), -DepthRange);
+    viewMax = QVector3D(std::max(m_displayMin.x(), m_displayMax.x()), std::max(m_displayMin.y(), m_displayMax.y()), DepthRange);
+}
 
-            QVector3D minModel = Display2Model(m_displayMin);
-            QVector3D maxModel = Display2Model(m_displayMax);
 
-            if (minModel.x() > maxModel.x()) {
-                double temp = minModel.x();
+void DisplayManager::PresentRendered(void) {
+    FrameStatistics uploadStatistics = m_uploadStatistics;
 
-                minModel.setX(maxModel.x());
-                maxModel.setX(temp);
-            }
+    m_uploadStatistics = FrameStatistics();
 
-            if (minModel.z() > maxModel.z()) {
-                double temp = minModel.z();
+    // the recording stays on this thread, the render thread waits for it
+    if (!m_scene->Valid()) {
+        std::lock_guard<std::mutex> lock(m_scene->Mutex());
 
-                minModel.setZ(maxModel.z());
-                maxModel.setZ(temp);
-            }
+        Record(uploadStatistics);
 
-            QVector3D center = (minModel + maxModel) / 2.f;
-            double    dX     = maxModel.x() - minModel.x();
-            double    dZ     = maxModel.z() - minModel.z();
-            double    fX     = 1.;
-            double    fZ     = 1.;
+        // the render thread's context has to see the buffers complete
+        glFinish();
+    }
 
-            if (modelSize.x() > SmallFloat)
-                fX = dX / modelSize.x();
+    QMatrix4x4 model2Display = m_trafoStack.Forward(ParallelProjection);
+    QMatrix4x4 projection;
 
-            if (modelSize.z() > SmallFloat)
-                fZ = dZ / modelSize.z();
+    projection.ortho(m_displayMin.x(), m_displayMax.x(), m_displayMax.y(), m_displayMin.y(), -DepthRange, DepthRange);
 
-            ShiftOnDisplay(center);
-            ScaleOnDisplay(std::min(fX, fZ));
-            ShiftOnDisplay(-eyePoint);
-        }
-        else if (m_paintAction == PaintAction::YzFit) {
-            ResetTrafos();
-            ResetAttributes();
+    if (!m_frameCached || (m_cachedGeneration != m_scene->Generation()) || (m_cachedTrafo != model2Display)) {
+        RenderThread::Frame frame;
 
-            QVector3D minCorner(MaxFloat, MaxFloat, MaxFloat);
-            QVector3D maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
-            ModelMinMax(minCorner, maxCorner);
+        frame.view          = this;
+        frame.size          = size() * devicePixelRatioF();
+        frame.projection    = projection;
+        frame.model2Display = model2Display;
+        frame.statistics    = uploadStatistics;
+        ViewVolume(frame.viewMin, frame.viewMax);
 
-            if (minCorner.x() > maxCorner.x()) {
-                minCorner.setX(0.f);
-                maxCorner.setX(0.f);
-            }
+        m_renderThread->Post(frame);
 
-            if (minCorner.y() > maxCorner.y()) {
-                minCorner.setY(0.f);
-                maxCorner.setY(0.f);
-            }
+        m_frameCached      = true;
+        m_cachedGeneration = m_scene->Generation();
+        m_cachedTrafo      = model2Display;
+    }
 
-            if (minCorner.z() > maxCorner.z()) {
-                minCorner.setZ(0.f);
-                maxCorner.setZ(0.f);
-            }
+    // the last finished frame until the posted one is done
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_renderThread->Present(this, projection, model2Display);
+}
 
-            QVector3D modelCenter = (minCorner + maxCorner) / 2.f;
-            QVector3D modelSize   = maxCorner - minCorner;
-            QVector3D eyePoint(maxCorner.x(), modelCenter.y(), modelCenter.z());
-            QVector3D targetPoint = modelCenter;
 
-            if (modelSize.x() == 0.f)
-                targetPoint.setX(targetPoint.x() - 1.f);
+void DisplayManager::ApplyPaintAction(void) {
+    if (m_paintAction == PaintAction::Fit)
+        FitView(TargetPoint() - EyePoint());
+    else if (m_paintAction != PaintAction::None) {
+        ResetTrafos();
+        ResetAttributes();
 
-            EyePoint(eyePoint);
-            TargetPoint(targetPoint);
+        if (m_paintAction == PaintAction::XyFit)
+            FitView(QVector3D(0.f, 0.f, -1.f));
+        else if (m_paintAction == PaintAction::XzFit)
+            FitView(QVector3D(0.f, 1.f, 0.f));
+        else if (m_paintAction == PaintAction::YzFit)
+            FitView(QVector3D(-1.f, 0.f, 0.f));
+        else
+            FitView(QVector3D(-1.f, -1.f, -1.f));
+    }
 
-            QVector3D minModel = Display2Model(m_displayMin);
-            QVector3D maxModel = Display2Model(m_displayMax);
+    m_paintAction = PaintAction::None;
+}
 
-            if (minModel.y() > maxModel.y()) {
-                double temp = minModel.y();
 
-                minModel.setY(maxModel.y());
-                maxModel.setY(temp);
-            }
+void DisplayManager::FitView
+(
+    const QVector3D& direction
+) {
+    QVector3D minCorner(MaxFloat, MaxFloat, MaxFloat);
+    QVector3D maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
+    ModelMinMax(minCorner, maxCorner);
 
-            if (minModel.z() > maxModel.z()) {
-                double temp = minModel.z();
+    QVector3D modelCenter(0.f, 0.f, 0.f);
+    float     radius = 1.f;
 
-                minModel.setZ(maxModel.z());
-                maxModel.setZ(temp);
-            }
+    if (minCorner.x() <= maxCorner.x()) {
+        modelCenter = (minCorner + maxCorner) / 2.f;
+        radius      = std::max((maxCorner - minCorner).length() / 2.f, radius);
+    }
 
-            QVector3D center = (minModel + maxModel) / 2.f;
-            double    dY     = maxModel.y() - minModel.y();
-            double    dZ     = maxModel.z() - minModel.z();
-            double    fY     = 1.;
-            double    fZ     = 1.;
+    QVector3D cameraDirection = direction.normalized();
 
-            if (modelSize.y() > SmallFloat)
-                fY = dY / modelSize.y();
+    if (cameraDirection.length() < SmallFloat)
+        cameraDirection = QVector3D(0.f, 0.f, -1.f);
 
-            if (modelSize.z() > SmallFloat)
-                fZ = dZ / modelSize.z();
+    // the eye on the model's bounding sphere, i.e. the model is in front of it
+    EyePoint(modelCenter - radius * cameraDirection);
+    TargetPoint(modelCenter);
 
-            ShiftOnDisplay(center);
-            ScaleOnDisplay(std::min(fY, fZ));
-            ShiftOnDisplay(-eyePoint);
-        }
-        else if (m_paintAction == PaintAction::Fit) {
-            QVector3D minCorner(MaxFloat, MaxFloat, MaxFloat);
-            QVector3D maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
-            ModelMinMax(minCorner, maxCorner);
-
-            if (minCorner.x() > maxCorner.x()) {
-                minCorner.setX(0.f);
-                maxCorner.setX(0.f);
-            }
+    // the exact extent of the vertices on the display, including the rotations on the display
+    QVector3D displayMin(MaxFloat, MaxFloat, MaxFloat);
+    QVector3D displayMax(-MaxFloat, -MaxFloat, -MaxFloat);
+    ProjectedMinMax(Model2DisplayTrafo(), displayMin, displayMax);
 
-            if (minCorner.y() > maxCorner.y()) {
-                minCorner.setY(0.f);
-                maxCorner.setY(0.f);
-            }
-
-            if (minCorner.z() > maxCorner.z()) {
-                minCorner.setZ(0.f);
-                maxCorner.setZ(0.f);
-            }
+    if (displayMin.x() > displayMax.x()) {
+        displayMin = Model2DisplayTrafo().map(modelCenter);
+        displayMax = displayMin;
+    }
 
-            QVector3D modelCenter     = (minCorner + maxCorner) / 2.f;
-            QVector3D modelSize       = maxCorner - minCorner;
-            QVector3D cameraDirection = TargetPoint() - EyePoint();
+    // as in Zoom() with the extent as the rectangle
+    QVector3D extent = displayMax - displayMin;
+    double    fX     = MaxFloat;
+    double    fY     = MaxFloat;
 
-            cameraDirection.normalize();
+    if (extent.x() > SmallFloat)
+        fX = (m_displayMax.x() - m_displayMin.x()) / extent.x();
 
-            QVector3D eyePoint = modelCenter - cameraDirection;
-            double    length   = 0.;
+    if (extent.y() > SmallFloat)
+        fY = (m_displayMax.y() - m_displayMin.y()) / extent.y();
 
-            if ((fabs(cameraDirection.x()) > fabs(cameraDirection.y())) && (fabs(cameraDirection.x()) > fabs(cameraDirection.z()))) {
-                if (cameraDirection.x() < 0.) {
-                    if (eyePoint.x() <= maxCorner.x())
-                        length = (maxCorner.x() - eyePoint.x()) / cameraDirection.x() - 1.;
-                }
-                else {
-                    if (eyePoint.x() >= minCorner.x())
-                        length = (minCorner.x() - eyePoint.x()) / cameraDirection.x() - 1.;
-                }
-            }
-            else if (fabs(cameraDirection.z()) > fabs(cameraDirection.y())) {
-                if (cameraDirection.z() < 0.) {
-                    if (eyePoint.z() <= maxCorner.z())
-                        length = (maxCorner.z() - eyePoint.z()) / cameraDirection.z() - 1.;
-                }
-                else {
-                    if (eyePoint.z() >= minCorner.z())
-                        length = (minCorner.z() - eyePoint.z()) / cameraDirection.z() - 1.;
-                }
-            }
-            else {
-                if (cameraDirection.y() < 0.) {
-                    if (eyePoint.y() <= maxCorner.y())
-                        length = (maxCorner.y() - eyePoint.y()) / cameraDirection.y() - 1.;
-                }
-                else {
-                    if (eyePoint.y() >= minCorner.y())
-                        length = (minCorner.y() - eyePoint.y()) / cameraDirection.y() - 1.;
-                }
-            }
+    QVector3D extentCentre = Display2ModelTrafo().map(QVector3D((displayMin.x() + displayMax.x()) / 2.f, (displayMin.y() + displayMax.y()) / 2.f, 0.f));
 
-            eyePoint += length * cameraDirection;
+    ShiftOnDisplay(extentCentre);
 
-            EyePoint(eyePoint);
-            TargetPoint(modelCenter);
+    if (std::min(fX, fY) < MaxFloat)
+        ScaleOnDisplay(std::min(fX, fY));
 
-            QVector3D minModel = Display2Model(m_displayMin);
-            QVector3D maxModel = Display2Model(m_displayMax);
+    QVector3D deviceCentre = Display2Model((m_displayMin + m_displayMax) / 2.f);
+    ShiftOnDisplay(deviceCentre - extentCentre);
+}
 
-            if (minModel.x() > maxModel.x()) {
-                double temp = minModel.x();
 
-                minModel.setX(maxModel.x());
-                maxModel.setX(temp);
-            }
+void DisplayManager::ApplyPendingInput(void) {
+    if (m_dragCurrent != m_dragApplied) {
+        if (m_pendingDrag == DragAction::Rotate)
+            ArcRotate(m_dragApplied, m_dragCurrent);
+        else if (m_pendingDrag == DragAction::Shift)
+            Shift(m_dragApplied, m_dragCurrent);
 
-            if (minModel.y() > maxModel.y()) {
-                double temp = minModel.y();
+        m_dragApplied = m_dragCurrent;
+    }
 
-                minModel.setY(maxModel.y());
-                maxModel.setY(temp);
-            }
+    m_pendingDrag = m_dragAction;
 
-            if (minModel.z() > maxModel.z()) {
-                double temp = minModel.z();
+    for (std::vector<WheelZoom>::const_iterator it = m_wheelZooms.begin(); it != m_wheelZooms.end(); ++it)
+        Zoom(it->centre, it->scale);
 
-                minModel.setZ(maxModel.z());
-                maxModel.setZ(temp);
-            }
+    m_wheelZooms.clear();
+}
 
-            QVector3D center = (minModel + maxModel) / 2.f;
-            double    dX     = maxModel.x() - minModel.x();
-            double    dY     = maxModel.y() - minModel.y();
-            double    fX     = 1.;
-            double    fY     = 1.;
 
-            if (modelSize.x() > SmallFloat)
-                fX = dX / modelSize.x();
+void DisplayManager::DrawReduced(void) {
+    ResetAttributes();
 
-            if (modelSize.y() > SmallFloat)
-                fY = dY / modelSize.y();
+    for (std::vector<BoundingBox>::const_iterator it = m_dragBoxes.begin(); it != m_dragBoxes.end(); ++it) {
+        const QVector3D& a = it->minCorner;
+        const QVector3D& b = it->maxCorner;
 
-            ShiftOnDisplay(center);
-            ScaleOnDisplay(std::min(fX, fY));
-            ShiftOnDisplay(-eyePoint);
-        }
+        DrawLine(QVector3D(a.x(), a.y(), a.z()), QVector3D(b.x(), a.y(), a.z()));
+        DrawLine(QVector3D(b.x(), a.y(), a.z()), QVector3D(b.x(), b.y(), a.z()));
+        DrawLine(QVector3D(b.x(), b.y(), a.z()), QVector3D(a.x(), b.y(), a.z()));
+        DrawLine(QVector3D(a.x(), b.y(), a.z()), QVector3D(a.x(), a.y(), a.z()));
 
-        m_paintAction = PaintAction::None;
+        DrawLine(QVector3D(a.x(), a.y(), b.z()), QVector3D(b.x(), a.y(), b.z()));
+        DrawLine(QVector3D(b.x(), a.y(), b.z()), QVector3D(b.x(), b.y(), b.z()));
+        DrawLine(QVector3D(b.x(), b.y(), b.z()), QVector3D(a.x(), b.y(), b.z()));
+        DrawLine(QVector3D(a.x(), b.y(), b.z()), QVector3D(a.x(), a.y(), b.z()));
 
-        Draw();
-        glEndList();
+        DrawLine(QVector3D(a.x(), a.y(), a.z()), QVector3D(a.x(), a.y(), b.z()));
+        DrawLine(QVector3D(b.x(), a.y(), a.z()), QVector3D(b.x(), a.y(), b.z()));
+        DrawLine(QVector3D(b.x(), b.y(), a.z()), QVector3D(b.x(), b.y(), b.z()));
+        DrawLine(QVector3D(a.x(), b.y(), a.z()), QVector3D(a.x(), b.y(), b.z()));
     }
-
-    glCallList(m_displayListId);
 }
 
 
@@ -637,13 +941,122 @@ void DisplayManager::resizeGL
     m_displayMax.setY(m_displayMin.y() + height);
 
     SetDisplayProjection();
+    m_frameCached = false; // the framebuffer is new
+}
+
+
+void DisplayManager::mousePressEvent
+(
+    QMouseEvent* event
+) {
+    if (m_dragAction == DragAction::None) {
+        if ((event->button() == Qt::LeftButton) && ((event->modifiers() & Qt::ShiftModifier) == 0))
+            m_dragAction = DragAction::Rotate;
+        else if ((event->button() == Qt::LeftButton) || (event->button() == Qt::MiddleButton) || (event->button() == Qt::RightButton))
+            m_dragAction = DragAction::Shift;
+
+        if (m_dragAction != DragAction::None) {
+            emit Activated(this);
+
+            m_dragStart   = DisplayPoint(event->pos());
+            m_dragApplied = m_dragStart;
+            m_dragCurrent = m_dragStart;
+            m_pendingDrag = m_dragAction;
+
+            // the bounding boxes don't change during the drag
+            m_dragBoxes.clear();
+
+            if (m_model != 0) {
+                std::shared_ptr<const GeometryModel::GeometryList> geometries = m_model->Snapshot();
+
+                for (GeometryModel::GeometryList::const_iterator it = geometries->begin(); it != geometries->end(); ++it) {
+                    BoundingBox box = {QVector3D(MaxFloat, MaxFloat, MaxFloat), QVector3D(-MaxFloat, -MaxFloat, -MaxFloat)};
+
+                    (*it)->MinMax(box.minCorner, box.maxCorner);
+
+                    if (box.minCorner.x() <= box.maxCorner.x())
+                        m_dragBoxes.push_back(box);
+                }
+            }
+
+            event->accept();
+            return;
+        }
+    }
+
+    QOpenGLWidget::mousePressEvent(event);
+}
+
+
+void DisplayManager::mouseMoveEvent
+(
+    QMouseEvent* event
+) {
+    if (m_dragAction != DragAction::None) {
+        // the movement will be applied with the next frame,
+        // all events until then collapse into one view change
+        m_dragCurrent = DisplayPoint(event->pos());
+        update();
+        event->accept();
+    }
+    else
+        QOpenGLWidget::mouseMoveEvent(event);
+}
+
+
+void DisplayManager::mouseReleaseEvent
+(
+    QMouseEvent* event
+) {
+    if (m_dragAction != DragAction::None) {
+        // the last movement is applied with the next frame too
+        m_dragCurrent = DisplayPoint(event->pos());
+        m_dragAction  = DragAction::None;
+        m_dragBoxes.clear();
+        update();
+        event->accept();
+
+        // a click, not a drag
+        if ((m_dragCurrent - m_dragStart).manhattanLength() <= ClickTolerance)
+            emit Clicked(this, m_dragCurrent);
+    }
+    else
+        QOpenGLWidget::mouseReleaseEvent(event);
+}
+
+
+void DisplayManager::wheelEvent
+(
+    QWheelEvent* event
+) {
+    // one notch of a standard mouse wheel is 120, and zooms by 20 %
+    double steps = event->angleDelta().y() / 120.;
+
+    if (steps != 0.) {
+        QPoint centre = DisplayPoint(event->pos());
+        double scale  = pow(1.2, steps);
+
+        // a zoom around another centre is queued too, paintGL() applies them all
+        if (!m_wheelZooms.empty() && (m_wheelZooms.back().centre == centre))
+            m_wheelZooms.back().scale *= scale;
+        else {
+            WheelZoom zoom = {centre, scale};
+
+            m_wheelZooms.push_back(zoom);
+        }
+
+        update();
+        event->accept();
+    }
+    else
+        QOpenGLWidget::wheelEvent(event);
 }
 
 
 void DisplayManager::SetDisplayProjection(void) {
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    glOrtho(m_displayMin.x(), m_displayMax.x(), m_displayMax.y(), m_displayMin.y(), -1000000., 1000000.);
+    glOrtho(m_displayMin.x(), m_displayMax.x(), m_displayMax.y(), m_displayMin.y(), -DepthRange, DepthRange);
     glPushMatrix();
 }
 
@@ -670,31 +1083,73 @@ void DisplayManager::DrawPoint
 (
     const QVector3D& point
 ) {
-    QVector3D devicePoint = m_trafoStack.back().map(point);
+    // the recording is in model coordinates, there are no trafos to apply
+    if (CurrentRecording != 0) {
+        CurrentRecording->recording->AddPoint(point, CurrentRecording->attributeStack.back().color);
+        return;
+    }
+
+    if (m_coarseDetail)
+        return;
+
+    QVector3D modelPoint = point;
+
+    if (m_trafoStack.Size() > UserDefined)
+        modelPoint = UserTrafo().map(point);
 
     SetAttributes();
 
     glBegin(GL_POINTS);
     glNormal3f(0.f, 0.f, 1.f);
-    glVertex3f(devicePoint.x(), devicePoint.y(), devicePoint.z());
+    glVertex3f(modelPoint.x(), modelPoint.y(), modelPoint.z());
     glEnd();
 }
 
 
+void DisplayManager::DrawPoints
+(
+    const QVector3D* points,
+    size_t           count
+) {
+    // the recording takes them at once, with the colour and the batch looked up only once
+    if (CurrentRecording != 0)
+        CurrentRecording->recording->AddPoints(points, count, CurrentRecording->attributeStack.back().color);
+    else {
+        for (size_t i = 0; i < count; ++i)
+            DrawPoint(points[i]);
+    }
+}
+
+
 void DisplayManager::DrawLine
 (
     const QVector3D& start,
     const QVector3D& end
 ) {
-    QVector3D deviceStart = m_trafoStack.back().map(start);
-    QVector3D deviceEnd   = m_trafoStack.back().map(end);
+    if (CurrentRecording != 0) {
+        CurrentRecording->recording->AddLine(start, end, CurrentRecording->attributeStack.back().color);
+        return;
+    }
+
+    if (m_coarseDetail)
+        return;
+
+    QVector3D modelStart = start;
+    QVector3D modelEnd   = end;
+
+    if (m_trafoStack.Size() > UserDefined) {
+        QMatrix4x4 trafo = UserTrafo();
+
+        modelStart = trafo.map(start);
+        modelEnd   = trafo.map(end);
+    }
 
     SetAttributes();
 
     glBegin(GL_LINES);
     glNormal3f(0.f, 0.f, 1.f);
-    glVertex3f(deviceStart.x(), deviceStart.y(), deviceStart.z());
-    glVertex3f(deviceEnd.x(), deviceEnd.y(), deviceEnd.z());
+    glVertex3f(modelStart.x(), modelStart.y(), modelStart.z());
+    glVertex3f(modelEnd.x(), modelEnd.y(), modelEnd.z());
     glEnd();
 }
 
@@ -705,13 +1160,23 @@ void DisplayManager::DrawTriangle
     const QVector3D& b,
     const QVector3D& c
 ) {
-    QVector3D deviceA = m_trafoStack.back().map(a);
-    QVector3D deviceB = m_trafoStack.back().map(b);
-    QVector3D deviceC = m_trafoStack.back().map(c);
+    if ((CurrentRecording == 0) && m_coarseDetail)
+        return;
 
-    SetAttributes();
+    QVector3D modelA = a;
+    QVector3D modelB = b;
+    QVector3D modelC = c;
 
-    QVector3D normal = QVector3D::crossProduct(deviceB - deviceA, deviceC - deviceA);
+    if ((CurrentRecording == 0) && (m_trafoStack.Size() > UserDefined)) {
+        QMatrix4x4 trafo = UserTrafo();
+
+        modelA = trafo.map(a);
+        modelB = trafo.map(b);
+        modelC = trafo.map(c);
+    }
+
+    // the back faces are handled by the two-sided lighting
+    QVector3D normal = QVector3D::crossProduct(modelB - modelA, modelC - modelA);
     float     length = normal.length();
 
     if (length > SmallFloat)
@@ -719,46 +1184,99 @@ void DisplayManager::DrawTriangle
     else
         normal = QVector3D(0.f, 0.f, 1.f);
 
-    if (normal.z() < 0.f)
-        normal *= -1.f;
+    if (CurrentRecording != 0) {
+        CurrentRecording->recording->AddTriangle(modelA, modelB, modelC, normal, CurrentRecording->attributeStack.back().color);
+        return;
+    }
+
+    SetAttributes();
 
     glBegin(GL_TRIANGLES);
     glNormal3f(normal.x(), normal.y(), normal.z());
-    glVertex3f(deviceA.x(), deviceA.y(), deviceA.z());
-    glVertex3f(deviceB.x(), deviceB.y(), deviceB.z());
-    glVertex3f(deviceC.x(), deviceC.y(), deviceC.z());
+    glVertex3f(modelA.x(), modelA.y(), modelA.z());
+    glVertex3f(modelB.x(), modelB.y(), modelB.z());
+    glVertex3f(modelC.x(), modelC.y(), modelC.z());
     glEnd();
 }
 
 
-void DisplayManager::EyePoint
+void DisplayManager::BeginDetailLevels(void) {
+    if (CurrentRecording != 0)
+        CurrentRecording->recording->BeginDetailGroup();
+    else
+        m_coarseDetail = false;
+}
+
+
+void DisplayManager::DetailLevel
 (
-    const QVector3D& point
+    float tolerance
 ) {
-    QMatrix4x4 inverse = m_trafoStack[ParallelProjection].inverted();
+    if (CurrentRecording != 0)
+        CurrentRecording->recording->DetailLevel(tolerance);
+    else
+        m_coarseDetail = (tolerance > 0.f);
+}
 
-    if (m_trafoStack.size() > (ParallelProjection + 1)) {
-        QMatrix4x4 trafo = inverse * m_trafoStack.back();
 
-        m_eyePoint = trafo.map(point);
+// immediately only the exact level is drawn, like the coarse levels of a detail group are skipped
+void DisplayManager::DrawNestedPoints
+(
+    const QVector3D*           points,
+    const std::vector<float>&  tolerances,
+    const std::vector<size_t>& counts
+) {
+    if (CurrentRecording != 0)
+        CurrentRecording->recording->AddNestedPoints(points, tolerances, counts, CurrentRecording->attributeStack.back().color);
+    else {
+        for (size_t level = 0; (level < tolerances.size()) && (level < counts.size()); ++level) {
+            if (tolerances[level] == 0.f) {
+                DrawPoints(points, counts[level]);
+                break;
+            }
+        }
     }
+}
+
+
+void DisplayManager::EndDetailLevels(void) {
+    if (CurrentRecording != 0)
+        CurrentRecording->recording->EndDetailGroup();
+    else
+        m_coarseDetail = false;
+}
+
+
+float DisplayManager::DetailTolerance(void) const {
+    return (CurrentRecording != 0) ? CurrentRecording->detailTolerance : 0.f;
+}
+
+
+float DisplayManager::ViewTolerance(void) const {
+    return SceneBuffers::PixelTolerance(m_trafoStack.Forward(ParallelProjection));
+}
+
+
+void DisplayManager::EyePoint
+(
+    const QVector3D& point
+) {
+    if (m_trafoStack.Size() > (ParallelProjection + 1))
+        m_eyePoint = m_trafoStack.Map(m_trafoStack.Size() - 1, ParallelProjection).map(point);
     else
         m_eyePoint = point;
 
-    m_trafoStack[ParallelProjection] = m_trafoStack[ParallelProjection - 1] * Projection(m_eyePoint, m_targetPoint);
-    PropagateTrafo(ParallelProjection, inverse);
+    QMatrix4x4 projection = Projection(m_eyePoint, m_targetPoint);
+
+    m_trafoStack.Set(ParallelProjection, projection, TrafoStack::RigidInverse(projection));
 }
 
 
 QVector3D DisplayManager::EyePoint(void) const {
     QVector3D ret = m_eyePoint;
 
-    if (m_trafoStack.size() > (ParallelProjection + 1)) {
-        QMatrix4x4 inverse  = m_trafoStack.back().inverted();
-        QMatrix4x4 toActual = inverse * m_trafoStack[ParallelProjection];
-
-        ret = toActual.map(m_eyePoint);
-    }
+    if (m_trafoStack.Size() > (ParallelProjection + 1))
+        ret = m_trafoStack.Map(ParallelProjection, m_trafoStack.Size() - 1).map(m_eyePoint);
 
     return ret;
 }
@@ -768,45 +1286,34 @@ void DisplayManager::TargetPoint
 (
     const QVector3D& point
 ) {
-    QMatrix4x4 inverse = m_trafoStack[ParallelProjection].inverted();
-
-    if (m_trafoStack.size() > (ParallelProjection + 1)) {
-        QMatrix4x4 trafo = inverse * m_trafoStack.back();
-
-        m_targetPoint = trafo.map(point);
-    }
+    if (m_trafoStack.Size() > (ParallelProjection + 1))
+        m_targetPoint = m_trafoStack.Map(m_trafoStack.Size() - 1, ParallelProjection).map(point);
     else
         m_targetPoint = point;
 
-    m_trafoStack[ParallelProjection] = m_trafoStack[ParallelProjection - 1] * Projection(m_eyePoint, m_targetPoint);
-    PropagateTrafo(ParallelProjection, inverse);
+    QMatrix4x4 projection = Projection(m_eyePoint, m_targetPoint);
+
+    m_trafoStack.Set(ParallelProjection, projection, TrafoStack::RigidInverse(projection));
 }
 
 
 QVector3D DisplayManager::TargetPoint(void) const {
     QVector3D ret = m_targetPoint;
 
-    if (m_trafoStack.size() > (ParallelProjection + 1)) {
-        QMatrix4x4 inverse  = m_trafoStack.back().inverted();
-        QMatrix4x4 toActual = inverse * m_trafoStack[ParallelProjection];
-
-        ret = toActual.map(m_targetPoint);
-    }
+    if (m_trafoStack.Size() > (ParallelProjection + 1))
+        ret = m_trafoStack.Map(ParallelProjection, m_trafoStack.Size() - 1).map(m_targetPoint);
 
     return ret;
 }
 
 
-
 void DisplayManager::ShiftOnDisplay
 (
     const QVector3D& vector
 ) {
-    QMatrix4x4 inverse     = m_trafoStack[World2Devicemm].inverted();
-    QMatrix4x4 vectorTrafo = inverse * m_trafoStack.back();
+    QMatrix4x4 vectorTrafo = m_trafoStack.Map(m_trafoStack.Size() - 1, World2Devicemm);
 
-    m_trafoStack[World2Devicemm].translate(vectorTrafo.map(vector) - vectorTrafo.map(QVector3D(0.f, 0.f, 0.f)));
-    PropagateTrafo(World2Devicemm, inverse);
+    m_trafoStack.Translate(World2Devicemm, vectorTrafo.map(vector) - vectorTrafo.map(QVector3D(0.f, 0.f, 0.f)));
 }
 
 
@@ -815,14 +1322,10 @@ void DisplayManager::ScaleOnDisplay
     const QVector3D& vector
 ) {
     if (vector.length() > SmallFloat) {
-        QMatrix4x4 inverse     = m_trafoStack[World2Devicemm].inverted();
-        QMatrix4x4 vectorTrafo = inverse * m_trafoStack.back();
+        QMatrix4x4 vectorTrafo = m_trafoStack.Map(m_trafoStack.Size() - 1, World2Devicemm);
         QVector3D  origin      = vectorTrafo.map(QVector3D(0.f, 0.f, 0.f));
 
-        m_trafoStack[World2Devicemm].translate(origin);
-        m_trafoStack[World2Devicemm].scale(vector);
-        m_trafoStack[World2Devicemm].translate(-origin);
-        PropagateTrafo(World2Devicemm, inverse);
+        m_trafoStack.Scale(World2Devicemm, origin, vector);
     }
 }
 
@@ -842,20 +1345,25 @@ void DisplayManager::RotateOnDisplay
     double           rotationAroundY,
     double           rotationAroundZ
 ) {
-    QMatrix4x4 inverse       = m_trafoStack[World2Devicemm].inverted();
-    QMatrix4x4 subInverse    = m_trafoStack[World2Devicemm - 1].inverted();
-    QMatrix4x4 centerTrafo   = subInverse * m_trafoStack.back();
-    QVector3D  middle        = centerTrafo.map(center);
-    QMatrix4x4 rotationTrafo = m_trafoStack[World2Devicemm - 1];
+    QVector3D  middle = m_trafoStack.Map(m_trafoStack.Size() - 1, World2Devicemm - 1).map(center);
+    QMatrix4x4 rotation;
+
+    rotation.rotate(rotationAroundX, 1.f, 0.f, 0.f);
+    rotation.rotate(rotationAroundY, 0.f, 1.f, 0.f);
+    rotation.rotate(rotationAroundZ, 0.f, 0.f, 1.f);
 
+    // the rotation is done in the coordinates below World2Devicemm, the inverse of a rotation is its transposition
+    QMatrix4x4 rotationTrafo;
     rotationTrafo.translate(middle);
-    rotationTrafo.rotate(rotationAroundX, 1.f, 0.f, 0.f);
-    rotationTrafo.rotate(rotationAroundY, 0.f, 1.f, 0.f);
-    rotationTrafo.rotate(rotationAroundZ, 0.f, 0.f, 1.f);
+    rotationTrafo *= rotation;
     rotationTrafo.translate(-middle);
-    rotationTrafo               *= subInverse;
-    m_trafoStack[World2Devicemm] = rotationTrafo * m_trafoStack[World2Devicemm];
-    PropagateTrafo(World2Devicemm, inverse);
+
+    QMatrix4x4 inverseTrafo;
+    inverseTrafo.translate(middle);
+    inverseTrafo *= rotation.transposed();
+    inverseTrafo.translate(-middle);
+
+    m_trafoStack.PreMultiply(World2Devicemm, rotationTrafo, inverseTrafo);
 }
 
 
@@ -863,10 +1371,7 @@ void DisplayManager::PushTrafo
 (
     const QMatrix4x4& trafo
 ) {
-    if (m_trafoStack.size() > 0)
-        m_trafoStack.push_back(m_trafoStack.back() * trafo);
-    else
-        m_trafoStack.push_back(trafo);
+    m_trafoStack.Push(trafo);
 }
 
 
@@ -874,47 +1379,35 @@ void DisplayManager::PushDeviceMmTrafo
 (
     const QVector3D& center
 ) {
-    QMatrix4x4 trafo  = m_trafoStack[Devicemm2Device].inverted() * m_trafoStack.back();
-    QVector3D  middle = trafo.map(center);
+    QVector3D  middle = m_trafoStack.Map(m_trafoStack.Size() - 1, Devicemm2Device).map(center);
+    QMatrix4x4 trafo  = m_trafoStack.TopInverse() * m_trafoStack.Forward(Devicemm2Device);
 
-    trafo  = m_trafoStack.back().inverted();
-    trafo *= m_trafoStack[Devicemm2Device];
     trafo.translate(middle);
 
-    PushTrafo(trafo);
+    QMatrix4x4 inverse = TrafoStack::TranslationInverse(middle) * m_trafoStack.Inverse(Devicemm2Device) * m_trafoStack.Top();
+
+    m_trafoStack.Push(trafo, inverse);
 }
 
 
 void DisplayManager::PopTrafo(void) {
-    if (m_trafoStack.size() > UserDefined)
-        m_trafoStack.pop_back();
+    if (m_trafoStack.Size() > UserDefined)
+        m_trafoStack.Pop();
 }
 
 
 void DisplayManager::ResetTrafos(void) {
-    m_trafoStack.clear();
+    m_trafoStack.Clear();
     m_eyePoint    = QVector3D(0.f, 0.f, 0.f);
     m_targetPoint = QVector3D(0.f, 0.f, -1.f);
 
     QMatrix4x4 trafo;
     trafo.scale(m_displayUnit);
 
-    PushTrafo(trafo);
-    PushTrafo(QMatrix4x4());
-    PushTrafo(QMatrix4x4());
-    PushTrafo(QMatrix4x4());
-}
-
-
-void DisplayManager::PropagateTrafo
-(
-    size_t            which,
-    const QMatrix4x4& inverse
-) {
-    QMatrix4x4 trafo = m_trafoStack[which] * inverse;
-
-    for (size_t i = which + 1; i < m_trafoStack.size(); ++i)
-        m_trafoStack[i] = trafo * m_trafoStack[i];
+    m_trafoStack.Push(trafo, TrafoStack::ScaleInverse(m_displayUnit));
+    m_trafoStack.Push(QMatrix4x4(), QMatrix4x4());
+    m_trafoStack.Push(QMatrix4x4(), QMatrix4x4());
+    m_trafoStack.Push(QMatrix4x4(), QMatrix4x4());
 }
 
 
@@ -923,15 +1416,18 @@ void DisplayManager::PushColor
     const QColor& color,
     int           priority
 ) {
-    Attribute attribute;
+    // a worker thread records with its own stack, the OpenGL state isn't touched there
+    std::vector<Attribute>& attributeStack = (CurrentRecording != 0) ? CurrentRecording->attributeStack : m_attributeStack;
+    Attribute               attribute;
+    bool                    changed        = false;
 
-    if (m_attributeStack.size() > 0) {
-        attribute = m_attributeStack.back();
+    if (attributeStack.size() > 0) {
+        attribute = attributeStack.back();
 
         if (priority >= attribute.priority) {
             if (color != attribute.color) {
                 attribute.color = color;
-                m_setAttributes = true;
+                changed         = true;
             }
 
             attribute.priority = priority;
@@ -940,20 +1436,25 @@ void DisplayManager::PushColor
     else {
         attribute.color    = color;
         attribute.priority = priority;
-        m_setAttributes    = true;
+        changed            = true;
     }
 
-    m_attributeStack.push_back(attribute);
+    attributeStack.push_back(attribute);
+
+    if (changed && (CurrentRecording == 0))
+        m_setAttributes = true;
 }
 
 
 void DisplayManager::PopAttribute(void) {
-    if (m_attributeStack.size() > 1) {
-        Attribute oldAttribute = m_attributeStack.back();
+    std::vector<Attribute>& attributeStack = (CurrentRecording != 0) ? CurrentRecording->attributeStack : m_attributeStack;
 
-        m_attributeStack.pop_back();
+    if (attributeStack.size() > 1) {
+        Attribute oldAttribute = attributeStack.back();
 
-        if (oldAttribute.color != m_attributeStack.back().color)
+        attributeStack.pop_back();
+
+        if ((oldAttribute.color != attributeStack.back().color) && (CurrentRecording == 0))
             m_setAttributes = true;
     }
 }
@@ -978,9 +1479,7 @@ QVector3D DisplayManager::Display2Model
 (
     const QPoint& displayPoint
 ) {
-    QMatrix4x4 inverse = m_trafoStack.back().inverted();
-
-    return inverse.map(QVector3D(static_cast<float>(displayPoint.x()), static_cast<float>(displayPoint.y()), 0.f));
+    return m_trafoStack.TopInverse().map(QVector3D(static_cast<float>(displayPoint.x()), static_cast<float>(displayPoint.y()), 0.f));
 }
 
 
@@ -988,8 +1487,32 @@ QPoint DisplayManager::Model2Display
 (
     const QVector3D& modelPoint
 ) {
-    QVector3D displayPoint = m_trafoStack.back().map(modelPoint);
+    QVector3D displayPoint = m_trafoStack.Top().map(modelPoint);
     QPoint    ret(static_cast<int>(round(displayPoint.x())), static_cast<int>(round(displayPoint.y())));
 
     return ret;
 }
+
+
+const QMatrix4x4& DisplayManager::Display2ModelTrafo(void) const {
+    return m_trafoStack.TopInverse();
+}
+
+
+const QMatrix4x4& DisplayManager::Model2DisplayTrafo(void) const {
+    return m_trafoStack.Top();
+}
+
+
+QPoint DisplayManager::DisplayPoint
+(
+    const QPoint& widgetPoint
+) const {
+    return widgetPoint + m_displayMin;
+}
+
+
+QMatrix4x4 DisplayManager::UserTrafo(void) const {
+    // the transformation from the user defined coordinates into the model coordinates
+    return m_trafoStack.Map(m_trafoStack.Size() - 1, ParallelProjection);
+}
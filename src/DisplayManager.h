@@ -20,31 +20,48 @@
 #ifndef DISPLAYMANAGER_INCLUDED
 #define DISPLAYMANAGER_INCLUDED
 
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
 #include <QMatrix4x4>
+#include <QMouseEvent>
+#include <QTimer>
 #include <QVector3D>
+#include <QWheelEvent>
 
 #include "GeometryModel.h"
+#include "SceneBuffers.h"
+#include "TrafoStack.h"
+
 
+class RenderThread;
 
 class DisplayManager : public QOpenGLWidget, protected QOpenGLFunctions {
     Q_OBJECT
 public:
-    DisplayManager(QWidget* parent = 0);
+    DisplayManager(QWidget*                      parent = 0,
+                   std::shared_ptr<SceneBuffers> scene  = std::shared_ptr<SceneBuffers>());
 
     ~DisplayManager(void);
 
     // widget handling
-    void Flush(void);  // update, nothing has changed
-    void Show(void);   // update, projection has changed
+    void Flush(void);  // update, nothing has changed: the last frame may be shown again
+    void Show(void);   // update, projection has changed: the frame is drawn anew
     void Redraw(void); // regenerate, model has changed
 
+    // drawing on a render thread, 0 for the GUI thread
+    void SetRenderThread(RenderThread* renderThread);
+    void FrameRendered(const FrameStatistics& statistics); // a frame of the render thread is done, on the GUI thread
+
     // set projection
     void FitToWindow(void);
     void SetToXYPlane(void);
     void SetToXZPlane(void);
     void SetToYZPlane(void);
+    void SetToIsometric(void);
 
     void Zoom(const QPoint& corner,
               const QPoint& diagonalCorner);
@@ -56,10 +73,31 @@ public:
                    const QPoint& to);
 
     // model operations
-    GeometryModel* SetModel(GeometryModel* geometryModel);
-    void           Draw(void);
-    void           ModelMinMax(QVector3D& minCorner,
-                               QVector3D& maxCorner) const;
+    GeometryModel*                SetModel(GeometryModel* geometryModel);
+    void                          Draw(void); // immediately, on the OpenGL thread
+    // records the geometries again on a thread of their own with the detail the visible views need now,
+    // their new levels replace the old ones in the scene
+    void                          RefineDetail(const std::vector<const Geometry*>& geometries);
+    void                          ModelMinMax(QVector3D& minCorner,
+                                              QVector3D& maxCorner) const;
+    // the exact extent of the model's vertices after an affine trafo, e.g. Model2DisplayTrafo()
+    // a geometry without vertices, e.g. a released plot, goes in with the corners of its bounding box
+    void                          ProjectedMinMax(const QMatrix4x4& trafo,
+                                                  QVector3D&        minCorner,
+                                                  QVector3D&        maxCorner) const;
+
+    // the uploaded geometry, to be shared with further views
+    std::shared_ptr<SceneBuffers> Scene(void) const;
+
+    const FrameStatistics&        Statistics(void) const;
+
+signals:
+    void Activated(DisplayManager* displayManager);
+    void Clicked(DisplayManager* displayManager,
+                 const QPoint&   displayPoint);
+    void FrameDrawn(DisplayManager*        displayManager,
+                    const FrameStatistics& statistics);
+    void DetailNeeded(DisplayManager* displayManager); // the view has been zoomed in beyond the recorded levels
 
 protected:
     void initializeGL(void);
@@ -67,12 +105,24 @@ protected:
     void resizeGL(int width,
                   int height);
 
+    // mouse navigation
+    void mousePressEvent(QMouseEvent* event);
+    void mouseMoveEvent(QMouseEvent* event);
+    void mouseReleaseEvent(QMouseEvent* event);
+    void wheelEvent(QWheelEvent* event);
+
 private:
     QPoint                  m_displayMin;
     QPoint                  m_displayMax;
     QVector3D               m_displayUnit;
-    GLuint                  m_displayListId;
-    bool                    m_updateDisplayList;
+
+    std::shared_ptr<SceneBuffers> m_scene;
+    bool                          m_coarseDetail;     // a simplified level is drawn, immediate drawing skips it
+    FrameStatistics               m_statistics;
+    FrameStatistics               m_uploadStatistics; // of a refinement, they go with the next frame
+    bool                          m_refining;         // until the refinement's levels are in the scene
+    std::thread                   m_refineThread;
+    RenderThread*                 m_renderThread;     // 0 if the frames are drawn in paintGL()
 
     QVector3D               m_eyePoint;
     QVector3D               m_targetPoint;
@@ -82,12 +132,46 @@ private:
         Fit,
         XyFit,
         XzFit,
-        YzFit
+        YzFit,
+        IsometricFit
     };
 
     PaintAction             m_paintAction;
 
-    std::vector<QMatrix4x4> m_trafoStack;
+    // interaction: the input events are only collected here,
+    // they will be applied once per frame in paintGL()
+    enum class DragAction {
+        None,
+        Rotate,
+        Shift
+    };
+
+    struct BoundingBox {
+        QVector3D minCorner;
+        QVector3D maxCorner;
+    };
+
+    struct WheelZoom {
+        QPoint centre;
+        double scale;
+    };
+
+    DragAction               m_dragAction;
+    DragAction               m_pendingDrag; // of the movement not yet applied, it outlasts the release
+    QPoint                   m_dragStart;
+    QPoint                   m_dragApplied; // the last mouse position which went into the view
+    QPoint                   m_dragCurrent; // the last mouse position received
+    std::vector<WheelZoom>   m_wheelZooms;  // in their order, one per change of the centre
+    std::vector<BoundingBox> m_dragBoxes;   // the reduced representation during a drag
+    QTimer*                  m_refineTimer; // waits for the zoom to come to rest
+
+    // the frame in the framebuffer, it's shown again as long as the model and the view stay the same
+    // with a render thread: the frame posted last, it's not posted again
+    bool                     m_frameCached;
+    size_t                   m_cachedGeneration;
+    QMatrix4x4               m_cachedTrafo;
+
+    TrafoStack              m_trafoStack;
 
     enum TrafoPosition {
         Devicemm2Device    = 0,
@@ -101,18 +185,42 @@ private:
 
     GeometryModel*          m_model;
 
+    void       ApplyPaintAction(void);
+    void       FitView(const QVector3D& direction); // looks along direction, the vertices fill the display
+    void       ApplyPendingInput(void);
+    void       DrawReduced(void);
+    void       Record(FrameStatistics& statistics);
+    void       ViewVolume(QVector3D& viewMin,
+                          QVector3D& viewMax) const;
+    void       PresentRendered(void);
+    QPoint     DisplayPoint(const QPoint& widgetPoint) const;
+    QMatrix4x4 UserTrafo(void) const;
+
 public:
     // device
     void      SetDisplayProjection(void);
 
     void      SetColor(const QColor& color);
     void      DrawPoint(const QVector3D& point);
+    void      DrawPoints(const QVector3D* points,
+                         size_t           count);
     void      DrawLine(const QVector3D& start,
                        const QVector3D& end);
     void      DrawTriangle(const QVector3D& a,
                            const QVector3D& b,
                            const QVector3D& c);
 
+    // alternative representations of one object, the coarsest sufficient one will be displayed
+    void      BeginDetailLevels(void);
+    void      DetailLevel(float tolerance); // in model units, 0 is the exact geometry
+    void      EndDetailLevels(void);
+    // a detail group of its own, the first counts[i] points are the level of tolerances[i]
+    void      DrawNestedPoints(const QVector3D*           points,
+                               const std::vector<float>&  tolerances,
+                               const std::vector<size_t>& counts);
+    float     DetailTolerance(void) const;  // the finest level to be drawn, 0 for the exact geometry
+    float     ViewTolerance(void) const;    // the coarsest level which looks exact in this view
+
     // projection
     void      EyePoint(const QVector3D& point);
     QVector3D EyePoint(void) const;
@@ -131,9 +239,6 @@ public:
     void      PopTrafo(void);
     void      ResetTrafos(void);
 
-    void      PropagateTrafo(size_t            which,
-                             const QMatrix4x4& inverse);
-
     struct Attribute {
         QColor color;
         int    priority;
@@ -149,8 +254,10 @@ public:
     void      ResetAttributes(void);
 
     // reverse ingeneering
-    QVector3D Display2Model(const QPoint& displayPoint);
-    QPoint    Model2Display(const QVector3D& modelPoint);
+    QVector3D         Display2Model(const QPoint& displayPoint);
+    QPoint            Model2Display(const QVector3D& modelPoint);
+    const QMatrix4x4& Display2ModelTrafo(void) const;
+    const QMatrix4x4& Model2DisplayTrafo(void) const;
 };
 
 
@@ -0,0 +1,46 @@
+/*                   F R A M E S T A T I S T I C S . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file FrameStatistics.h
+ *
+ *  BRL-CAD GUI:
+ *      the measurements of a drawn frame
+ */
+
+#ifndef FRAMESTATISTICS_INCLUDED
+#define FRAMESTATISTICS_INCLUDED
+
+#include <QtGlobal>
+
+
+struct FrameStatistics {
+    qint64 frameTime;    // in nanoseconds, the time spent in paintGL()
+    size_t drawnChunks;
+    size_t culledChunks;
+    size_t drawCalls;
+    size_t drawnVertices;
+    size_t drawnBatches;
+    size_t coarseGroups; // detail groups drawn coarser than a pixel, they wait for their refinement
+
+    // the upload of a new model, 0 in the other frames
+    size_t uploadedFloats;
+    size_t copiedFloats;     // every float written on the way from the plot to the buffers
+    size_t peakStagingBytes; // the staging blocks and the recordings waiting for their merge
+
+    FrameStatistics(void)
+        : frameTime(0), drawnChunks(0), culledChunks(0), drawCalls(0), drawnVertices(0), drawnBatches(0), coarseGroups(0),
+          uploadedFloats(0), copiedFloats(0), peakStagingBytes(0) {}
+};
+
+
+#endif // FRAMESTATISTICS_INCLUDED
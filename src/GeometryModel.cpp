@@ -17,45 +17,131 @@
  *      the internal geometry data model implementation
  */
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+
 #include "GeometryModel.h"
+#include "Parallel.h"
 
 
-GeometryModel::~GeometryModel(void) {
-    Clear();
-}
+GeometryModel::GeometryModel(void) : m_snapshot(std::make_shared<const GeometryList>()) {}
 
 
-std::list<Geometry*>::const_iterator GeometryModel::Begin(void) const {
-    return m_geometries.begin();
+std::shared_ptr<const GeometryModel::GeometryList> GeometryModel::Snapshot(void) const {
+    return std::atomic_load(&m_snapshot);
 }
 
 
-std::list<Geometry*>::const_iterator GeometryModel::End(void) const {
-    return m_geometries.end();
+void GeometryModel::Append
+(
+    const Geometry& geometry
+) {
+    Append(geometry.Clone());
 }
 
 
 void GeometryModel::Append
 (
-    const Geometry& geometry
+    Geometry* geometry
 ) {
-    m_geometries.push_back(geometry.Clone());
+    Append(std::vector<Geometry*>(1, geometry));
 }
 
 
 void GeometryModel::Append
 (
-    Geometry* geometry
+    const std::vector<Geometry*>& geometries
 ) {
-    m_geometries.push_back(geometry);
+    Publish(geometries, std::vector<const Geometry*>(), std::vector<Replacement>(), false);
+}
+
+
+void GeometryModel::Remove
+(
+    const Geometry* geometry
+) {
+    Remove(std::vector<const Geometry*>(1, geometry));
+}
+
+
+void GeometryModel::Remove
+(
+    const std::vector<const Geometry*>& geometries
+) {
+    Publish(std::vector<Geometry*>(), geometries, std::vector<Replacement>(), false);
 }
 
 
 void GeometryModel::Clear(void) {
-    for (std::list<Geometry*>::iterator it = m_geometries.begin(); it != m_geometries.end(); ++it) {
+    Publish(std::vector<Geometry*>(), std::vector<const Geometry*>(), std::vector<Replacement>(), true);
+}
+
+
+void GeometryModel::Replace
+(
+    const std::vector<Replacement>& replacements
+) {
+    Publish(std::vector<Geometry*>(), std::vector<const Geometry*>(), replacements, false);
+}
+
+
+void GeometryModel::Publish
+(
+    const std::vector<Geometry*>&       added,
+    const std::vector<const Geometry*>& removed,
+    const std::vector<Replacement>&     replacements,
+    bool                                clear
+) {
+    // the geometries are complete before any reader sees them
+    std::vector<Geometry*> prepared(added);
+
+    for (std::vector<Replacement>::const_iterator it = replacements.begin(); it != replacements.end(); ++it)
+        prepared.push_back(it->second);
+
+    ParallelFor(prepared.size(), [&prepared](size_t i) {
+        if (prepared[i] != 0)
+            prepared[i]->Prepare();
+    });
+
+    // the added geometries are owned once, whatever the number of attempts
+    std::vector<std::shared_ptr<const Geometry> >               newGeometries;
+    std::map<const Geometry*, std::shared_ptr<const Geometry> > successors;
+
+    for (std::vector<Geometry*>::const_iterator it = added.begin(); it != added.end(); ++it) {
         if (*it != 0)
-            delete *it;
+            newGeometries.push_back(std::shared_ptr<const Geometry>(*it));
+    }
+
+    for (std::vector<Replacement>::const_iterator it = replacements.begin(); it != replacements.end(); ++it) {
+        if (it->second != 0)
+            successors[it->first] = std::shared_ptr<const Geometry>(it->second);
     }
 
-    m_geometries.clear();
+    std::vector<const Geometry*> sortedRemoved(removed);
+
+    std::sort(sortedRemoved.begin(), sortedRemoved.end());
+
+    std::shared_ptr<const GeometryList> current = std::atomic_load(&m_snapshot);
+    std::shared_ptr<const GeometryList> next;
+
+    do {
+        std::shared_ptr<GeometryList> list = std::make_shared<GeometryList>();
+
+        if (!clear) {
+            list->reserve(current->size() + newGeometries.size());
+
+            for (GeometryList::const_iterator it = current->begin(); it != current->end(); ++it) {
+                std::map<const Geometry*, std::shared_ptr<const Geometry> >::const_iterator successor = successors.find(it->get());
+
+                if (successor != successors.end())
+                    list->push_back(successor->second);
+                else if (!std::binary_search(sortedRemoved.begin(), sortedRemoved.end(), it->get()))
+                    list->push_back(*it);
+            }
+        }
+
+        list->insert(list->end(), newGeometries.begin(), newGeometries.end());
+        next = list;
+    } while (!std::atomic_compare_exchange_weak(&m_snapshot, &current, next));
 }
@@ -15,26 +15,77 @@
  *
  *  BRL-CAD GUI:
  *      the internal geometry data model declaration
+ *
+ *  The model publishes its geometry lists as snapshots.  A reader takes
+ *  the current one and keeps it, and so its geometries, as long as it needs
+ *  them.  A writer builds the next list and swaps it in with a
+ *  compare-and-exchange; when another writer came first, it builds its
+ *  list again from the newer snapshot.
+ *
+ *  The atomic operations on the shared pointer aren't lock-free with the
+ *  common standard libraries, they take a short internal lock while the
+ *  pointer is copied or swapped.  The building and the reading of a list
+ *  happen outside of it.
+ *
+ *  A snapshot's list never changes, and neither do its geometries: the
+ *  model prepares them before it publishes them, and a published geometry
+ *  is const.  A change of a geometry, like the release of a plot, publishes
+ *  a successor in its place with Replace().  This way every thread may use
+ *  the geometries of the snapshot it holds, e.g. a refinement on a thread
+ *  of its own.
  */
 
 #ifndef GEOMETRYMODEL_INCLUDED
 #define GEOMETRYMODEL_INCLUDED
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <QVector3D>
 
 
 class DisplayManager;
 
 
+// receives the primitives of a geometry in model coordinates
+class PrimitiveCallback {
+public:
+    virtual ~PrimitiveCallback(void) {}
+
+    virtual void Point(const QVector3D& point)       = 0;
+    virtual void Line(const QVector3D& start,
+                      const QVector3D& end)          = 0;
+    virtual void Triangle(const QVector3D& a,
+                          const QVector3D& b,
+                          const QVector3D& c)        = 0;
+};
+
+
 class Geometry {
 public:
     virtual ~Geometry(void) {}
 
-    virtual Geometry* Clone(void) const                    = 0;
+    virtual Geometry* Clone(void) const                                = 0;
+
+    // the expensive preparations for Draw(), the model runs them on the worker threads before it publishes the geometry
+    virtual void      Prepare(void) {}
+    virtual void      Draw(DisplayManager& displayManager) const       = 0;
+
+    // a large geometry is recorded in parts of a limited size on several worker threads,
+    // valid after Prepare(), Draw() draws all of them
+    virtual size_t    Parts(void) const {
+        return 1;
+    }
+
+    virtual void      DrawPart(DisplayManager& displayManager,
+                               size_t          part) const {
+        Draw(displayManager);
+    }
 
-    virtual void      Draw(DisplayManager& displayManager) = 0;
     virtual void      MinMax(QVector3D& minCorner,
-                             QVector3D& maxCorner) const   = 0;
+                             QVector3D& maxCorner) const               = 0;
+    virtual void      Primitives(PrimitiveCallback& callback) const    = 0;
 
 protected:
     Geometry(void) {}
@@ -48,18 +99,37 @@ private:
 
 class GeometryModel {
 public:
-    ~GeometryModel(void);
+    typedef std::vector<std::shared_ptr<const Geometry> > GeometryList;
+    typedef std::pair<const Geometry*, Geometry*>         Replacement; // a geometry of the model and its successor
+
+    GeometryModel(void);
 
-    std::list<Geometry*>::const_iterator Begin(void) const;
-    std::list<Geometry*>::const_iterator End(void) const;
+    std::shared_ptr<const GeometryList> Snapshot(void) const;
 
-    void                                 Append(const Geometry& geometry);
-    void                                 Append(Geometry* geometry);
+    // the model takes the geometries over and prepares them
+    void                                Append(const Geometry& geometry);
+    void                                Append(Geometry* geometry);
+    void                                Append(const std::vector<Geometry*>& geometries);
 
-    void                                 Clear(void);
+    // the geometries go with the last snapshot holding them
+    void                                Remove(const Geometry* geometry);
+    void                                Remove(const std::vector<const Geometry*>& geometries);
+    void                                Clear(void);
+
+    // the successors take the places of their geometries, like Append() the model takes them over and prepares them,
+    // a successor whose geometry isn't in the model anymore is deleted
+    void                                Replace(const std::vector<Replacement>& replacements);
 
 private:
-    std::list<Geometry*> m_geometries;
+    std::shared_ptr<const GeometryList> m_snapshot;
+
+    void Publish(const std::vector<Geometry*>&       added,
+                 const std::vector<const Geometry*>& removed,
+                 const std::vector<Replacement>&     replacements,
+                 bool                                clear);
+
+    GeometryModel(const GeometryModel& original);
+    GeometryModel& operator=(const GeometryModel& original);
 };
 
 
@@ -17,119 +17,506 @@
  *      the main window class implementation
  */
 
+#include <algorithm>
+#include <sstream>
+
 #include <QAction>
 #include <QApplication>
 #include <QDockWidget>
+#include <QElapsedTimer>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QHeaderView>
 #include <QMenu>
 #include <QMenuBar>
+#include <QSplitter>
+#include <QStatusBar>
+#include <QVBoxLayout>
 
 #include <brlcad/Database/Combination.h>
 
+#include "ObjectHierarchy.h"
+#include "Parallel.h"
 #include "PlotGeometry.h"
 #include "MainWindow.h"
 
 
+const double PickDistance     = 5.;   // in pixels
+const size_t MaxSearchResults = 1000;
+const int    ReloadDelay      = 500;  // in milliseconds after the last change of the file
+const size_t TreeItemBytes    = 128;  // the estimated overhead of a tree item besides its text
+const int    MaxMemoryBudget  = 1024 * 1024; // in MiB
+
+
 // static helpers
-class SubObjectCallback;
+// the structure of a combination's tree as text, and the names of its leaves
+static void TreeSignature
+(
+    const BRLCAD::Combination::ConstTreeNode& tree,
+    std::string&                              text,
+    std::vector<std::string>&                 leaves
+) {
+    switch (tree.Operation()) {
+        case BRLCAD::Combination::ConstTreeNode::Union:
+        case BRLCAD::Combination::ConstTreeNode::Intersection:
+        case BRLCAD::Combination::ConstTreeNode::Subtraction:
+        case BRLCAD::Combination::ConstTreeNode::ExclusiveOr:
+            text += static_cast<char>('0' + tree.Operation());
+            text += '(';
+            TreeSignature(tree.LeftOperand(), text, leaves);
+            text += ',';
+            TreeSignature(tree.RightOperand(), text, leaves);
+            text += ')';
+            break;
+
+        case BRLCAD::Combination::ConstTreeNode::Not:
+            text += "!(";
+            TreeSignature(tree.Operand(), text, leaves);
+            text += ')';
+            break;
+
+        case BRLCAD::Combination::ConstTreeNode::Leaf:
+            text += tree.Name();
+            text += ';';
+            leaves.push_back(tree.Name());
+    }
+}
 
-static void WalkTree(const BRLCAD::Combination::ConstTreeNode& tree,
-                     const BRLCAD::ConstDatabase&              database,
-                     SubObjectCallback&                        callback);
 
+// a combination's signature covers its tree and attributes which show in the GUI,
+// the other objects get 0: their changes show in their plots
+static void CollectSignatures
+(
+    const BRLCAD::ConstDatabase&    database,
+    const std::string&              objectName,
+    NameTable&                      names,
+    std::map<unsigned int, size_t>& signatures
+) {
+    unsigned int objectId = names.Id(objectName);
 
-class SubObjectCallback {
-public:
-    SubObjectCallback(QTreeWidgetItem*       treeItem,
-                      BRLCAD::ConstDatabase& database) : m_treeItem(treeItem),
-                                                         m_database(database) {}
+    if (signatures.find(objectId) != signatures.end())
+        return;
 
-    void operator()(const BRLCAD::Object& object) {
-        QTreeWidgetItem* treeItem = new QTreeWidgetItem(m_treeItem);
-        treeItem->setText(0, QString::fromUtf8(object.Name()));
+    std::vector<std::string> leaves;
 
+    database.Get(objectName.c_str(), [objectId, &signatures, &leaves](const BRLCAD::Object& object) {
         const BRLCAD::Combination* combination = dynamic_cast<const BRLCAD::Combination*>(&object);
 
         if (combination != 0) {
-            SubObjectCallback subObjectCallback(treeItem, m_database);
+            std::ostringstream text;
+            std::string        tree;
+
+            TreeSignature(combination->Tree(), tree, leaves);
+            text << tree << combination->IsRegion();
+
+            if (combination->HasColor())
+                text << ' ' << combination->Red() << ' ' << combination->Green() << ' ' << combination->Blue();
 
-            WalkTree(combination->Tree(), m_database, subObjectCallback);
+            signatures[objectId] = std::hash<std::string>()(text.str()) | 1;
         }
-    }
+        else
+            signatures[objectId] = 0;
+    });
 
-private:
-    QTreeWidgetItem*       m_treeItem;
-    BRLCAD::ConstDatabase& m_database;
-};
+    for (std::vector<std::string>::const_iterator it = leaves.begin(); it != leaves.end(); ++it)
+        CollectSignatures(database, *it, names, signatures);
+}
 
 
-class TopObjectCallback {
-public:
-    TopObjectCallback(QTreeWidget*           tree,
-                      BRLCAD::ConstDatabase& database) : m_tree(tree),
-                                                         m_database(database) {}
+static unsigned int ItemObjectId
+(
+    const QTreeWidgetItem* item
+) {
+    return item->data(0, Qt::UserRole).toUInt();
+}
 
-    void operator()(const BRLCAD::Object& object) {
-        QTreeWidgetItem* treeItem = new QTreeWidgetItem(m_tree);
-        treeItem->setText(0, QString::fromUtf8(object.Name()));
 
-        const BRLCAD::Combination* combination = dynamic_cast<const BRLCAD::Combination*>(&object);
+// the object IDs from the top object to the item
+static std::vector<unsigned int> ItemIdPath
+(
+    const QTreeWidgetItem* item
+) {
+    std::vector<unsigned int> ret;
 
-        if (combination != 0) {
-            SubObjectCallback subObjectCallback(treeItem, m_database);
+    for (; item != 0; item = item->parent())
+        ret.push_back(ItemObjectId(item));
 
-            WalkTree(combination->Tree(), m_database, subObjectCallback);
-        }
+    std::reverse(ret.begin(), ret.end());
+
+    return ret;
+}
+
+
+// the names of an ID path, separated by '/'
+static std::string PathName
+(
+    const std::vector<unsigned int>& idPath,
+    const NameTable&                 names
+) {
+    std::string ret;
+
+    for (std::vector<unsigned int>::const_iterator it = idPath.begin(); it != idPath.end(); ++it) {
+        if (it != idPath.begin())
+            ret += '/';
+
+        ret += names.Name(*it);
     }
 
-private:
-    QTreeWidget*           m_tree;
-    BRLCAD::ConstDatabase& m_database;
-};
+    return ret;
+}
 
 
-static void WalkTree
+// the name IDs of a path with '/' separators, NoId for a name the table doesn't know
+static std::vector<unsigned int> PathIds
 (
-    const BRLCAD::Combination::ConstTreeNode& tree,
-    const BRLCAD::ConstDatabase&              database,
-    SubObjectCallback&                        callback
+    const std::string& path,
+    const NameTable&   names
 ) {
-    switch (tree.Operation()) {
-        case BRLCAD::Combination::ConstTreeNode::Union:
-        case BRLCAD::Combination::ConstTreeNode::Intersection:
-        case BRLCAD::Combination::ConstTreeNode::Subtraction:
-        case BRLCAD::Combination::ConstTreeNode::ExclusiveOr:
-            WalkTree(tree.LeftOperand(), database, callback);
-            WalkTree(tree.RightOperand(), database, callback);
+    std::vector<unsigned int> ret;
+    size_t                    start = 0;
+
+    for (;;) {
+        size_t end = path.find('/', start);
+
+        ret.push_back(names.Find(path.substr(start, (end == std::string::npos) ? std::string::npos : end - start)));
+
+        if (end == std::string::npos)
             break;
 
-        case BRLCAD::Combination::ConstTreeNode::Not:
-            WalkTree(tree.Operand(), database, callback);
+        start = end + 1;
+    }
+
+    return ret;
+}
+
+
+// the region plots of an item are told apart by their plotted paths
+static std::pair<std::vector<unsigned int>, std::vector<unsigned int> > GeometryKey
+(
+    const std::vector<unsigned int>& itemIdPath,
+    const Geometry&                  geometry,
+    const NameTable&                 names
+) {
+    const PlotGeometry*                                              plot = dynamic_cast<const PlotGeometry*>(&geometry);
+    std::pair<std::vector<unsigned int>, std::vector<unsigned int> > ret(itemIdPath, std::vector<unsigned int>());
+
+    if (plot != 0)
+        ret.second = PathIds(plot->Name(), names);
+
+    return ret;
+}
+
+
+// the objects below the item, an object already in covered brings its sub-tree along
+static void CollectDescendants
+(
+    const QTreeWidgetItem*  item,
+    std::set<unsigned int>& covered
+) {
+    for (int i = 0; i < item->childCount(); ++i) {
+        const QTreeWidgetItem* child = item->child(i);
+
+        if (covered.insert(ItemObjectId(child)).second)
+            CollectDescendants(child, covered);
+    }
+}
+
+
+// a selected object which is part of another selected one, or selected twice, would be plotted twice
+static QList<QTreeWidgetItem*> NormalizeSelection
+(
+    const QList<QTreeWidgetItem*>& selectedItems,
+    size_t&                        coveredItems
+) {
+    QList<QTreeWidgetItem*> ret;
+    std::set<unsigned int>  walked;
+    std::set<unsigned int>  covered;
+    std::set<unsigned int>  plotted;
+
+    // every item of an object has the same sub-tree
+    for (QList<QTreeWidgetItem*>::const_iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
+        unsigned int objectId = ItemObjectId(*it);
+
+        if ((covered.find(objectId) == covered.end()) && walked.insert(objectId).second)
+            CollectDescendants(*it, covered);
+    }
+
+    for (QList<QTreeWidgetItem*>::const_iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
+        unsigned int objectId = ItemObjectId(*it);
+
+        if ((covered.find(objectId) == covered.end()) && plotted.insert(objectId).second)
+            ret.append(*it);
+    }
+
+    coveredItems = selectedItems.size() - ret.size();
+
+    return ret;
+}
+
+
+static QTreeWidgetItem* FindItem
+(
+    const QTreeWidget*               tree,
+    const std::vector<unsigned int>& idPath
+) {
+    QTreeWidgetItem* ret = 0;
+
+    for (int i = 0; (i < tree->topLevelItemCount()) && !idPath.empty(); ++i) {
+        if (ItemObjectId(tree->topLevelItem(i)) == idPath[0]) {
+            ret = tree->topLevelItem(i);
             break;
+        }
+    }
 
-        case BRLCAD::Combination::ConstTreeNode::Leaf:
-            database.Get(tree.Name(), callback);
+    for (size_t level = 1; (level < idPath.size()) && (ret != 0); ++level) {
+        QTreeWidgetItem* parent = ret;
+
+        ret = 0;
+
+        for (int i = 0; i < parent->childCount(); ++i) {
+            if (ItemObjectId(parent->child(i)) == idPath[level]) {
+                ret = parent->child(i);
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+// marks the objects with a changed object in their sub-trees, returns whether the item has one
+static bool MarkAffected
+(
+    const QTreeWidgetItem*        item,
+    const std::set<unsigned int>& changedObjects,
+    std::set<unsigned int>&       affectedObjects
+) {
+    unsigned int objectId = ItemObjectId(item);
+    bool         ret      = changedObjects.find(objectId) != changedObjects.end();
+
+    for (int i = 0; i < item->childCount(); ++i) {
+        if (MarkAffected(item->child(i), changedObjects, affectedObjects))
+            ret = true;
+    }
+
+    if (ret)
+        affectedObjects.insert(objectId);
+
+    return ret;
+}
+
+
+// a region's plot changes with the objects along its path and with its sub-tree
+static bool RegionChanged
+(
+    const std::vector<unsigned int>& pathIds,
+    const std::set<unsigned int>&    changedObjects,
+    const std::set<unsigned int>&    affectedObjects
+) {
+    bool ret = false;
+
+    for (std::vector<unsigned int>::const_iterator it = pathIds.begin(); (it != pathIds.end()) && !ret; ++it) {
+        if (*it == NameTable::NoId)
+            ret = true;
+        else if (it + 1 == pathIds.end())
+            ret = affectedObjects.find(*it) != affectedObjects.end();
+        else
+            ret = changedObjects.find(*it) != changedObjects.end();
+    }
+
+    return ret;
+}
+
+
+// the first node of every object in the hierarchy, NoParent for the objects it doesn't have
+// every node of an object has the same subtree
+static std::vector<size_t> FirstNodes
+(
+    const ObjectHierarchy& hierarchy,
+    size_t                 nameCount
+) {
+    std::vector<size_t> ret(nameCount, ObjectHierarchy::NoParent);
+
+    for (size_t node = hierarchy.NodeCount(); node > 0; --node) {
+        unsigned int nameId = hierarchy.NodeName(node - 1);
+
+        if (nameId < ret.size())
+            ret[nameId] = node - 1;
+    }
+
+    return ret;
+}
+
+
+// the items of a node's subtree below the node's item, in the order of the nodes
+static void AddHierarchyItems
+(
+    QTreeWidgetItem*       item,
+    const ObjectHierarchy& hierarchy,
+    size_t                 node,
+    const NameTable&       names
+) {
+    std::vector<QTreeWidgetItem*> items(hierarchy.NodeEnd(node) - node, 0);
+
+    items[0] = item;
+
+    for (size_t child = node + 1; child < hierarchy.NodeEnd(node); ++child) {
+        QTreeWidgetItem* childItem = new QTreeWidgetItem();
+        unsigned int     nameId    = hierarchy.NodeName(child);
+
+        childItem->setText(0, QString::fromUtf8(names.Name(nameId).c_str()));
+        childItem->setData(0, Qt::UserRole, nameId);
+        items[child - node] = childItem;
+        items[hierarchy.NodeParent(child) - node]->addChild(childItem);
+    }
+}
+
+
+// replaces the sub-tree of a changed object by the one of the new hierarchy
+static void RegenerateTreeItem
+(
+    QTreeWidgetItem*           item,
+    const ObjectHierarchy&     hierarchy,
+    const std::vector<size_t>& firstNodes,
+    const NameTable&           names
+) {
+    unsigned int objectId = ItemObjectId(item);
+
+    qDeleteAll(item->takeChildren());
+
+    if ((objectId < firstNodes.size()) && (firstNodes[objectId] != ObjectHierarchy::NoParent))
+        AddHierarchyItems(item, hierarchy, firstNodes[objectId], names);
+}
+
+
+// regenerates the sub-trees of the changed objects below the item, and removes the deleted ones
+static void PatchTreeItem
+(
+    QTreeWidgetItem*                      item,
+    const ObjectHierarchy&                hierarchy,
+    const std::vector<size_t>&            firstNodes,
+    const NameTable&                      names,
+    const std::set<unsigned int>&         changedObjects,
+    const std::map<unsigned int, size_t>& signatures
+) {
+    for (int i = item->childCount() - 1; i >= 0; --i) {
+        QTreeWidgetItem* child   = item->child(i);
+        unsigned int     childId = ItemObjectId(child);
+
+        if (changedObjects.find(childId) == changedObjects.end())
+            PatchTreeItem(child, hierarchy, firstNodes, names, changedObjects, signatures);
+        else if (signatures.find(childId) == signatures.end())
+            delete item->takeChild(i);
+        else
+            RegenerateTreeItem(child, hierarchy, firstNodes, names);
     }
 }
 
 
+static size_t TreeBytes
+(
+    const QTreeWidgetItem* item
+) {
+    size_t ret = sizeof(QTreeWidgetItem) + TreeItemBytes + item->text(0).size() * sizeof(QChar);
+
+    for (int i = 0; i < item->childCount(); ++i)
+        ret += TreeBytes(item->child(i));
+
+    return ret;
+}
+
+
+static void AddToNameIndex
+(
+    QTreeWidgetItem*               item,
+    size_t                         parent,
+    const NameTable&               names,
+    NameIndex&                     nameIndex,
+    std::vector<QTreeWidgetItem*>& treeItems
+) {
+    size_t entry = nameIndex.Add(ItemObjectId(item), names.Name(ItemObjectId(item)), parent);
+    treeItems.push_back(item);
+
+    for (int i = 0; i < item->childCount(); ++i)
+        AddToNameIndex(item->child(i), entry, names, nameIndex, treeItems);
+}
+
+
 // MainWindow
 MainWindow::MainWindow
 (
     const char* fileName,
     QWidget*    parent
 ) : QMainWindow(parent),
-    m_database() {
+    m_database(),
+    m_names(),
+    m_renderThread(),
+    m_pickIndex(),
+    m_geometryItems(),
+    m_highlightedItem(0),
+    m_coveredSelections(0),
+    m_importedPlots(),
+    m_treeItems(),
+    m_nameIndex(),
+    m_pendingNameIndex(),
+    m_nameIndexThread(),
+    m_fileName(),
+    m_topObjects(),
+    m_objectSignatures(),
+    m_memoryUsage(),
+    m_treeBytes(0) {
     setWindowTitle(tr("BRL-CAD GUI"));
 
-    // the display
-    m_display = new DisplayManager(this);
-    m_display->SetModel(&m_model);
-    setCentralWidget(m_display);
+    // the displays: one free view, and the x-y, y-z and x-z views on demand
+    // all of them share the OpenGL context group and the uploaded geometry
+    QSplitter* displaySplitter = new QSplitter(Qt::Horizontal);
+    QSplitter* extraSplitter   = new QSplitter(Qt::Vertical);
+
+    m_display = new DisplayManager(displaySplitter);
+    m_displays.push_back(m_display);
+    m_displays.push_back(new DisplayManager(extraSplitter, m_display->Scene()));
+    m_displays.push_back(new DisplayManager(extraSplitter, m_display->Scene()));
+    m_displays.push_back(new DisplayManager(extraSplitter, m_display->Scene()));
+
+    for (std::vector<DisplayManager*>::const_iterator it = m_displays.begin(); it != m_displays.end(); ++it) {
+        (*it)->SetModel(&m_model);
+        connect(*it,  &DisplayManager::Activated,
+                this, &MainWindow::ActivateDisplay);
+        connect(*it,  &DisplayManager::Clicked,
+                this, &MainWindow::PickObject);
+        connect(*it,  &DisplayManager::FrameDrawn,
+                this, &MainWindow::ShowFrameStatistics);
+        connect(*it,  &DisplayManager::DetailNeeded,
+                this, &MainWindow::RefineDetail);
+    }
+
+    displaySplitter->addWidget(m_display);
+    displaySplitter->addWidget(extraSplitter);
+    m_extraViews = extraSplitter;
+    m_extraViews->hide();
+    setCentralWidget(displaySplitter);
+
+    // objects' tree with the name search above it
+    QDockWidget* objectsDock   = new QDockWidget(tr("Database object tree"));
+    QWidget*     objectsWidget = new QWidget();
+    QVBoxLayout* objectsLayout = new QVBoxLayout(objectsWidget);
+
+    m_searchEdit = new QLineEdit();
+    m_searchEdit->setPlaceholderText(tr("Search object names"));
+    m_searchEdit->setClearButtonEnabled(true);
+    m_searchEdit->setEnabled(false);
+    connect(m_searchEdit, &QLineEdit::textChanged,
+            this,         &MainWindow::SearchObjects);
+
+    m_searchResults = new QListWidget();
+    m_searchResults->setUniformItemSizes(true);
+    m_searchResults->hide();
+    connect(m_searchResults, &QListWidget::itemActivated,
+            this,            &MainWindow::ShowSearchResult);
+    connect(m_searchResults, &QListWidget::itemClicked,
+            this,            &MainWindow::ShowSearchResult);
 
-    // objects' tree
-    QDockWidget* objectsDock = new QDockWidget(tr("Database object tree"));
     m_objectsTree = new QTreeWidget();
     m_objectsTree->setRootIsDecorated(true);
     m_objectsTree->setColumnCount(1);
@@ -137,9 +524,53 @@ MainWindow::MainWindow
     connect(m_objectsTree, &QTreeWidget::itemSelectionChanged,
             this,          &MainWindow::SelectObjects);
 
-    objectsDock->setWidget(m_objectsTree);
+    objectsLayout->setContentsMargins(0, 0, 0, 0);
+    objectsLayout->addWidget(m_searchEdit);
+    objectsLayout->addWidget(m_searchResults);
+    objectsLayout->addWidget(m_objectsTree, 1);
+    objectsDock->setWidget(objectsWidget);
     addDockWidget(Qt::LeftDockWidgetArea, objectsDock);
 
+    // watching the database file
+    m_fileWatcher = new QFileSystemWatcher(this);
+    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged,
+            this,          &MainWindow::FileChanged);
+
+    m_reloadTimer = new QTimer(this);
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(ReloadDelay);
+    connect(m_reloadTimer, &QTimer::timeout,
+            this,          &MainWindow::ReloadDatabase);
+
+    // memory usage
+    QDockWidget* memoryDock   = new QDockWidget(tr("Memory usage"));
+    QWidget*     memoryWidget = new QWidget();
+    QVBoxLayout* memoryLayout = new QVBoxLayout(memoryWidget);
+
+    m_memoryView = new QTreeWidget();
+    m_memoryView->setColumnCount(2);
+    m_memoryView->setHeaderLabels(QStringList() << tr("Subsystem") << tr("Size"));
+
+    m_budgetEdit = new QSpinBox();
+    m_budgetEdit->setRange(0, MaxMemoryBudget);
+    m_budgetEdit->setPrefix(tr("Budget: "));
+    m_budgetEdit->setSuffix(tr(" MiB"));
+    m_budgetEdit->setSpecialValueText(tr("No budget"));
+    m_budgetEdit->setToolTip(tr("The plots are released after their upload when the main memory exceeds the budget"));
+    connect(m_budgetEdit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this,         &MainWindow::ChangeMemoryBudget);
+
+    memoryLayout->setContentsMargins(0, 0, 0, 0);
+    memoryLayout->addWidget(m_memoryView, 1);
+    memoryLayout->addWidget(m_budgetEdit);
+    memoryDock->setWidget(memoryWidget);
+    addDockWidget(Qt::LeftDockWidgetArea, memoryDock);
+    memoryDock->hide();
+
+    // frame statistics
+    m_frameStatistics = new QLabel();
+    statusBar()->addPermanentWidget(m_frameStatistics);
+
     // file menu
     QAction* dbOpenAction = new QAction(tr("Open database"));
     dbOpenAction->setShortcuts(QKeySequence::Open);
@@ -147,6 +578,15 @@ MainWindow::MainWindow
     connect(dbOpenAction, &QAction::triggered,
             this,         &MainWindow::OpenDatabase);
 
+    QAction* plotOpenAction = new QAction(tr("Import plot3 file"));
+    plotOpenAction->setToolTip(tr("Show a UNIX-plot file together with the selected objects"));
+    connect(plotOpenAction, &QAction::triggered,
+            this,           &MainWindow::OpenPlot);
+
+    QAction* plotRemoveAction = new QAction(tr("Remove imported plots"));
+    connect(plotRemoveAction, &QAction::triggered,
+            this,             &MainWindow::RemoveImportedPlots);
+
     QAction* exitAction = new QAction(tr("Exit"));
     exitAction->setShortcuts(QKeySequence::Quit);
     exitAction->setToolTip(tr("Terminates the program"));
@@ -155,6 +595,8 @@ MainWindow::MainWindow
 
     QMenu* fileMenu = menuBar()->addMenu(tr("File"));
     fileMenu->addAction(dbOpenAction);
+    fileMenu->addAction(plotOpenAction);
+    fileMenu->addAction(plotRemoveAction);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAction);
 
@@ -179,17 +621,162 @@ MainWindow::MainWindow
     connect(setToYZPlaneAction, &QAction::triggered,
             this,               &MainWindow::SetToYZPlane);
 
+    QAction* fourViewsAction = new QAction(tr("Four views"));
+    fourViewsAction->setToolTip(tr("Shows the x-y, y-z and x-z planes beside the free view"));
+    fourViewsAction->setCheckable(true);
+    connect(fourViewsAction, &QAction::toggled,
+            this,            &MainWindow::ShowFourViews);
+
     QMenu* viewMenu = menuBar()->addMenu(tr("View"));
     viewMenu->addAction(fitToWindowAction);
     viewMenu->addAction(setToXYPlaneAction);
     viewMenu->addAction(setToXZPlaneAction);
     viewMenu->addAction(setToYZPlaneAction);
+    viewMenu->addSeparator();
+    viewMenu->addAction(fourViewsAction);
+    viewMenu->addAction(memoryDock->toggleViewAction());
 
     if (fileName != 0)
         LoadDatabase(fileName);
 }
 
 
+MainWindow::~MainWindow(void) {
+    if (m_nameIndexThread.joinable())
+        m_nameIndexThread.join();
+
+    for (std::vector<std::thread>::iterator it = m_importThreads.begin(); it != m_importThreads.end(); ++it)
+        it->join();
+
+    // the thread goes before the displays
+    SetRenderThread(false);
+}
+
+
+void MainWindow::SetMemoryBudget
+(
+    size_t megaBytes
+) {
+    m_budgetEdit->setValue(static_cast<int>(std::min(megaBytes, static_cast<size_t>(MaxMemoryBudget))));
+}
+
+
+void MainWindow::SetRenderThread
+(
+    bool on
+) {
+    if (on && !m_renderThread)
+        m_renderThread.reset(new RenderThread(m_display->Scene()));
+
+    for (std::vector<DisplayManager*>::const_iterator it = m_displays.begin(); it != m_displays.end(); ++it)
+        (*it)->SetRenderThread(on ? m_renderThread.get() : 0);
+
+    if (!on)
+        m_renderThread.reset();
+}
+
+
+void MainWindow::ImportPlot
+(
+    const QString& fileName
+) {
+    statusBar()->showMessage(tr("Importing %1").arg(fileName));
+
+    // the file is read and its geometries are prepared on a thread of their own
+    m_importThreads.push_back(std::thread([this, fileName]() {
+        QString                 error;
+        Plot3Reader::PlotPieces pieces;
+        std::vector<Geometry*>  plots = Plot3Reader::Read(fileName, error, pieces);
+
+        ParallelFor(plots.size(), [&plots](size_t i) {
+            plots[i]->Prepare();
+        });
+
+        // back on the UI thread
+        QMetaObject::invokeMethod(this, [this, fileName, error, pieces, plots]() {
+            m_importedPlots.insert(plots.begin(), plots.end());
+            m_plotPieces.insert(pieces.begin(), pieces.end());
+            m_model.Append(plots);
+            UpdateMemoryUsage();
+
+            if (error.isEmpty())
+                statusBar()->showMessage(tr("Imported %1 plots from %2").arg(plots.size()).arg(fileName));
+            else
+                statusBar()->showMessage(tr("Can't read %1 completely: %2").arg(fileName).arg(error));
+
+            m_display->Redraw();
+            FitViews();
+        }, Qt::QueuedConnection);
+    }));
+}
+
+
+QJsonObject MainWindow::Benchmark
+(
+    const char* fileName,
+    size_t      frameCount
+) {
+    QJsonObject   times;
+    QJsonObject   ret;
+    QElapsedTimer timer;
+
+    setAttribute(Qt::WA_DontShowOnScreen);
+    show();
+    QApplication::processEvents(); // initializes the OpenGL contexts
+
+    // the steps of LoadDatabase()
+    timer.start();
+
+    if (!m_database.Load(fileName))
+        return ret;
+
+    times["load"] = timer.nsecsElapsed() / 1000000.;
+    m_fileName    = QString::fromUtf8(fileName);
+    timer.restart();
+    m_names.Clear();
+    ReadSignatures();
+    FillObjectsTree();
+    times["treeBuild"] = timer.nsecsElapsed() / 1000000.;
+
+    // the selection of the whole database with one plot
+    timer.restart();
+    m_objectsTree->blockSignals(true);
+
+    for (int i = 0; i < m_objectsTree->topLevelItemCount(); ++i)
+        m_objectsTree->topLevelItem(i)->setSelected(true);
+
+    m_objectsTree->blockSignals(false);
+    SelectObjects();
+    times["plot"] = timer.nsecsElapsed() / 1000000.;
+
+    // the first frame records and uploads the scene
+    timer.restart();
+    m_display->grabFramebuffer();
+    times["firstFrame"] = timer.nsecsElapsed() / 1000000.;
+
+    qint64 frameTime = 0;
+
+    // the unchanged frame would be shown again, a full one is measured
+    for (size_t i = 0; i < frameCount; ++i) {
+        m_display->Show();
+        m_display->grabFramebuffer();
+        frameTime += m_display->Statistics().frameTime;
+    }
+
+    times["frame"] = (frameCount > 0) ? frameTime / 1000000. / frameCount : 0.;
+
+    UpdateMemoryUsage();
+
+    ret["file"]       = m_fileName;
+    ret["topObjects"] = m_objectsTree->topLevelItemCount();
+    ret["plots"]      = static_cast<double>(m_geometryItems.size());
+    ret["times"]      = times;
+    ret["memory"]     = m_memoryUsage.ToJson();
+
+    return ret;
+}
+
+
 void MainWindow::LoadDatabase
 (
     const char* fileName
@@ -202,25 +789,207 @@ void MainWindow::LoadDatabase
         title += "]";
 
         setWindowTitle(title);
+
+        m_fileName = QString::fromUtf8(fileName);
+        WatchFile(m_fileName);
+        m_names.Clear(); // the IDs stay valid over reloads only
+        ReadSignatures();
         FillObjectsTree();
+        UpdateMemoryUsage();
     }
 }
 
 
-void MainWindow::FillObjectsTree(void) {
-    m_objectsTree->clear();
+void MainWindow::WatchFile
+(
+    const QString& fileName
+) {
+    // an editor may have replaced the file, this ends its watching
+    if (!m_fileWatcher->files().contains(fileName)) {
+        if (!m_fileWatcher->files().isEmpty())
+            m_fileWatcher->removePaths(m_fileWatcher->files());
+
+        m_fileWatcher->addPath(fileName);
+    }
+}
+
+
+void MainWindow::ReadSignatures(void) {
+    m_topObjects.clear();
+    m_objectSignatures.clear();
 
     BRLCAD::ConstDatabase::TopObjectIterator topObjectIterator = m_database.FirstTopObject();
 
     while (topObjectIterator.Good()) {
-        TopObjectCallback topObjectCallback(m_objectsTree, m_database);
-
-        m_database.Get(topObjectIterator.Name(), topObjectCallback);
+        m_topObjects.push_back(m_names.Id(topObjectIterator.Name()));
+        CollectSignatures(m_database, topObjectIterator.Name(), m_names, m_objectSignatures);
         ++topObjectIterator;
     }
 }
 
 
+void MainWindow::FillObjectsTree(void) {
+    m_geometryItems.clear();
+    m_highlightedItem = 0;
+    m_treeItems.clear();
+    m_nameIndex.reset();
+    m_searchEdit->setEnabled(false);
+    m_searchEdit->clear();
+    m_searchResults->clear();
+    m_searchResults->hide();
+    m_objectsTree->clear();
+
+    // the hierarchy is expanded on the worker threads
+    QElapsedTimer   timer;
+    ObjectHierarchy hierarchy;
+
+    timer.start();
+    hierarchy.Build(m_database, m_names);
+
+    qint64               hierarchyTime = timer.nsecsElapsed();
+    std::vector<QString> names(m_names.Size()); // per object, shared by its items
+
+    ParallelFor(names.size(), [this, &names](size_t i) {
+        names[i] = QString::fromUtf8(m_names.Name(static_cast<unsigned int>(i)).c_str());
+    });
+
+    // the items are linked before the tree gets them in one step,
+    // the name index gets the nodes as its entries, its indexing is left to a worker thread
+    std::shared_ptr<NameIndex> nameIndex = std::make_shared<NameIndex>();
+    QList<QTreeWidgetItem*>    topItems;
+
+    m_treeItems.resize(hierarchy.NodeCount());
+
+    for (size_t node = 0; node < hierarchy.NodeCount(); ++node) {
+        QTreeWidgetItem* item   = new QTreeWidgetItem();
+        size_t           parent = hierarchy.NodeParent(node);
+
+        item->setText(0, names[hierarchy.NodeName(node)]);
+        item->setData(0, Qt::UserRole, hierarchy.NodeName(node));
+        m_treeItems[node] = item;
+        nameIndex->Add(hierarchy.NodeName(node), m_names.Name(hierarchy.NodeName(node)), (parent == ObjectHierarchy::NoParent) ? NameIndex::NoParent : parent);
+
+        if (parent == ObjectHierarchy::NoParent)
+            topItems.append(item);
+        else
+            m_treeItems[parent]->addChild(item);
+    }
+
+    m_objectsTree->addTopLevelItems(topItems);
+
+    statusBar()->showMessage(tr("Built the object tree of %1 nodes in %2 ms, the hierarchy took %3 ms on %4 threads")
+                             .arg(hierarchy.NodeCount())
+                             .arg(timer.nsecsElapsed() / 1000000.)
+                             .arg(hierarchyTime / 1000000.)
+                             .arg(WorkerCount()));
+
+    UpdateTreeBytes();
+    BuildNameIndex(nameIndex);
+}
+
+
+// the changed sub-trees come from the hierarchy like the ones of FillObjectsTree(), the top objects go in their order
+void MainWindow::PatchObjectsTree
+(
+    const std::set<unsigned int>& changedObjects
+) {
+    ObjectHierarchy hierarchy;
+
+    hierarchy.Build(m_database, m_names);
+
+    std::vector<size_t>                       firstNodes = FirstNodes(hierarchy, m_names.Size());
+    std::set<unsigned int>                    topObjects(m_topObjects.begin(), m_topObjects.end());
+    std::map<unsigned int, QTreeWidgetItem*> topItems;
+
+    for (int i = m_objectsTree->topLevelItemCount() - 1; i >= 0; --i) {
+        QTreeWidgetItem* item     = m_objectsTree->topLevelItem(i);
+        unsigned int     objectId = ItemObjectId(item);
+
+        if (topObjects.find(objectId) == topObjects.end())
+            delete m_objectsTree->takeTopLevelItem(i);
+        else {
+            topItems[objectId] = item;
+
+            if (changedObjects.find(objectId) != changedObjects.end())
+                RegenerateTreeItem(item, hierarchy, firstNodes, m_names);
+            else
+                PatchTreeItem(item, hierarchy, firstNodes, m_names, changedObjects, m_objectSignatures);
+        }
+    }
+
+    int row = 0;
+
+    for (std::vector<unsigned int>::const_iterator it = m_topObjects.begin(); it != m_topObjects.end(); ++it) {
+        std::map<unsigned int, QTreeWidgetItem*>::const_iterator topItem = topItems.find(*it);
+        QTreeWidgetItem*                                         item    = 0;
+
+        if (topItem != topItems.end())
+            item = topItem->second;
+        else if ((*it < firstNodes.size()) && (firstNodes[*it] != ObjectHierarchy::NoParent)) {
+            item = new QTreeWidgetItem();
+            item->setText(0, QString::fromUtf8(m_names.Name(*it).c_str()));
+            item->setData(0, Qt::UserRole, *it);
+            AddHierarchyItems(item, hierarchy, firstNodes[*it], m_names);
+        }
+
+        if (item != 0) {
+            int index = m_objectsTree->indexOfTopLevelItem(item);
+
+            if (index != row) {
+                if (index >= 0)
+                    m_objectsTree->takeTopLevelItem(index);
+
+                m_objectsTree->insertTopLevelItem(row, item);
+            }
+
+            ++row;
+        }
+    }
+
+    UpdateTreeBytes();
+}
+
+
+void MainWindow::RebuildNameIndex(void) {
+    std::shared_ptr<NameIndex> nameIndex = std::make_shared<NameIndex>();
+
+    m_treeItems.clear();
+    m_nameIndex.reset();
+    m_searchEdit->setEnabled(false);
+    m_searchResults->clear();
+    m_searchResults->hide();
+
+    for (int i = 0; i < m_objectsTree->topLevelItemCount(); ++i)
+        AddToNameIndex(m_objectsTree->topLevelItem(i), NameIndex::NoParent, m_names, *nameIndex, m_treeItems);
+
+    BuildNameIndex(nameIndex);
+}
+
+
+void MainWindow::BuildNameIndex
+(
+    std::shared_ptr<NameIndex> nameIndex
+) {
+    if (m_nameIndexThread.joinable())
+        m_nameIndexThread.join();
+
+    m_pendingNameIndex = nameIndex;
+    m_nameIndexThread  = std::thread([this, nameIndex]() {
+        nameIndex->Build();
+
+        // back on the UI thread, a newer index may be on its way already
+        QMetaObject::invokeMethod(this, [this, nameIndex]() {
+            if (m_pendingNameIndex == nameIndex) {
+                m_nameIndex = nameIndex;
+                m_pendingNameIndex.reset();
+                m_searchEdit->setEnabled(true);
+                UpdateMemoryUsage();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+
 void MainWindow::OpenDatabase(void) {
     QString fileName = QFileDialog::getOpenFileName(this,
                                                     tr("Open BRL-CAD .g database file"),
@@ -231,45 +1000,626 @@ void MainWindow::OpenDatabase(void) {
 }
 
 
+void MainWindow::OpenPlot(void) {
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Import UNIX-plot file"),
+                                                    QString(),
+                                                    "UNIX-plot file (*.plot3 *.pl);;All files (*)");
+
+    if (!fileName.isEmpty())
+        ImportPlot(fileName);
+}
+
+
+void MainWindow::RemoveImportedPlots(void) {
+    m_model.Remove(std::vector<const Geometry*>(m_importedPlots.begin(), m_importedPlots.end()));
+    m_importedPlots.clear();
+    m_plotPieces.clear();
+    UpdateMemoryUsage();
+
+    m_display->Redraw();
+}
+
+
+void MainWindow::FileChanged
+(
+    const QString& fileName
+) {
+    // a writer may need some time, the reload waits until the file stays unchanged
+    if (fileName == m_fileName)
+        m_reloadTimer->start();
+}
+
+
+void MainWindow::ReloadDatabase(void) {
+    // the tree items may go, the selection and the plots are kept by their paths
+    std::map<PlotKey, const Geometry*>     pathGeometries;
+    std::vector<std::vector<unsigned int>> selectedPaths;
+    QList<QTreeWidgetItem*>                selectedItems = m_objectsTree->selectedItems();
+
+    for (std::map<const Geometry*, QTreeWidgetItem*>::const_iterator it = m_geometryItems.begin(); it != m_geometryItems.end(); ++it)
+        pathGeometries[GeometryKey(ItemIdPath(it->second), *it->first, m_names)] = it->first;
+
+    for (QList<QTreeWidgetItem*>::const_iterator it = selectedItems.begin(); it != selectedItems.end(); ++it)
+        selectedPaths.push_back(ItemIdPath(*it));
+
+    // an incomplete file will be followed by another change
+    if (!m_database.Load(m_fileName.toUtf8().data()))
+        return;
+
+    WatchFile(m_fileName);
+
+    std::vector<unsigned int>      oldTopObjects;
+    std::map<unsigned int, size_t> oldSignatures;
+
+    oldTopObjects.swap(m_topObjects);
+    oldSignatures.swap(m_objectSignatures);
+    ReadSignatures();
+
+    std::set<unsigned int> changedObjects;
+
+    for (std::map<unsigned int, size_t>::const_iterator it = oldSignatures.begin(); it != oldSignatures.end(); ++it) {
+        std::map<unsigned int, size_t>::const_iterator newSignature = m_objectSignatures.find(it->first);
+
+        if ((newSignature == m_objectSignatures.end()) || (newSignature->second != it->second))
+            changedObjects.insert(it->first);
+    }
+
+    for (std::map<unsigned int, size_t>::const_iterator it = m_objectSignatures.begin(); it != m_objectSignatures.end(); ++it) {
+        if (oldSignatures.find(it->first) == oldSignatures.end())
+            changedObjects.insert(it->first);
+    }
+
+    // patching the tree shall not trigger a new plot of the whole selection
+    m_objectsTree->blockSignals(true);
+    Highlight(0);
+
+    if (!changedObjects.empty() || (oldTopObjects != m_topObjects)) {
+        PatchObjectsTree(changedObjects);
+        RebuildNameIndex();
+    }
+
+    m_objectsTree->clearSelection();
+
+    for (std::vector<std::vector<unsigned int>>::const_iterator it = selectedPaths.begin(); it != selectedPaths.end(); ++it) {
+        QTreeWidgetItem* item = FindItem(m_objectsTree, *it);
+
+        if (item != 0)
+            item->setSelected(true);
+    }
+
+    m_objectsTree->blockSignals(false);
+
+    size_t replottedRegions = UpdateSelectedGeometries(pathGeometries, changedObjects);
+
+    statusBar()->showMessage(tr("Reloaded %1: %2 objects changed, %3 regions replotted")
+                             .arg(m_fileName)
+                             .arg(changedObjects.size())
+                             .arg(replottedRegions));
+}
+
+
 void MainWindow::FitToWindow(void) {
     m_display->FitToWindow();
-    m_display->Redraw();
+    m_display->Show();
 }
 
 
 void MainWindow::SetToXYPlane(void){
     m_display->SetToXYPlane();
-    m_display->Redraw();
+    m_display->Show();
 }
 
 
 void MainWindow::SetToYZPlane(void){
     m_display->SetToYZPlane();
-    m_display->Redraw();
+    m_display->Show();
 }
 
 
 void MainWindow::SetToXZPlane(void){
     m_display->SetToXZPlane();
-    m_display->Redraw();
+    m_display->Show();
+}
+
+
+void MainWindow::FitViews(void) {
+    m_displays[0]->FitToWindow();
+    m_displays[1]->SetToXYPlane();
+    m_displays[2]->SetToYZPlane();
+    m_displays[3]->SetToXZPlane();
+
+    for (std::vector<DisplayManager*>::const_iterator it = m_displays.begin(); it != m_displays.end(); ++it)
+        (*it)->Show();
+}
+
+
+void MainWindow::ShowFourViews
+(
+    bool on
+) {
+    m_extraViews->setVisible(on);
+
+    if (!on)
+        m_display = m_displays[0];
+}
+
+
+void MainWindow::ActivateDisplay
+(
+    DisplayManager* displayManager
+) {
+    m_display = displayManager;
+}
+
+
+void MainWindow::ShowFrameStatistics
+(
+    DisplayManager*        displayManager,
+    const FrameStatistics& statistics
+) {
+    if (displayManager == m_display) {
+        m_frameStatistics->setText(tr("frame %1 ms, %2 chunks drawn, %3 culled, %4 draw calls, %5 vertices, %6 batches, "
+                                      "%7 selected objects covered by others")
+                                   .arg(statistics.frameTime / 1000000.)
+                                   .arg(statistics.drawnChunks)
+                                   .arg(statistics.culledChunks)
+                                   .arg(statistics.drawCalls)
+                                   .arg(statistics.drawnVertices)
+                                   .arg(statistics.drawnBatches)
+                                   .arg(m_coveredSelections));
+
+        if (statistics.uploadedFloats > 0)
+            statusBar()->showMessage(tr("Uploaded %1 coordinates with %2 copies each, at most %3 kB staged")
+                                     .arg(statistics.uploadedFloats)
+                                     .arg(static_cast<double>(statistics.copiedFloats) / statistics.uploadedFloats)
+                                     .arg(statistics.peakStagingBytes / 1024));
+    }
+
+    // the plots can go with the new scene on the graphics card
+    if (statistics.uploadedFloats > 0) {
+        UpdateMemoryUsage();
+        EnforceMemoryBudget();
+    }
+}
+
+
+// only the geometries with levels too coarse for the views are recorded again, on a thread of the display's,
+// the rest of the scene stays on the graphics card
+void MainWindow::RefineDetail(void) {
+    std::vector<const Geometry*>                       geometries = m_display->Scene()->CoarseGeometries();
+    std::vector<const Geometry*>                       sorted(geometries);
+    std::shared_ptr<const GeometryModel::GeometryList> snapshot   = m_model.Snapshot();
+    std::vector<GeometryModel::Replacement>            restoredPlots;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    // a released plot needs its vector list for the new levels, a plot of it takes its place, the budget may release it again afterwards
+    // an imported plot is read again from its file
+    for (GeometryModel::GeometryList::const_iterator it = snapshot->begin(); it != snapshot->end(); ++it) {
+        const PlotGeometry* plot = dynamic_cast<const PlotGeometry*>(it->get());
+
+        if ((plot != 0) && plot->Released() && std::binary_search(sorted.begin(), sorted.end(), plot)) {
+            Plot3Reader::PlotPieces::const_iterator piece    = m_plotPieces.find(plot);
+            PlotGeometry*                           restored = 0;
+
+            if (piece == m_plotPieces.end())
+                restored = plot->RestoredClone(m_database);
+            else {
+                QString error;
+
+                restored = Plot3Reader::ReadPiece(piece->second, error);
+
+                if (restored == 0)
+                    statusBar()->showMessage(tr("Can't read %1 again: %2").arg(piece->second.fileName).arg(error));
+            }
+
+            if (restored != 0)
+                restoredPlots.push_back(GeometryModel::Replacement(plot, restored));
+        }
+    }
+
+    if (!restoredPlots.empty()) {
+        ReplaceGeometries(restoredPlots);
+        geometries = m_display->Scene()->CoarseGeometries();
+    }
+
+    m_display->RefineDetail(geometries);
+}
+
+
+void MainWindow::PickObject
+(
+    DisplayManager* displayManager,
+    const QPoint&   displayPoint
+) {
+    QElapsedTimer timer;
+    timer.start();
+
+    const Geometry* geometry = m_pickIndex.Nearest(displayManager->Model2DisplayTrafo(),
+                                                   displayManager->Display2ModelTrafo(),
+                                                   displayPoint,
+                                                   PickDistance);
+    qint64          time     = timer.nsecsElapsed();
+
+    if (geometry != 0) {
+        std::map<const Geometry*, QTreeWidgetItem*>::const_iterator it = m_geometryItems.find(geometry);
+
+        if (it != m_geometryItems.end()) {
+            Highlight(it->second);
+            statusBar()->showMessage(tr("Picked %1 in %2 microseconds").arg(it->second->text(0)).arg(time / 1000.));
+        }
+    }
+    else {
+        Highlight(0);
+        statusBar()->showMessage(tr("Nothing picked in %1 microseconds").arg(time / 1000.));
+    }
+}
+
+
+void MainWindow::Highlight
+(
+    QTreeWidgetItem* item
+) {
+    if (m_highlightedItem != 0)
+        m_highlightedItem->setBackground(0, QBrush());
+
+    m_highlightedItem = item;
+
+    if (m_highlightedItem != 0) {
+        m_highlightedItem->setBackground(0, QBrush(QColor(255, 220, 120)));
+        m_objectsTree->scrollToItem(m_highlightedItem);
+    }
 }
 
 
 void MainWindow::SelectObjects(void) {
-    QList<QTreeWidgetItem*> selectedItems = m_objectsTree->selectedItems();
+    QList<QTreeWidgetItem*>      selectedItems = NormalizeSelection(m_objectsTree->selectedItems(), m_coveredSelections);
+    std::vector<Geometry*>       newGeometries;
+    std::vector<const Geometry*> geometries;
 
+    Highlight(0);
+    m_pickIndex.Clear();
+    m_geometryItems.clear();
     m_database.UnSelectAll();
-    m_model.Clear();
+
+    // the imported plots stay
+    std::shared_ptr<const GeometryModel::GeometryList> oldGeometries = m_model.Snapshot();
+    std::vector<const Geometry*>                       deselectedGeometries;
+
+    for (GeometryModel::GeometryList::const_iterator it = oldGeometries->begin(); it != oldGeometries->end(); ++it) {
+        if (m_importedPlots.find(it->get()) == m_importedPlots.end())
+            deselectedGeometries.push_back(it->get());
+    }
+
+    m_model.Remove(deselectedGeometries);
 
     for (QList<QTreeWidgetItem*>::const_iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
-        QByteArray objectName = (*it)->text(0).toUtf8();
-        PlotGeometry* plot = new PlotGeometry();
+        const char*                objectName = m_names.Name(ItemObjectId(*it)).c_str();
+        std::vector<PlotGeometry*> plots      = PlotGeometry::PlotRegions(m_database, objectName);
 
         m_database.Select(objectName);
-        m_database.Plot(objectName, plot->VectorList());
-        m_model.Append(plot);
+
+        for (std::vector<PlotGeometry*>::const_iterator plot = plots.begin(); plot != plots.end(); ++plot) {
+            newGeometries.push_back(*plot);
+            geometries.push_back(*plot);
+            m_geometryItems[*plot] = *it;
+        }
     }
 
-    m_display->FitToWindow();
+    m_model.Append(newGeometries);
+    m_pickIndex.Insert(geometries);
+    UpdateMemoryUsage();
+
     m_display->Redraw();
+    FitViews();
+}
+
+
+size_t MainWindow::UpdateSelectedGeometries
+(
+    const std::map<PlotKey, const Geometry*>& pathGeometries,
+    const std::set<unsigned int>&             changedObjects
+) {
+    QList<QTreeWidgetItem*>                     selectedItems = NormalizeSelection(m_objectsTree->selectedItems(), m_coveredSelections);
+    std::map<const Geometry*, QTreeWidgetItem*> geometryItems;
+    std::vector<PlotGeometry*>                  newPlots;
+    std::set<unsigned int>                      affectedObjects;
+
+    for (int i = 0; i < m_objectsTree->topLevelItemCount(); ++i)
+        MarkAffected(m_objectsTree->topLevelItem(i), changedObjects, affectedObjects);
+
+    m_database.UnSelectAll();
+
+    for (QList<QTreeWidgetItem*>::const_iterator it = selectedItems.begin(); it != selectedItems.end(); ++it) {
+        const std::string&                                 objectName = m_names.Name(ItemObjectId(*it));
+        std::vector<unsigned int>                          itemPath   = ItemIdPath(*it);
+        std::map<PlotKey, const Geometry*>::const_iterator oldPlots   = pathGeometries.lower_bound(PlotKey(itemPath, std::vector<unsigned int>()));
+        bool                                               unchanged  = (affectedObjects.find(ItemObjectId(*it)) == affectedObjects.end()) &&
+                                                                        (oldPlots != pathGeometries.end()) && (oldPlots->first.first == itemPath);
+
+        m_database.Select(objectName.c_str());
+
+        if (unchanged) {
+            // nothing below the object changed, its plots stay as they are
+            for (; (oldPlots != pathGeometries.end()) && (oldPlots->first.first == itemPath); ++oldPlots)
+                geometryItems[oldPlots->second] = *it;
+        }
+        else {
+            // only the regions which depend on a changed object are plotted again
+            std::vector<std::pair<std::string, QColor> > regions = PlotGeometry::Regions(m_database, objectName.c_str());
+
+            for (std::vector<std::pair<std::string, QColor> >::const_iterator region = regions.begin(); region != regions.end(); ++region) {
+                std::vector<unsigned int>                          regionIds   = PathIds(region->first, m_names);
+                std::map<PlotKey, const Geometry*>::const_iterator oldGeometry = pathGeometries.find(PlotKey(itemPath, regionIds));
+                const PlotGeometry*                                oldPlot     = 0;
+
+                if (oldGeometry != pathGeometries.end())
+                    oldPlot = dynamic_cast<const PlotGeometry*>(oldGeometry->second);
+
+                if ((oldPlot != 0) && (oldPlot->Color() == region->second) && !RegionChanged(regionIds, changedObjects, affectedObjects))
+                    geometryItems[oldPlot] = *it;
+                else {
+                    PlotGeometry* plot = PlotGeometry::PlotRegion(m_database, region->first, region->second);
+
+                    geometryItems[plot] = *it;
+                    newPlots.push_back(plot);
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<const GeometryModel::GeometryList> geometries = m_model.Snapshot();
+    std::vector<const Geometry*>                       obsoleteGeometries;
+
+    for (GeometryModel::GeometryList::const_iterator it = geometries->begin(); it != geometries->end(); ++it) {
+        if ((geometryItems.find(it->get()) == geometryItems.end()) && (m_importedPlots.find(it->get()) == m_importedPlots.end()))
+            obsoleteGeometries.push_back(it->get());
+    }
+
+    m_pickIndex.Remove(obsoleteGeometries);
+
+    // one new snapshot for all changes
+    std::vector<const Geometry*> insertedGeometries(newPlots.begin(), newPlots.end());
+
+    m_model.Remove(obsoleteGeometries);
+    m_model.Append(std::vector<Geometry*>(newPlots.begin(), newPlots.end()));
+
+    m_pickIndex.Insert(insertedGeometries);
+    m_geometryItems.swap(geometryItems);
+    UpdateMemoryUsage();
+
+    // the views keep their projections
+    if (!newPlots.empty() || !obsoleteGeometries.empty())
+        m_display->Redraw();
+
+    return newPlots.size();
+}
+
+
+void MainWindow::SearchObjects
+(
+    const QString& pattern
+) {
+    m_searchResults->clear();
+
+    if ((m_nameIndex == 0) || pattern.isEmpty()) {
+        m_searchResults->hide();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<size_t> entries = m_nameIndex->Find(pattern.toUtf8().data(), MaxSearchResults);
+    qint64              time    = timer.nsecsElapsed();
+
+    for (std::vector<size_t>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        QListWidgetItem* item = new QListWidgetItem(QString::fromUtf8(m_nameIndex->Path(*it).c_str()), m_searchResults);
+
+        item->setData(Qt::UserRole, QVariant(static_cast<qulonglong>(*it)));
+    }
+
+    m_searchResults->setVisible(!entries.empty());
+    statusBar()->showMessage(tr("%1 matches in %2 ms").arg(entries.size()).arg(time / 1000000.));
+}
+
+
+void MainWindow::ShowSearchResult
+(
+    QListWidgetItem* item
+) {
+    if ((item == 0) || (m_nameIndex == 0))
+        return;
+
+    size_t entry = static_cast<size_t>(item->data(Qt::UserRole).toULongLong());
+
+    if (entry < m_treeItems.size()) {
+        QTreeWidgetItem* treeItem = m_treeItems[entry];
+
+        // only the path to the found object will be opened
+        for (QTreeWidgetItem* parent = treeItem->parent(); parent != 0; parent = parent->parent())
+            parent->setExpanded(true);
+
+        m_objectsTree->setCurrentItem(treeItem);
+        m_objectsTree->scrollToItem(treeItem);
+    }
+}
+
+
+void MainWindow::ChangeMemoryBudget
+(
+    int megaBytes
+) {
+    m_memoryUsage.SetBudget(static_cast<size_t>(megaBytes) * 1024 * 1024);
+    UpdateMemoryUsage();
+    EnforceMemoryBudget();
+}
+
+
+void MainWindow::UpdateMemoryUsage(void) {
+    // the database holds the content of its file
+    m_memoryUsage.SetBytes(MemoryUsage::Subsystem::Database, m_fileName.isEmpty() ? 0 : static_cast<size_t>(QFileInfo(m_fileName).size()));
+
+    // the region plots are summed up per selected object, the plots keep their byte counts
+    std::map<QTreeWidgetItem*, size_t>          itemBytes;
+    std::map<std::vector<unsigned int>, size_t> objectBytes;
+    size_t                                      plotBytes = 0;
+
+    for (std::map<const Geometry*, QTreeWidgetItem*>::const_iterator it = m_geometryItems.begin(); it != m_geometryItems.end(); ++it) {
+        const PlotGeometry* plot = dynamic_cast<const PlotGeometry*>(it->first);
+
+        if (plot != 0) {
+            size_t bytes = plot->Bytes();
+
+            plotBytes             += bytes;
+            itemBytes[it->second] += bytes;
+        }
+    }
+
+    for (std::map<QTreeWidgetItem*, size_t>::const_iterator it = itemBytes.begin(); it != itemBytes.end(); ++it)
+        objectBytes[ItemIdPath(it->first)] = it->second;
+
+    for (std::set<const Geometry*>::const_iterator it = m_importedPlots.begin(); it != m_importedPlots.end(); ++it) {
+        const PlotGeometry*       plot       = dynamic_cast<const PlotGeometry*>(*it);
+        const PointCloudGeometry* pointCloud = dynamic_cast<const PointCloudGeometry*>(*it);
+
+        if (plot != 0)
+            plotBytes += plot->Bytes();
+        else if (pointCloud != 0)
+            plotBytes += pointCloud->Bytes();
+    }
+
+    m_memoryUsage.SetBytes(MemoryUsage::Subsystem::Plots, plotBytes);
+    m_memoryUsage.ClearObjects();
+
+    for (std::map<std::vector<unsigned int>, size_t>::const_iterator it = objectBytes.begin(); it != objectBytes.end(); ++it)
+        m_memoryUsage.SetObjectBytes(PathName(it->first, m_names), it->second);
+
+    m_memoryUsage.SetBytes(MemoryUsage::Subsystem::ObjectsTree, m_treeBytes + m_treeItems.capacity() * sizeof(QTreeWidgetItem*));
+    m_memoryUsage.SetBytes(MemoryUsage::Subsystem::SearchIndex, m_nameIndex ? m_nameIndex->Bytes() : 0);
+    m_memoryUsage.SetBytes(MemoryUsage::Subsystem::PickIndex, m_pickIndex.Bytes());
+    m_memoryUsage.SetBytes(MemoryUsage::Subsystem::GpuBuffers, m_display->Scene()->GpuBytes());
+
+    // the panel
+    const std::pair<MemoryUsage::Subsystem, QString> subsystems[] = {
+        {MemoryUsage::Subsystem::Database,    tr("Database")},
+        {MemoryUsage::Subsystem::Plots,       tr("Plots")},
+        {MemoryUsage::Subsystem::ObjectsTree, tr("Object tree")},
+        {MemoryUsage::Subsystem::SearchIndex, tr("Search index")},
+        {MemoryUsage::Subsystem::PickIndex,   tr("Pick index")},
+        {MemoryUsage::Subsystem::GpuBuffers,  tr("GPU buffers")}
+    };
+
+    m_memoryView->clear();
+
+    for (size_t i = 0; i < MemoryUsage::SubsystemCount; ++i) {
+        QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << subsystems[i].second
+                                                                  << MemoryUsage::FormatBytes(m_memoryUsage.Bytes(subsystems[i].first)));
+
+        if (subsystems[i].first == MemoryUsage::Subsystem::Plots) {
+            for (std::map<std::vector<unsigned int>, size_t>::const_iterator it = objectBytes.begin(); it != objectBytes.end(); ++it)
+                item->addChild(new QTreeWidgetItem(QStringList() << QString::fromStdString(PathName(it->first, m_names))
+                                                                 << MemoryUsage::FormatBytes(it->second)));
+        }
+
+        m_memoryView->addTopLevelItem(item);
+    }
+
+    m_memoryView->addTopLevelItem(new QTreeWidgetItem(QStringList() << tr("Main memory") << MemoryUsage::FormatBytes(m_memoryUsage.HostBytes())));
 }
+
+
+void MainWindow::UpdateTreeBytes(void) {
+    m_treeBytes = 0;
+
+    for (int i = 0; i < m_objectsTree->topLevelItemCount(); ++i)
+        m_treeBytes += TreeBytes(m_objectsTree->topLevelItem(i));
+}
+
+
+void MainWindow::EnforceMemoryBudget(void) {
+    // a recording draws the levels a released plot keeps, a refinement restores the plots it needs
+    if (!m_memoryUsage.OverBudget() || !m_display->Scene()->Valid())
+        return;
+
+    std::vector<std::pair<size_t, const PlotGeometry*> > plots;
+
+    std::shared_ptr<const GeometryModel::GeometryList> geometries = m_model.Snapshot();
+
+    for (GeometryModel::GeometryList::const_iterator it = geometries->begin(); it != geometries->end(); ++it) {
+        const PlotGeometry* plot = dynamic_cast<const PlotGeometry*>(it->get());
+
+        // the imported plots are read again from their pieces
+        if ((plot != 0) && plot->Releasable() && ((m_importedPlots.find(plot) == m_importedPlots.end()) || (m_plotPieces.find(plot) != m_plotPieces.end())))
+            plots.push_back(std::make_pair(plot->Bytes(), plot));
+    }
+
+    // the largest ones first
+    std::sort(plots.begin(), plots.end(), [](const std::pair<size_t, const PlotGeometry*>& a, const std::pair<size_t, const PlotGeometry*>& b) {
+        return a.first > b.first;
+    });
+
+    // the released clones take the plots' places in one new snapshot
+    size_t                                  hostBytes = m_memoryUsage.HostBytes();
+    std::vector<GeometryModel::Replacement> releasedPlots;
+
+    for (std::vector<std::pair<size_t, const PlotGeometry*> >::const_iterator it = plots.begin(); (it != plots.end()) && (hostBytes > m_memoryUsage.Budget()); ++it) {
+        PlotGeometry* released = it->second->ReleasedClone();
+
+        hostBytes -= std::min(hostBytes, it->first - released->Bytes());
+        releasedPlots.push_back(GeometryModel::Replacement(it->second, released));
+    }
+
+    ReplaceGeometries(releasedPlots);
+    UpdateMemoryUsage();
+
+    if (m_memoryUsage.OverBudget())
+        statusBar()->showMessage(tr("Released %1 plots, the memory usage of %2 still exceeds the budget")
+                                 .arg(releasedPlots.size())
+                                 .arg(MemoryUsage::FormatBytes(m_memoryUsage.HostBytes())));
+    else
+        statusBar()->showMessage(tr("Released %1 plots to stay within the memory budget").arg(releasedPlots.size()));
+}
+
+
+void MainWindow::ReplaceGeometries
+(
+    const std::vector<GeometryModel::Replacement>& replacements
+) {
+    if (replacements.empty())
+        return;
+
+    m_model.Replace(replacements);
+    m_pickIndex.Replace(replacements);
+
+    {
+        std::lock_guard<std::mutex> lock(m_display->Scene()->Mutex());
+
+        m_display->Scene()->ReplaceOwners(replacements);
+    }
+
+    for (std::vector<GeometryModel::Replacement>::const_iterator it = replacements.begin(); it != replacements.end(); ++it) {
+        std::map<const Geometry*, QTreeWidgetItem*>::iterator item = m_geometryItems.find(it->first);
+
+        if (item != m_geometryItems.end()) {
+            QTreeWidgetItem* treeItem = item->second;
+
+            m_geometryItems.erase(item);
+            m_geometryItems[it->second] = treeItem;
+        }
+
+        if (m_importedPlots.erase(it->first) > 0)
+            m_importedPlots.insert(it->second);
+
+        Plot3Reader::PlotPieces::iterator piece = m_plotPieces.find(it->first);
+
+        if (piece != m_plotPieces.end()) {
+            Plot3Reader::PlotPiece plotPiece = piece->second;
+
+            m_plotPieces.erase(piece);
+            m_plotPieces[it->second] = plotPiece;
+        }
+    }
+}
+
@@ -20,12 +20,32 @@
 #ifndef MAINWINDOW_INCLUDED
 #define MAINWINDOW_INCLUDED
 
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QFileSystemWatcher>
+#include <QJsonObject>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
 #include <QMainWindow>
+#include <QSpinBox>
+#include <QTimer>
 #include <QTreeWidget>
 
 #include <brlcad/Database/MemoryDatabase.h>
 
+#include "BoundingVolumeHierarchy.h"
 #include "DisplayManager.h"
+#include "MemoryUsage.h"
+#include "NameIndex.h"
+#include "NameTable.h"
+#include "Plot3Reader.h"
+#include "RenderThread.h"
 
 
 class MainWindow : public QMainWindow {
@@ -33,23 +53,100 @@ class MainWindow : public QMainWindow {
 public:
     MainWindow(const char* fileName,
                QWidget*    parent = 0);
+    ~MainWindow(void);
+
+    void        SetMemoryBudget(size_t megaBytes); // 0 for no budget
+    void        SetRenderThread(bool on);          // the views are drawn off the GUI thread
+
+    // shows a plot3 file together with the selected objects until RemoveImportedPlots()
+    void        ImportPlot(const QString& fileName);
+
+    // loads the database, selects all top objects and draws frameCount frames after the first one on a hidden window,
+    // returns the times of these steps in milliseconds, empty if the database can't be loaded
+    QJsonObject Benchmark(const char* fileName,
+                          size_t      frameCount);
 
 private:
-    BRLCAD::MemoryDatabase m_database;
-    GeometryModel          m_model;
-    DisplayManager*        m_display;
-    QTreeWidget*           m_objectsTree;
+    BRLCAD::MemoryDatabase        m_database;
+    NameTable                     m_names;    // the IDs of the objects, in the tree items' Qt::UserRole data
+    GeometryModel                 m_model;
+    DisplayManager*               m_display;  // the active view
+    std::vector<DisplayManager*>  m_displays; // free, x-y, y-z and x-z view
+    std::unique_ptr<RenderThread> m_renderThread;
+    QWidget*                      m_extraViews;
+    QTreeWidget*                  m_objectsTree;
+    QLabel*                       m_frameStatistics;
+
+    // picking
+    BoundingVolumeHierarchy                     m_pickIndex;
+    std::map<const Geometry*, QTreeWidgetItem*> m_geometryItems;
+    QTreeWidgetItem*                            m_highlightedItem;
+    size_t                                      m_coveredSelections; // selected objects which weren't plotted on their own
+    std::set<const Geometry*>                   m_importedPlots;     // from plot3 files, they stay when the selection changes
+    Plot3Reader::PlotPieces                     m_plotPieces;        // of the imported plots, they are read again from there
+    std::vector<std::thread>                    m_importThreads;     // read the plot3 files in the background
+
+    // name search: the index is build in the background, it's 0 until it's ready
+    QLineEdit*                                  m_searchEdit;
+    QListWidget*                                m_searchResults;
+    std::vector<QTreeWidgetItem*>               m_treeItems; // per entry of the name index
+    std::shared_ptr<NameIndex>                  m_nameIndex;
+    std::shared_ptr<NameIndex>                  m_pendingNameIndex;
+    std::thread                                 m_nameIndexThread;
+
+    // reloading on changes of the file
+    QString                                     m_fileName;
+    QFileSystemWatcher*                         m_fileWatcher;
+    QTimer*                                     m_reloadTimer;      // waits for the writer to finish
+    std::vector<unsigned int>                   m_topObjects;
+    std::map<unsigned int, size_t>              m_objectSignatures; // per object below the top objects
+
+    // a plot's tree item by the object IDs of its path, and the plot by the name IDs of the path it draws
+    typedef std::pair<std::vector<unsigned int>, std::vector<unsigned int> > PlotKey;
+
+    // memory accounting: the plots are released when the budget is exceeded
+    MemoryUsage                                 m_memoryUsage;
+    QTreeWidget*                                m_memoryView;
+    QSpinBox*                                   m_budgetEdit;       // in MiB
+    size_t                                      m_treeBytes;        // updated when the tree changes
 
-    void LoadDatabase(const char* fileName);
-    void FillObjectsTree(void);
+    void   LoadDatabase(const char* fileName);
+    void   WatchFile(const QString& fileName);
+    void   ReadSignatures(void);
+    void   FillObjectsTree(void);
+    void   PatchObjectsTree(const std::set<unsigned int>& changedObjects);
+    size_t UpdateSelectedGeometries(const std::map<PlotKey, const Geometry*>& pathGeometries,
+                                    const std::set<unsigned int>&             changedObjects); // returns the number of new plots
+    void   FitViews(void);
+    void   Highlight(QTreeWidgetItem* item);
+    void   BuildNameIndex(std::shared_ptr<NameIndex> nameIndex);
+    void   RebuildNameIndex(void);
+    void   UpdateMemoryUsage(void);
+    void   UpdateTreeBytes(void);
+    void   EnforceMemoryBudget(void);
+    void   ReplaceGeometries(const std::vector<GeometryModel::Replacement>& replacements); // in the model and everything keyed by them
 
 private slots:
     void OpenDatabase(void);
+    void OpenPlot(void);
+    void RemoveImportedPlots(void);
+    void FileChanged(const QString& fileName);
+    void ReloadDatabase(void);
     void FitToWindow(void);
     void SetToXYPlane(void);
     void SetToXZPlane(void);
     void SetToYZPlane(void);
+    void ShowFourViews(bool on);
+    void ActivateDisplay(DisplayManager* displayManager);
+    void PickObject(DisplayManager* displayManager,
+                    const QPoint&   displayPoint);
+    void ShowFrameStatistics(DisplayManager*        displayManager,
+                             const FrameStatistics& statistics);
+    void RefineDetail(void);
     void SelectObjects(void);
+    void SearchObjects(const QString& pattern);
+    void ShowSearchResult(QListWidgetItem* item);
+    void ChangeMemoryBudget(int megaBytes);
 };
 
 
@@ -0,0 +1,166 @@
+/*                     M E M O R Y U S A G E . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file MemoryUsage.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the memory accounting implementation
+ */
+
+#include "MemoryUsage.h"
+
+
+MemoryUsage::MemoryUsage(void) : m_objectBytes(), m_budget(0) {
+    for (size_t i = 0; i < SubsystemCount; ++i)
+        m_bytes[i] = 0;
+}
+
+
+void MemoryUsage::SetBytes
+(
+    Subsystem subsystem,
+    size_t    bytes
+) {
+    m_bytes[static_cast<size_t>(subsystem)] = bytes;
+}
+
+
+size_t MemoryUsage::Bytes
+(
+    Subsystem subsystem
+) const {
+    return m_bytes[static_cast<size_t>(subsystem)];
+}
+
+
+size_t MemoryUsage::HostBytes(void) const {
+    size_t ret = 0;
+
+    for (size_t i = 0; i < SubsystemCount; ++i) {
+        if (static_cast<Subsystem>(i) != Subsystem::GpuBuffers)
+            ret += m_bytes[i];
+    }
+
+    return ret;
+}
+
+
+void MemoryUsage::SetObjectBytes
+(
+    const std::string& objectName,
+    size_t             bytes
+) {
+    m_objectBytes[objectName] = bytes;
+}
+
+
+void MemoryUsage::ClearObjects(void) {
+    m_objectBytes.clear();
+}
+
+
+const std::map<std::string, size_t>& MemoryUsage::ObjectBytes(void) const {
+    return m_objectBytes;
+}
+
+
+void MemoryUsage::SetBudget
+(
+    size_t bytes
+) {
+    m_budget = bytes;
+}
+
+
+size_t MemoryUsage::Budget(void) const {
+    return m_budget;
+}
+
+
+bool MemoryUsage::OverBudget(void) const {
+    return (m_budget > 0) && (HostBytes() > m_budget);
+}
+
+
+QJsonObject MemoryUsage::ToJson(void) const {
+    QJsonObject subsystems;
+    QJsonObject objects;
+    QJsonObject ret;
+
+    for (size_t i = 0; i < SubsystemCount; ++i)
+        subsystems[SubsystemName(static_cast<Subsystem>(i))] = static_cast<double>(m_bytes[i]);
+
+    for (std::map<std::string, size_t>::const_iterator it = m_objectBytes.begin(); it != m_objectBytes.end(); ++it)
+        objects[QString::fromStdString(it->first)] = static_cast<double>(it->second);
+
+    ret["subsystems"] = subsystems;
+    ret["objects"]    = objects;
+    ret["hostBytes"]  = static_cast<double>(HostBytes());
+    ret["budget"]     = static_cast<double>(m_budget);
+
+    return ret;
+}
+
+
+QString MemoryUsage::SubsystemName
+(
+    Subsystem subsystem
+) {
+    QString ret;
+
+    switch (subsystem) {
+        case Subsystem::Database:
+            ret = "database";
+            break;
+
+        case Subsystem::Plots:
+            ret = "plots";
+            break;
+
+        case Subsystem::ObjectsTree:
+            ret = "objectsTree";
+            break;
+
+        case Subsystem::SearchIndex:
+            ret = "searchIndex";
+            break;
+
+        case Subsystem::PickIndex:
+            ret = "pickIndex";
+            break;
+
+        case Subsystem::GpuBuffers:
+            ret = "gpuBuffers";
+    }
+
+    return ret;
+}
+
+
+QString MemoryUsage::FormatBytes
+(
+    size_t bytes
+) {
+    QString ret;
+
+    if (bytes >= 1024 * 1024 * 1024)
+        ret = QString("%1 GiB").arg(bytes / (1024. * 1024. * 1024.), 0, 'f', 2);
+    else if (bytes >= 1024 * 1024)
+        ret = QString("%1 MiB").arg(bytes / (1024. * 1024.), 0, 'f', 1);
+    else if (bytes >= 1024)
+        ret = QString("%1 kiB").arg(bytes / 1024., 0, 'f', 1);
+    else
+        ret = QString("%1 B").arg(bytes);
+
+    return ret;
+}
@@ -0,0 +1,78 @@
+/*                       M E M O R Y U S A G E . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file MemoryUsage.h
+ *
+ *  BRL-CAD GUI:
+ *      the memory accounting declaration
+ *
+ *  Collects the bytes held by the subsystems and by the loaded objects.  The
+ *  numbers are estimates: the owners report the sizes of their containers,
+ *  the database counts with the size of its file.  The budget applies to the
+ *  main memory, the buffers on the graphics card are reported only.
+ */
+
+#ifndef MEMORYUSAGE_INCLUDED
+#define MEMORYUSAGE_INCLUDED
+
+#include <map>
+#include <string>
+
+#include <QJsonObject>
+#include <QString>
+
+
+class MemoryUsage {
+public:
+    enum class Subsystem {
+        Database,
+        Plots,
+        ObjectsTree,
+        SearchIndex,
+        PickIndex,
+        GpuBuffers
+    };
+
+    static const size_t SubsystemCount = 6;
+
+    MemoryUsage(void);
+
+    void                                 SetBytes(Subsystem subsystem,
+                                                  size_t    bytes);
+    size_t                               Bytes(Subsystem subsystem) const;
+    size_t                               HostBytes(void) const; // all but the GPU buffers
+
+    // the plots of the loaded objects
+    void                                 SetObjectBytes(const std::string& objectName,
+                                                        size_t             bytes);
+    void                                 ClearObjects(void);
+    const std::map<std::string, size_t>& ObjectBytes(void) const;
+
+    // 0 for no budget
+    void                                 SetBudget(size_t bytes);
+    size_t                               Budget(void) const;
+    bool                                 OverBudget(void) const;
+
+    QJsonObject                          ToJson(void) const;
+
+    static QString                       SubsystemName(Subsystem subsystem);
+    static QString                       FormatBytes(size_t bytes);
+
+private:
+    size_t                        m_bytes[SubsystemCount];
+    std::map<std::string, size_t> m_objectBytes;
+    size_t                        m_budget;
+};
+
+
+#endif // MEMORYUSAGE_INCLUDED
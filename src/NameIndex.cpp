@@ -0,0 +1,229 @@
+/*                       N A M E I N D E X . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file NameIndex.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a search index over the names in the object tree implementation
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+#include "NameIndex.h"
+
+
+static std::string LowerCase
+(
+    const std::string& text
+) {
+    std::string ret(text);
+
+    for (std::string::iterator it = ret.begin(); it != ret.end(); ++it)
+        *it = static_cast<char>(tolower(static_cast<unsigned char>(*it)));
+
+    return ret;
+}
+
+
+static unsigned int Trigram
+(
+    const std::string& text,
+    size_t             position
+) {
+    return (static_cast<unsigned int>(static_cast<unsigned char>(text[position])) << 16) |
+           (static_cast<unsigned int>(static_cast<unsigned char>(text[position + 1])) << 8) |
+           static_cast<unsigned int>(static_cast<unsigned char>(text[position + 2]));
+}
+
+
+NameIndex::NameIndex(void) : m_nameIds(), m_parents(), m_names(), m_keys(), m_keyEntries(), m_trigramKeys() {}
+
+
+size_t NameIndex::Add
+(
+    unsigned int       nameId,
+    const std::string& name,
+    size_t             parent
+) {
+    if (nameId >= m_names.size())
+        m_names.resize(nameId + 1);
+
+    if (m_names[nameId].empty())
+        m_names[nameId] = name;
+
+    m_nameIds.push_back(nameId);
+    m_parents.push_back(parent);
+
+    return m_nameIds.size() - 1;
+}
+
+
+size_t NameIndex::Size(void) const {
+    return m_nameIds.size();
+}
+
+
+void NameIndex::Build(void) {
+    // the same object appears at many places in the tree, but its name has to be indexed only once
+    std::vector<std::vector<size_t> >                  nameEntries(m_names.size());
+    std::vector<std::pair<std::string, unsigned int> > sortedNames;
+
+    for (size_t i = 0; i < m_nameIds.size(); ++i)
+        nameEntries[m_nameIds[i]].push_back(i);
+
+    for (size_t nameId = 0; nameId < nameEntries.size(); ++nameId) {
+        if (!nameEntries[nameId].empty())
+            sortedNames.push_back(std::make_pair(LowerCase(m_names[nameId]), static_cast<unsigned int>(nameId)));
+    }
+
+    std::sort(sortedNames.begin(), sortedNames.end());
+
+    m_keys.clear();
+    m_keyEntries.clear();
+    m_trigramKeys.clear();
+
+    // names differing in their case only share their key
+    for (std::vector<std::pair<std::string, unsigned int> >::const_iterator it = sortedNames.begin(); it != sortedNames.end(); ++it) {
+        if (m_keys.empty() || (m_keys.back() != it->first)) {
+            m_keys.push_back(it->first);
+            m_keyEntries.push_back(std::vector<size_t>());
+        }
+
+        m_keyEntries.back().insert(m_keyEntries.back().end(), nameEntries[it->second].begin(), nameEntries[it->second].end());
+    }
+
+    for (size_t key = 0; key < m_keys.size(); ++key) {
+        const std::string& name = m_keys[key];
+
+        for (size_t i = 0; i + 2 < name.size(); ++i) {
+            std::vector<unsigned int>& keys = m_trigramKeys[Trigram(name, i)];
+
+            // a trigram may occur more than once in a name
+            if (keys.empty() || (keys.back() != key))
+                keys.push_back(static_cast<unsigned int>(key));
+        }
+    }
+}
+
+
+std::vector<size_t> NameIndex::Find
+(
+    const std::string& pattern,
+    size_t             maxResults
+) const {
+    std::string         lowerPattern = LowerCase(pattern);
+    std::vector<size_t> keys;
+
+    if (lowerPattern.empty())
+        return std::vector<size_t>();
+    else if (lowerPattern.size() < 3) {
+        std::vector<std::string>::const_iterator it = std::lower_bound(m_keys.begin(), m_keys.end(), lowerPattern);
+
+        while ((it != m_keys.end()) && (it->compare(0, lowerPattern.size(), lowerPattern) == 0)) {
+            keys.push_back(it - m_keys.begin());
+            ++it;
+        }
+    }
+    else {
+        // the candidates contain all trigrams of the pattern, the shortest list of keys first
+        std::vector<const std::vector<unsigned int>*> lists;
+
+        for (size_t i = 0; i + 2 < lowerPattern.size(); ++i) {
+            std::unordered_map<unsigned int, std::vector<unsigned int> >::const_iterator list = m_trigramKeys.find(Trigram(lowerPattern, i));
+
+            if (list == m_trigramKeys.end())
+                return std::vector<size_t>();
+
+            lists.push_back(&list->second);
+        }
+
+        std::sort(lists.begin(), lists.end(), [](const std::vector<unsigned int>* a, const std::vector<unsigned int>* b) {
+            return a->size() < b->size();
+        });
+
+        std::vector<unsigned int> candidates(*lists.front());
+
+        for (size_t i = 1; (i < lists.size()) && !candidates.empty(); ++i) {
+            std::vector<unsigned int> intersection;
+
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+
+        // the trigrams may be in a different order
+        for (std::vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+            if (m_keys[*it].find(lowerPattern) != std::string::npos)
+                keys.push_back(*it);
+        }
+    }
+
+    std::vector<size_t> ret;
+
+    for (std::vector<size_t>::const_iterator key = keys.begin(); key != keys.end(); ++key)
+        ret.insert(ret.end(), m_keyEntries[*key].begin(), m_keyEntries[*key].end());
+
+    std::sort(ret.begin(), ret.end());
+
+    if (ret.size() > maxResults)
+        ret.resize(maxResults);
+
+    return ret;
+}
+
+
+const std::string& NameIndex::Name
+(
+    size_t entry
+) const {
+    return m_names[m_nameIds[entry]];
+}
+
+
+size_t NameIndex::Parent
+(
+    size_t entry
+) const {
+    return m_parents[entry];
+}
+
+
+std::string NameIndex::Path
+(
+    size_t entry
+) const {
+    std::string ret = Name(entry);
+
+    for (size_t parent = m_parents[entry]; parent != NoParent; parent = m_parents[parent])
+        ret = Name(parent) + "/" + ret;
+
+    return ret;
+}
+
+
+size_t NameIndex::Bytes(void) const {
+    size_t ret = m_nameIds.capacity() * sizeof(unsigned int) + m_parents.capacity() * sizeof(size_t) + m_names.capacity() * sizeof(std::string)
+                 + m_keys.capacity() * sizeof(std::string) + m_keyEntries.capacity() * sizeof(std::vector<size_t>);
+
+    for (size_t i = 0; i < m_names.size(); ++i)
+        ret += m_names[i].capacity();
+
+    for (size_t i = 0; i < m_keys.size(); ++i)
+        ret += m_keys[i].capacity() + m_keyEntries[i].capacity() * sizeof(size_t);
+
+    for (std::unordered_map<unsigned int, std::vector<unsigned int> >::const_iterator it = m_trigramKeys.begin(); it != m_trigramKeys.end(); ++it)
+        ret += sizeof(*it) + it->second.capacity() * sizeof(unsigned int);
+
+    return ret;
+}
@@ -0,0 +1,71 @@
+/*                         N A M E I N D E X . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file NameIndex.h
+ *
+ *  BRL-CAD GUI:
+ *      a search index over the names in the object tree declaration
+ *
+ *  The entries are the nodes of the object tree, every one with the ID of its
+ *  name in the NameTable and the entry of its parent.  The index keeps one
+ *  copy of every distinct name, not one per node.  The names are collected
+ *  with Add() and indexed by Build(), which may run on a worker thread.  Searches are case
+ *  insensitive: a pattern shorter than three characters matches the names
+ *  starting with it, a longer one all names containing it.
+ */
+
+#ifndef NAMEINDEX_INCLUDED
+#define NAMEINDEX_INCLUDED
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class NameIndex {
+public:
+    static const size_t NoParent = static_cast<size_t>(-1);
+
+    NameIndex(void);
+
+    // collecting the entries, returns the new entry
+    size_t              Add(unsigned int       nameId,
+                            const std::string& name,
+                            size_t             parent = NoParent);
+    size_t              Size(void) const;
+
+    void                Build(void);
+
+    // the matching entries in the order of their addition, at most maxResults of them
+    std::vector<size_t> Find(const std::string& pattern,
+                             size_t             maxResults) const;
+
+    const std::string&  Name(size_t entry) const;
+    size_t              Parent(size_t entry) const;
+    std::string         Path(size_t entry) const; // the names from the top object, separated by '/'
+
+    size_t              Bytes(void) const;        // the estimated memory usage
+
+private:
+    std::vector<unsigned int>                                    m_nameIds;     // per entry
+    std::vector<size_t>                                          m_parents;     // per entry
+    std::vector<std::string>                                     m_names;       // per name ID, empty if no entry has it
+
+    // the distinct names
+    std::vector<std::string>                                     m_keys;        // lower case, sorted
+    std::vector<std::vector<size_t> >                            m_keyEntries;  // the entries per key
+    std::unordered_map<unsigned int, std::vector<unsigned int> > m_trigramKeys; // the keys containing a trigram
+};
+
+
+#endif // NAMEINDEX_INCLUDED
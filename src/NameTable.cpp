@@ -0,0 +1,71 @@
+/*                       N A M E T A B L E . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file NameTable.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the interned object names implementation
+ */
+
+#include "NameTable.h"
+
+
+NameTable::NameTable(void) : m_ids(), m_names() {}
+
+
+unsigned int NameTable::Id
+(
+    const std::string& name
+) {
+    std::unordered_map<std::string, unsigned int>::const_iterator it = m_ids.find(name);
+
+    if (it == m_ids.end()) {
+        it = m_ids.insert(std::make_pair(name, static_cast<unsigned int>(m_names.size()))).first;
+        m_names.push_back(name);
+    }
+
+    return it->second;
+}
+
+
+unsigned int NameTable::Find
+(
+    const std::string& name
+) const {
+    unsigned int                                                  ret = NoId;
+    std::unordered_map<std::string, unsigned int>::const_iterator it  = m_ids.find(name);
+
+    if (it != m_ids.end())
+        ret = it->second;
+
+    return ret;
+}
+
+
+const std::string& NameTable::Name
+(
+    unsigned int id
+) const {
+    return m_names[id];
+}
+
+
+size_t NameTable::Size(void) const {
+    return m_names.size();
+}
+
+
+void NameTable::Clear(void) {
+    m_ids.clear();
+    m_names.clear();
+}
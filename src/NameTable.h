@@ -0,0 +1,53 @@
+/*                         N A M E T A B L E . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file NameTable.h
+ *
+ *  BRL-CAD GUI:
+ *      the interned object names declaration
+ *
+ *  Every object name gets a dense integer ID, which stays valid until
+ *  Clear().  The IDs are used inside the GUI, the names are needed for the
+ *  calls into the database only.  The reference Name() returns stays valid
+ *  until Clear() too, new names don't move the old ones.  Id() must not be
+ *  called concurrently, not even with the const functions.
+ */
+
+#ifndef NAMETABLE_INCLUDED
+#define NAMETABLE_INCLUDED
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+
+class NameTable {
+public:
+    static const unsigned int NoId = static_cast<unsigned int>(-1);
+
+    NameTable(void);
+
+    unsigned int       Id(const std::string& name);         // adds the name if it's new
+    unsigned int       Find(const std::string& name) const; // NoId if it's unknown
+    const std::string& Name(unsigned int id) const;     // valid until Clear()
+    size_t             Size(void) const;
+
+    void               Clear(void);
+
+private:
+    std::unordered_map<std::string, unsigned int> m_ids;
+    std::deque<std::string>                       m_names; // keeps its elements in place when it grows
+};
+
+
+#endif // NAMETABLE_INCLUDED
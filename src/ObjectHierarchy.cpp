@@ -0,0 +1,320 @@
+/*                 O B J E C T H I E R A R C H Y . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file ObjectHierarchy.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the object tree as plain data implementation
+ */
+
+#include <string>
+
+#include <brlcad/Database/Combination.h>
+
+#include "ObjectHierarchy.h"
+#include "Parallel.h"
+
+
+const size_t TasksPerWorker = 4;   // the large subtrees are split until there are enough tasks
+const size_t MinTaskNodes   = 256; // smaller subtrees are not worth a split
+
+// the states of an object during CountNodes()
+const unsigned char Unvisited = 0;
+const unsigned char Counting  = 1;
+const unsigned char Counted   = 2;
+
+// the members closing a cycle before their removal
+const unsigned int CycleMember = static_cast<unsigned int>(-1);
+
+
+static void CollectLeaves
+(
+    const BRLCAD::Combination::ConstTreeNode& tree,
+    std::vector<std::string>&                 leaves
+) {
+    switch (tree.Operation()) {
+        case BRLCAD::Combination::ConstTreeNode::Union:
+        case BRLCAD::Combination::ConstTreeNode::Intersection:
+        case BRLCAD::Combination::ConstTreeNode::Subtraction:
+        case BRLCAD::Combination::ConstTreeNode::ExclusiveOr:
+            CollectLeaves(tree.LeftOperand(), leaves);
+            CollectLeaves(tree.RightOperand(), leaves);
+            break;
+
+        case BRLCAD::Combination::ConstTreeNode::Not:
+            CollectLeaves(tree.Operand(), leaves);
+            break;
+
+        case BRLCAD::Combination::ConstTreeNode::Leaf:
+            leaves.push_back(tree.Name());
+    }
+}
+
+
+ObjectHierarchy::ObjectHierarchy(void)
+    : m_memberStarts(), m_members(), m_subtreeSizes(), m_nodeNames(), m_nodeParents(), m_nodeEnds() {}
+
+
+void ObjectHierarchy::Build
+(
+    const BRLCAD::ConstDatabase& database,
+    NameTable&                   names
+) {
+    m_memberStarts.clear();
+    m_members.clear();
+    m_subtreeSizes.clear();
+    m_nodeNames.clear();
+    m_nodeParents.clear();
+    m_nodeEnds.clear();
+
+    // the database is read on this thread, every object once
+    std::vector<std::vector<unsigned int> > leafIds;  // per name ID
+    std::vector<bool>                       exists;   // per name ID
+    std::vector<bool>                       queued;   // per name ID
+    std::vector<unsigned int>               pending;  // the name IDs to read, in the order of their discovery
+    std::vector<unsigned int>               topIds;
+    std::vector<std::string>                leaves;
+
+    BRLCAD::ConstDatabase::TopObjectIterator topObjectIterator = database.FirstTopObject();
+
+    while (topObjectIterator.Good()) {
+        unsigned int nameId = names.Id(topObjectIterator.Name());
+
+        queued.resize(names.Size(), false);
+
+        if (!queued[nameId]) {
+            queued[nameId] = true;
+            pending.push_back(nameId);
+            topIds.push_back(nameId);
+        }
+
+        ++topObjectIterator;
+    }
+
+    // pending grows while it's read
+    for (size_t i = 0; i < pending.size(); ++i) {
+        unsigned int nameId = pending[i];
+        bool         found  = false;
+
+        leaves.clear();
+
+        database.Get(names.Name(nameId).c_str(), [&found, &leaves](const BRLCAD::Object& object) {
+            const BRLCAD::Combination* combination = dynamic_cast<const BRLCAD::Combination*>(&object);
+
+            found = true;
+
+            if (combination != 0)
+                CollectLeaves(combination->Tree(), leaves);
+        });
+
+        exists.resize(names.Size(), false);
+        leafIds.resize(names.Size());
+        exists[nameId] = found;
+
+        for (std::vector<std::string>::const_iterator it = leaves.begin(); it != leaves.end(); ++it) {
+            unsigned int leafId = names.Id(*it);
+
+            queued.resize(names.Size(), false);
+
+            if (!queued[leafId]) {
+                queued[leafId] = true;
+                pending.push_back(leafId);
+            }
+
+            leafIds[nameId].push_back(leafId);
+        }
+    }
+
+    // the table may know further names, they are no objects here
+    size_t nameCount = names.Size();
+
+    exists.resize(nameCount, false);
+    leafIds.resize(nameCount);
+
+    // the members which are in the database, like the tree widget shows them
+    m_memberStarts.reserve(nameCount + 1);
+
+    for (size_t nameId = 0; nameId < nameCount; ++nameId) {
+        m_memberStarts.push_back(m_members.size());
+
+        for (std::vector<unsigned int>::const_iterator it = leafIds[nameId].begin(); it != leafIds[nameId].end(); ++it) {
+            if (exists[*it])
+                m_members.push_back(*it);
+        }
+    }
+
+    m_memberStarts.push_back(m_members.size());
+
+    // the sizes of the subtrees give the nodes' positions
+    std::vector<unsigned char> states(nameCount, Unvisited);
+    size_t                     nodeCount = 0;
+
+    m_subtreeSizes.resize(nameCount, 0);
+
+    for (std::vector<unsigned int>::const_iterator it = topIds.begin(); it != topIds.end(); ++it) {
+        if (exists[*it]) {
+            CountNodes(*it, states);
+            nodeCount += m_subtreeSizes[*it];
+        }
+    }
+
+    // the cycles out of the members
+    size_t memberCount = 0;
+
+    for (size_t nameId = 0; nameId < nameCount; ++nameId) {
+        size_t start = m_memberStarts[nameId];
+
+        m_memberStarts[nameId] = memberCount;
+
+        for (size_t i = start; i < m_memberStarts[nameId + 1]; ++i) {
+            if (m_members[i] != CycleMember)
+                m_members[memberCount++] = m_members[i];
+        }
+    }
+
+    m_memberStarts.back() = memberCount;
+    m_members.resize(memberCount);
+
+    m_nodeNames.resize(nodeCount);
+    m_nodeParents.resize(nodeCount);
+    m_nodeEnds.resize(nodeCount);
+
+    // the expansion is partitioned by the top objects, the large subtrees are split further
+    struct Task {
+        unsigned int nameId;
+        size_t       parent;
+        size_t       node;
+    };
+
+    std::vector<Task> tasks;
+    size_t            node = 0;
+
+    for (std::vector<unsigned int>::const_iterator it = topIds.begin(); it != topIds.end(); ++it) {
+        if (exists[*it]) {
+            Task task = {*it, NoParent, node};
+
+            tasks.push_back(task);
+            node += m_subtreeSizes[*it];
+        }
+    }
+
+    while (tasks.size() < TasksPerWorker * WorkerCount()) {
+        size_t largest = tasks.size();
+
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if ((m_subtreeSizes[tasks[i].nameId] >= MinTaskNodes) &&
+                ((largest == tasks.size()) || (m_subtreeSizes[tasks[i].nameId] > m_subtreeSizes[tasks[largest].nameId])))
+                largest = i;
+        }
+
+        if (largest == tasks.size())
+            break;
+
+        // the node itself here, its children become tasks
+        Task split = tasks[largest];
+
+        tasks.erase(tasks.begin() + largest);
+        m_nodeNames[split.node]   = split.nameId;
+        m_nodeParents[split.node] = split.parent;
+        m_nodeEnds[split.node]    = split.node + m_subtreeSizes[split.nameId];
+
+        size_t child = split.node + 1;
+
+        for (size_t i = m_memberStarts[split.nameId]; i < m_memberStarts[split.nameId + 1]; ++i) {
+            Task task = {m_members[i], split.node, child};
+
+            tasks.push_back(task);
+            child += m_subtreeSizes[m_members[i]];
+        }
+    }
+
+    ParallelFor(tasks.size(), [this, &tasks](size_t i) {
+        Expand(tasks[i].nameId, tasks[i].parent, tasks[i].node);
+    });
+}
+
+
+size_t ObjectHierarchy::NodeCount(void) const {
+    return m_nodeNames.size();
+}
+
+
+unsigned int ObjectHierarchy::NodeName
+(
+    size_t node
+) const {
+    return m_nodeNames[node];
+}
+
+
+size_t ObjectHierarchy::NodeParent
+(
+    size_t node
+) const {
+    return m_nodeParents[node];
+}
+
+
+size_t ObjectHierarchy::NodeEnd
+(
+    size_t node
+) const {
+    return m_nodeEnds[node];
+}
+
+
+// a member which leads back to the object would make the tree infinite, it's marked for removal
+void ObjectHierarchy::CountNodes
+(
+    unsigned int                nameId,
+    std::vector<unsigned char>& states
+) {
+    size_t count = 1;
+
+    states[nameId] = Counting;
+
+    for (size_t i = m_memberStarts[nameId]; i < m_memberStarts[nameId + 1]; ++i) {
+        unsigned int member = m_members[i];
+
+        if (states[member] == Counting)
+            m_members[i] = CycleMember;
+        else {
+            if (states[member] == Unvisited)
+                CountNodes(member, states);
+
+            count += m_subtreeSizes[member];
+        }
+    }
+
+    m_subtreeSizes[nameId] = count;
+    states[nameId]         = Counted;
+}
+
+
+void ObjectHierarchy::Expand
+(
+    unsigned int nameId,
+    size_t       parent,
+    size_t       node
+) {
+    m_nodeNames[node]   = nameId;
+    m_nodeParents[node] = parent;
+    m_nodeEnds[node]    = node + m_subtreeSizes[nameId];
+
+    size_t child = node + 1;
+
+    for (size_t i = m_memberStarts[nameId]; i < m_memberStarts[nameId + 1]; ++i) {
+        Expand(m_members[i], node, child);
+        child += m_subtreeSizes[m_members[i]];
+    }
+}
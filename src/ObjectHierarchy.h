@@ -0,0 +1,69 @@
+/*                   O B J E C T H I E R A R C H Y . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file ObjectHierarchy.h
+ *
+ *  BRL-CAD GUI:
+ *      the object tree as plain data declaration
+ *
+ *  Build() reads every object below the top objects once and keeps the
+ *  members of the combinations by the IDs of their names in a NameTable.  The tree is expanded
+ *  from them on the worker threads into flat arrays: the nodes are in
+ *  pre-order, every one with its name ID, its parent and the end of its
+ *  subtree.  The children of a node start behind it, every child ends
+ *  where its next sibling starts.
+ */
+
+#ifndef OBJECTHIERARCHY_INCLUDED
+#define OBJECTHIERARCHY_INCLUDED
+
+#include <vector>
+
+#include <brlcad/Database/ConstDatabase.h>
+
+#include "NameTable.h"
+
+
+class ObjectHierarchy {
+public:
+    static const size_t NoParent = static_cast<size_t>(-1);
+
+    ObjectHierarchy(void);
+
+    void         Build(const BRLCAD::ConstDatabase& database,
+                       NameTable&                   names);
+
+    // the nodes, the top objects' subtrees follow each other
+    size_t       NodeCount(void) const;
+    unsigned int NodeName(size_t node) const;   // the name ID
+    size_t       NodeParent(size_t node) const; // NoParent for the top objects
+    size_t       NodeEnd(size_t node) const;
+
+private:
+    std::vector<size_t>       m_memberStarts; // per name ID and one more, the range in m_members
+    std::vector<unsigned int> m_members;
+    std::vector<size_t>       m_subtreeSizes; // per name ID, in nodes
+
+    std::vector<unsigned int> m_nodeNames;
+    std::vector<size_t>       m_nodeParents;
+    std::vector<size_t>       m_nodeEnds;
+
+    void CountNodes(unsigned int               nameId,
+                    std::vector<unsigned char>& states);
+    void Expand(unsigned int nameId,
+                size_t       parent,
+                size_t       node);
+};
+
+
+#endif // OBJECTHIERARCHY_INCLUDED
@@ -0,0 +1,159 @@
+/*                        P A R A L L E L . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file Parallel.cpp
+ *
+ *  BRL-CAD GUI:
+ *      data parallel helpers implementation
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Parallel.h"
+
+
+// set in the threads running tasks, nested loops run serially there
+static thread_local bool insideTask = false;
+
+
+// the worker threads live as long as the program, a loop wakes them up
+class WorkerPool {
+public:
+    WorkerPool(void) : m_workers(), m_runMutex(), m_mutex(), m_wake(), m_done(), m_task(0), m_count(0), m_next(0), m_busy(0), m_generation(0), m_stop(false) {
+        for (size_t i = 1; i < WorkerCount(); ++i)
+            m_workers.push_back(std::thread(&WorkerPool::Work, this));
+    }
+
+    ~WorkerPool(void) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_wake.notify_all();
+
+        for (std::vector<std::thread>::iterator it = m_workers.begin(); it != m_workers.end(); ++it)
+            it->join();
+    }
+
+    static WorkerPool& Instance(void) {
+        static WorkerPool ret;
+
+        return ret;
+    }
+
+    void Run(size_t                             count,
+             const std::function<void(size_t)>& task) {
+        // one loop at a time
+        std::lock_guard<std::mutex> runLock(m_runMutex);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task  = &task;
+            m_count = count;
+            m_next  = 0;
+            m_busy  = m_workers.size();
+            ++m_generation;
+        }
+
+        m_wake.notify_all();
+
+        // the calling thread is a worker too
+        insideTask = true;
+        RunTasks();
+        insideTask = false;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() {
+            return m_busy == 0;
+        });
+
+        m_task = 0;
+    }
+
+private:
+    std::vector<std::thread>           m_workers;
+    std::mutex                         m_runMutex;
+    std::mutex                         m_mutex;
+    std::condition_variable            m_wake;
+    std::condition_variable            m_done;
+    const std::function<void(size_t)>* m_task;
+    size_t                             m_count;
+    std::atomic<size_t>                m_next;
+    size_t                             m_busy;
+    unsigned int                       m_generation;
+    bool                               m_stop;
+
+    void RunTasks(void) {
+        for (size_t i = m_next++; i < m_count; i = m_next++)
+            (*m_task)(i);
+    }
+
+    void Work(void) {
+        unsigned int generation = 0;
+
+        insideTask = true;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this, generation]() {
+                    return m_stop || (m_generation != generation);
+                });
+
+                if (m_stop)
+                    break;
+
+                generation = m_generation;
+            }
+
+            RunTasks();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_busy;
+            }
+
+            m_done.notify_one();
+        }
+    }
+};
+
+
+size_t WorkerCount(void) {
+    size_t ret = std::thread::hardware_concurrency();
+
+    if (ret < 1)
+        ret = 1;
+
+    return ret;
+}
+
+
+void ParallelFor
+(
+    size_t                             count,
+    const std::function<void(size_t)>& task
+) {
+    if ((count <= 1) || (WorkerCount() <= 1) || insideTask) {
+        for (size_t i = 0; i < count; ++i)
+            task(i);
+    }
+    else
+        WorkerPool::Instance().Run(count, task);
+}
@@ -0,0 +1,36 @@
+/*                          P A R A L L E L . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file Parallel.h
+ *
+ *  BRL-CAD GUI:
+ *      data parallel helpers declaration
+ */
+
+#ifndef PARALLEL_INCLUDED
+#define PARALLEL_INCLUDED
+
+#include <functional>
+
+
+// the number of worker threads to use
+size_t WorkerCount(void);
+
+// calls task(i) for every i in [0, count) on the worker threads
+// the items are handed out one by one, i.e. they may differ in their costs
+// the threads are kept for the next call, a ParallelFor() inside a task runs serially
+void   ParallelFor(size_t                             count,
+                   const std::function<void(size_t)>& task);
+
+
+#endif // PARALLEL_INCLUDED
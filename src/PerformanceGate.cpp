@@ -0,0 +1,101 @@
+/*                 P E R F O R M A N C E G A T E . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file PerformanceGate.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the comparison of benchmark times with their baselines implementation
+ */
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QStringList>
+
+#include "PerformanceGate.h"
+
+
+PerformanceGate::PerformanceGate
+(
+    const QJsonObject& baseline,
+    double             tolerance
+) : m_baselineTimes(baseline["times"].toObject()),
+    m_tolerance(tolerance) {}
+
+
+bool PerformanceGate::Check
+(
+    const QJsonObject& report,
+    QTextStream&       out
+) const {
+    QJsonObject times = report["times"].toObject();
+    QStringList steps = m_baselineTimes.keys();
+    bool        ret   = !steps.isEmpty();
+
+    if (!ret)
+        out << "The baseline has no times\n";
+
+    for (QStringList::const_iterator it = steps.begin(); it != steps.end(); ++it) {
+        double limit = m_baselineTimes[*it].toDouble() * (1. + m_tolerance);
+
+        if (!times.contains(*it)) {
+            out << "FAILED " << *it << ": not measured\n";
+            ret = false;
+        }
+        else {
+            double time = times[*it].toDouble();
+
+            if (time > limit) {
+                out << "FAILED " << *it << ": " << time << " ms, the limit is " << limit << " ms ("
+                    << m_baselineTimes[*it].toDouble() << " ms + " << m_tolerance * 100. << " %)\n";
+                ret = false;
+            }
+            else
+                out << "passed " << *it << ": " << time << " ms, the limit is " << limit << " ms\n";
+        }
+    }
+
+    return ret;
+}
+
+
+QJsonObject PerformanceGate::ReadJson
+(
+    const QString& fileName
+) {
+    QJsonObject ret;
+    QFile       file(fileName);
+
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+
+        if (document.isObject())
+            ret = document.object();
+    }
+
+    return ret;
+}
+
+
+bool PerformanceGate::WriteJson
+(
+    const QString&     fileName,
+    const QJsonObject& object
+) {
+    QFile file(fileName);
+    bool  ret = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+    if (ret)
+        ret = (file.write(QJsonDocument(object).toJson()) >= 0);
+
+    return ret;
+}
@@ -0,0 +1,52 @@
+/*                   P E R F O R M A N C E G A T E . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file PerformanceGate.h
+ *
+ *  BRL-CAD GUI:
+ *      the comparison of benchmark times with their baselines declaration
+ *
+ *  A baseline is a JSON file with a "times" object, its entries are the
+ *  maximal milliseconds of the steps in the "times" of a benchmark report.
+ *  A step fails if it takes longer than its baseline plus the tolerance.
+ */
+
+#ifndef PERFORMANCEGATE_INCLUDED
+#define PERFORMANCEGATE_INCLUDED
+
+#include <QJsonObject>
+#include <QString>
+#include <QTextStream>
+
+
+class PerformanceGate {
+public:
+    PerformanceGate(const QJsonObject& baseline,
+                    double             tolerance); // relative, 0.25 allows 25 % more
+
+    // writes a line per step, returns false if a step is too slow or missing
+    bool        Check(const QJsonObject& report,
+                      QTextStream&       out) const;
+
+    // an empty object if the file can't be read
+    static QJsonObject ReadJson(const QString& fileName);
+    static bool        WriteJson(const QString&     fileName,
+                                 const QJsonObject& object);
+
+private:
+    QJsonObject m_baselineTimes;
+    double      m_tolerance;
+};
+
+
+#endif // PERFORMANCEGATE_INCLUDED
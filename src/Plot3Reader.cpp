@@ -0,0 +1,554 @@
+/*                       P L O T 3 R E A D E R . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file Plot3Reader.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a reader of UNIX-plot (plot3) files implementation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <QFile>
+#include <QFileInfo>
+
+#include "Plot3Reader.h"
+
+
+const size_t PieceElements = 65536; // the vectors of a plot, the points of a point cloud
+const int    ArcSegments   = 64;    // per full circle
+const int    TextOperand   = -1;    // up to the end of the line
+const int    NoCommand     = -2;
+const double Pi            = 3.14159265358979323846;
+
+
+// the operand's size of a command
+static int OperandBytes
+(
+    char command
+) {
+    int ret = NoCommand;
+
+    switch (command) {
+        case 'e': // erase
+        case 'F': // flush
+            ret = 0;
+            break;
+
+        case 'C': // colour: red, green, blue
+            ret = 3;
+            break;
+
+        case 'm': // move, continue, point: x, y
+        case 'n':
+        case 'p':
+            ret = 4;
+            break;
+
+        case 'M': // x, y, z
+        case 'N':
+        case 'P':
+        case 'c': // circle: x, y, radius
+            ret = 6;
+            break;
+
+        case 'l': // line, space: x1, y1, x2, y2
+        case 's':
+            ret = 8;
+            break;
+
+        case 'L': // x1, y1, z1, x2, y2, z2
+        case 'S':
+        case 'a': // arc: centre x, y, start x, y, end x, y
+            ret = 12;
+            break;
+
+        case 'o': // the same with doubles
+        case 'q':
+        case 'x':
+            ret = 16;
+            break;
+
+        case 'O':
+        case 'Q':
+        case 'X':
+        case 'i':
+            ret = 24;
+            break;
+
+        case 'v':
+        case 'w':
+            ret = 32;
+            break;
+
+        case 'V':
+        case 'W':
+        case 'r':
+            ret = 48;
+            break;
+
+        case 'f': // line mode
+        case 't': // label
+            ret = TextOperand;
+    }
+
+    return ret;
+}
+
+
+// little endian
+static double ShortAt
+(
+    const uchar* data,
+    size_t       index
+) {
+    const uchar* bytes = data + 2 * index;
+
+    return static_cast<short>(bytes[0] | (bytes[1] << 8));
+}
+
+
+// big endian
+static double DoubleAt
+(
+    const uchar* data,
+    size_t       index
+) {
+    const uchar*       bytes = data + 8 * index;
+    unsigned long long bits  = 0;
+    double             ret;
+
+    for (size_t i = 0; i < 8; ++i)
+        bits = (bits << 8) | bytes[i];
+
+    memcpy(&ret, &bits, sizeof(ret));
+
+    return ret;
+}
+
+
+// collects the commands into the plots, one open plot per colour
+// reading a piece again, only its vectors are collected into one plot
+class Plot3Parser {
+public:
+    Plot3Parser(const std::string& name)
+        : m_name(name), m_color(), m_pieces(), m_current(0), m_pointClouds(), m_geometries(), m_point(0., 0., 0.), m_lineOpen(false),
+          m_plotPieces(0), m_commandByte(0), m_commandVectors(0), m_commandStart(0., 0., 0.), m_piece(0), m_pieceKey(-1), m_skipped(0), m_done(false) {}
+
+    // notes the pieces of the plots
+    void RecordPieces(Plot3Reader::PlotPieces& plotPieces) {
+        m_plotPieces = &plotPieces;
+    }
+
+    // starts at the piece's command
+    void ReadPiece(const Plot3Reader::PlotPiece& piece) {
+        SetColor(piece.color);
+        m_point    = piece.start;
+        m_piece    = &piece;
+        m_pieceKey = ColorKey();
+        m_skipped  = piece.skipped;
+    }
+
+    void BeginCommand(qint64 byte) {
+        m_commandByte    = byte;
+        m_commandVectors = 0;
+        m_commandStart   = m_point;
+    }
+
+    // the piece has all its vectors
+    bool Done(void) const {
+        return m_done;
+    }
+
+    void SetColor(const QColor& color) {
+        m_color    = color;
+        m_current  = 0;
+        m_lineOpen = false;
+    }
+
+    void Move(const BRLCAD::Vector3D& point) {
+        m_point    = point;
+        m_lineOpen = false;
+    }
+
+    void Continue(const BRLCAD::Vector3D& point) {
+        BRLCAD::VectorList* vectorList = Target();
+
+        if (vectorList != 0) {
+            if (!m_lineOpen)
+                vectorList->Append(BRLCAD::VectorList::LineMove(m_point));
+
+            vectorList->Append(BRLCAD::VectorList::LineDraw(point));
+            m_lineOpen = true;
+        }
+
+        m_point = point;
+    }
+
+    void Point(const BRLCAD::Vector3D& point) {
+        if (m_piece != 0) {
+            Move(point);
+            return;
+        }
+
+        PointCloudGeometry*& pointCloud = m_pointClouds[ColorKey()];
+
+        // the octrees of the pieces are built in parallel
+        if ((pointCloud == 0) || (pointCloud->Size() >= PieceElements)) {
+            pointCloud = new PointCloudGeometry();
+            pointCloud->SetColor(m_color);
+            m_geometries.push_back(pointCloud);
+        }
+
+        pointCloud->Append(QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2])));
+        Move(point);
+    }
+
+    // counterclockwise from start to end, a full circle if they are the same
+    void Arc(const BRLCAD::Vector3D& centre,
+             const BRLCAD::Vector3D& start,
+             const BRLCAD::Vector3D& end) {
+        double x          = start.coordinates[0] - centre.coordinates[0];
+        double y          = start.coordinates[1] - centre.coordinates[1];
+        double radius     = sqrt(x * x + y * y);
+        double startAngle = atan2(y, x);
+        double endAngle   = atan2(end.coordinates[1] - centre.coordinates[1], end.coordinates[0] - centre.coordinates[0]);
+
+        if (endAngle <= startAngle)
+            endAngle += 2. * Pi;
+
+        int segments = std::max(1, static_cast<int>(ceil(ArcSegments * (endAngle - startAngle) / (2. * Pi))));
+
+        Move(start);
+
+        for (int i = 1; i <= segments; ++i) {
+            double angle = startAngle + (endAngle - startAngle) * i / segments;
+
+            Continue(BRLCAD::Vector3D(centre.coordinates[0] + radius * cos(angle), centre.coordinates[1] + radius * sin(angle), centre.coordinates[2]));
+        }
+    }
+
+    const std::vector<Geometry*>& Geometries(void) const {
+        return m_geometries;
+    }
+
+private:
+    struct Piece {
+        PlotGeometry*           plot;
+        size_t                  elements;
+        Plot3Reader::PlotPiece* plotPiece; // 0 if they aren't recorded
+    };
+
+    std::string                           m_name;
+    QColor                                m_color;
+    std::map<qint64, Piece>               m_pieces;         // the open plot per colour
+    Piece*                                m_current;
+    std::map<qint64, PointCloudGeometry*> m_pointClouds;    // the open point cloud per colour
+    std::vector<Geometry*>                m_geometries;
+    BRLCAD::Vector3D                      m_point;          // the current position
+    bool                                  m_lineOpen;
+
+    Plot3Reader::PlotPieces*              m_plotPieces;
+    qint64                                m_commandByte;
+    size_t                                m_commandVectors; // of the current command
+    BRLCAD::Vector3D                      m_commandStart;   // the position before the current command
+
+    const Plot3Reader::PlotPiece*         m_piece;          // the one to read again
+    qint64                                m_pieceKey;       // its colour
+    size_t                                m_skipped;        // the vectors of its first command still to skip
+    bool                                  m_done;
+
+    // -1 for the display manager's colour
+    qint64 ColorKey(void) const {
+        return m_color.isValid() ? static_cast<qint64>(m_color.rgb()) : -1;
+    }
+
+    // the current colour's plot, a new one if it's full, 0 if the vector isn't in the piece to read again
+    BRLCAD::VectorList* Target(void) {
+        ++m_commandVectors;
+
+        if (m_piece != 0) {
+            if (m_done || (ColorKey() != m_pieceKey))
+                return 0;
+
+            if (m_skipped > 0) {
+                --m_skipped;
+                return 0;
+            }
+        }
+
+        if (m_current == 0)
+            m_current = &m_pieces[ColorKey()];
+
+        if ((m_current->plot == 0) || (m_current->elements >= PieceElements)) {
+            m_current->plot      = new PlotGeometry();
+            m_current->elements  = 0;
+            m_current->plotPiece = 0;
+            m_current->plot->SetName(m_name);
+            m_current->plot->SetColor(m_color);
+            m_geometries.push_back(m_current->plot);
+            m_lineOpen = false;
+
+            if (m_plotPieces != 0) {
+                Plot3Reader::PlotPiece plotPiece = {QString(), QDateTime(), m_commandByte, m_commandVectors - 1, 0, m_color, m_commandStart};
+
+                m_current->plotPiece = &((*m_plotPieces)[m_current->plot] = plotPiece);
+            }
+        }
+
+        ++m_current->elements;
+
+        if (m_current->plotPiece != 0)
+            ++m_current->plotPiece->vectors;
+
+        if ((m_piece != 0) && (m_current->elements >= m_piece->vectors))
+            m_done = true;
+
+        return &m_current->plot->VectorList();
+    }
+};
+
+
+// parses the commands of the file from the byte first on, returns the error
+static QString ParseFile
+(
+    const QString& fileName,
+    qint64         first,
+    Plot3Parser&   parser
+) {
+    QFile   file(fileName);
+    uchar*  data = 0;
+    QString error;
+
+    if (!file.open(QIODevice::ReadOnly))
+        error = file.errorString();
+    else if (file.size() > 0) {
+        data = file.map(0, file.size());
+
+        if (data == 0)
+            error = file.errorString();
+    }
+
+    if (data != 0) {
+        const uchar* end = data + file.size();
+        const uchar* it  = data + std::min(first, file.size());
+
+        while ((it < end) && error.isEmpty() && !parser.Done()) {
+            char command      = static_cast<char>(*it);
+            int  operandBytes = OperandBytes(command);
+
+            parser.BeginCommand(static_cast<qint64>(it - data));
+
+            if (operandBytes == NoCommand)
+                error = QString("unknown command 0x%1 at byte %2").arg(static_cast<uint>(*it), 2, 16, QChar('0')).arg(static_cast<qint64>(it - data));
+            else if (operandBytes == TextOperand) {
+                const uchar* endOfLine = static_cast<const uchar*>(memchr(it + 1, '\n', end - it - 1));
+
+                if (endOfLine == 0)
+                    error = QString("unterminated text at byte %1").arg(static_cast<qint64>(it - data));
+                else
+                    it = endOfLine + 1;
+            }
+            else if (end - it - 1 < operandBytes)
+                error = QString("truncated command at byte %1").arg(static_cast<qint64>(it - data));
+            else {
+                const uchar* operand = it + 1;
+
+                switch (command) {
+                    case 'C':
+                        parser.SetColor(QColor(operand[0], operand[1], operand[2]));
+                        break;
+
+                    case 'm':
+                        parser.Move(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), 0.));
+                        break;
+
+                    case 'n':
+                        parser.Continue(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), 0.));
+                        break;
+
+                    case 'p':
+                        parser.Point(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), 0.));
+                        break;
+
+                    case 'l':
+                        parser.Move(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), 0.));
+                        parser.Continue(BRLCAD::Vector3D(ShortAt(operand, 2), ShortAt(operand, 3), 0.));
+                        break;
+
+                    case 'M':
+                        parser.Move(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), ShortAt(operand, 2)));
+                        break;
+
+                    case 'N':
+                        parser.Continue(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), ShortAt(operand, 2)));
+                        break;
+
+                    case 'P':
+                        parser.Point(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), ShortAt(operand, 2)));
+                        break;
+
+                    case 'L':
+                        parser.Move(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), ShortAt(operand, 2)));
+                        parser.Continue(BRLCAD::Vector3D(ShortAt(operand, 3), ShortAt(operand, 4), ShortAt(operand, 5)));
+                        break;
+
+                    case 'c': {
+                            BRLCAD::Vector3D centre(ShortAt(operand, 0), ShortAt(operand, 1), 0.);
+                            BRLCAD::Vector3D start(ShortAt(operand, 0) + ShortAt(operand, 2), ShortAt(operand, 1), 0.);
+
+                            parser.Arc(centre, start, start);
+                        }
+
+                        break;
+
+                    case 'a':
+                        parser.Arc(BRLCAD::Vector3D(ShortAt(operand, 0), ShortAt(operand, 1), 0.),
+                                   BRLCAD::Vector3D(ShortAt(operand, 2), ShortAt(operand, 3), 0.),
+                                   BRLCAD::Vector3D(ShortAt(operand, 4), ShortAt(operand, 5), 0.));
+                        break;
+
+                    case 'o':
+                        parser.Move(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), 0.));
+                        break;
+
+                    case 'q':
+                        parser.Continue(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), 0.));
+                        break;
+
+                    case 'x':
+                        parser.Point(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), 0.));
+                        break;
+
+                    case 'v':
+                        parser.Move(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), 0.));
+                        parser.Continue(BRLCAD::Vector3D(DoubleAt(operand, 2), DoubleAt(operand, 3), 0.));
+                        break;
+
+                    case 'O':
+                        parser.Move(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), DoubleAt(operand, 2)));
+                        break;
+
+                    case 'Q':
+                        parser.Continue(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), DoubleAt(operand, 2)));
+                        break;
+
+                    case 'X':
+                        parser.Point(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), DoubleAt(operand, 2)));
+                        break;
+
+                    case 'V':
+                        parser.Move(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), DoubleAt(operand, 2)));
+                        parser.Continue(BRLCAD::Vector3D(DoubleAt(operand, 3), DoubleAt(operand, 4), DoubleAt(operand, 5)));
+                        break;
+
+                    case 'i': {
+                            BRLCAD::Vector3D centre(DoubleAt(operand, 0), DoubleAt(operand, 1), 0.);
+                            BRLCAD::Vector3D start(DoubleAt(operand, 0) + DoubleAt(operand, 2), DoubleAt(operand, 1), 0.);
+
+                            parser.Arc(centre, start, start);
+                        }
+
+                        break;
+
+                    case 'r':
+                        parser.Arc(BRLCAD::Vector3D(DoubleAt(operand, 0), DoubleAt(operand, 1), 0.),
+                                   BRLCAD::Vector3D(DoubleAt(operand, 2), DoubleAt(operand, 3), 0.),
+                                   BRLCAD::Vector3D(DoubleAt(operand, 4), DoubleAt(operand, 5), 0.));
+                        break;
+
+                    default: // the space, erase and flush commands don't draw
+                        break;
+                }
+
+                it = operand + operandBytes;
+            }
+        }
+
+        file.unmap(data);
+    }
+
+    return error;
+}
+
+
+std::vector<Geometry*> Plot3Reader::Read
+(
+    const QString& fileName,
+    QString&       error
+) {
+    PlotPieces pieces;
+
+    return Read(fileName, error, pieces);
+}
+
+
+std::vector<Geometry*> Plot3Reader::Read
+(
+    const QString& fileName,
+    QString&       error,
+    PlotPieces&    pieces
+) {
+    QFileInfo   fileInfo(fileName);
+    Plot3Parser parser(fileInfo.fileName().toStdString());
+    PlotPieces  newPieces;
+
+    parser.RecordPieces(newPieces);
+    error = ParseFile(fileName, 0, parser);
+
+    for (PlotPieces::iterator it = newPieces.begin(); it != newPieces.end(); ++it) {
+        it->second.fileName     = fileInfo.absoluteFilePath();
+        it->second.lastModified = fileInfo.lastModified();
+    }
+
+    pieces.insert(newPieces.begin(), newPieces.end());
+
+    return parser.Geometries();
+}
+
+
+PlotGeometry* Plot3Reader::ReadPiece
+(
+    const PlotPiece& piece,
+    QString&         error
+) {
+    QFileInfo     fileInfo(piece.fileName);
+    Plot3Parser   parser(fileInfo.fileName().toStdString());
+    PlotGeometry* ret = 0;
+
+    error.clear();
+
+    if (!fileInfo.exists() || (fileInfo.lastModified() != piece.lastModified))
+        error = "the file has changed";
+    else {
+        parser.ReadPiece(piece);
+        error = ParseFile(piece.fileName, piece.first, parser);
+
+        if (error.isEmpty() && !parser.Done())
+            error = "the file has changed";
+    }
+
+    // the piece's plot is the only geometry
+    if (!parser.Geometries().empty()) {
+        if (error.isEmpty())
+            ret = static_cast<PlotGeometry*>(parser.Geometries().front());
+        else
+            delete parser.Geometries().front();
+    }
+
+    return ret;
+}
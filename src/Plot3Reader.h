@@ -0,0 +1,84 @@
+/*                         P L O T 3 R E A D E R . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file Plot3Reader.h
+ *
+ *  BRL-CAD GUI:
+ *      a reader of UNIX-plot (plot3) files declaration
+ *
+ *  The file is mapped into memory and its commands go in one pass into the
+ *  vector lists of plot geometries, it isn't read into a buffer first.  The
+ *  vector lists are a full copy of the file's geometry however, with every
+ *  coordinate as a double: a file of integer commands takes several times
+ *  its size in memory until the plots are released.  The reader notes where
+ *  in the file every plot's vectors are, a released plot is read again from
+ *  there.
+ *  The plots are sorted by their colours, and a plot ends after a fixed
+ *  number of vectors: a large file gives many plots of a moderate size, their
+ *  simplified levels are built in parallel.
+ *
+ *  The points go into point clouds, sorted by their colours and split into
+ *  pieces the same way.
+ *
+ *  The 2D and 3D commands with integer and floating point coordinates are
+ *  read, the 2D ones in the x-y plane.  The integers are little endian, the
+ *  doubles big endian, as written by libplot3.  Arcs and circles become
+ *  polylines, the space, erase, flush, line mode and label commands are
+ *  skipped.
+ */
+
+#ifndef PLOT3READER_INCLUDED
+#define PLOT3READER_INCLUDED
+
+#include <map>
+#include <vector>
+
+#include <QColor>
+#include <QDateTime>
+#include <QString>
+
+#include "PlotGeometry.h"
+#include "PointCloudGeometry.h"
+
+
+class Plot3Reader {
+public:
+    // where the vectors of a plot are in its file
+    struct PlotPiece {
+        QString          fileName;
+        QDateTime        lastModified; // the file has to be unchanged to be read again
+        qint64           first;        // the byte of the command with the plot's first vector
+        size_t           skipped;      // the vectors of this command which went into the plot before
+        size_t           vectors;
+        QColor           color;
+        BRLCAD::Vector3D start;        // the position before the command
+    };
+
+    typedef std::map<const Geometry*, PlotPiece> PlotPieces;
+
+    // the plots and point clouds of the file, the caller takes them over
+    // error is empty if the file was read completely, otherwise the geometries hold the commands before the error
+    static std::vector<Geometry*> Read(const QString& fileName,
+                                       QString&       error);
+    // the same, with the pieces of the plots
+    static std::vector<Geometry*> Read(const QString& fileName,
+                                       QString&       error,
+                                       PlotPieces&    pieces);
+
+    // the plot of a piece read again, 0 with an error if the file has changed
+    static PlotGeometry*          ReadPiece(const PlotPiece& piece,
+                                            QString&         error);
+};
+
+
+#endif // PLOT3READER_INCLUDED
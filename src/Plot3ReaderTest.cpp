@@ -0,0 +1,556 @@
+/*                 P L O T 3 R E A D E R T E S T . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file Plot3ReaderTest.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a test of the plot3 file reader
+ *
+ *  Writes small plot3 files and reads them back: every command with the
+ *  operand size of libplot3, the byte orders of the integers and the
+ *  doubles, the vectors of the line, arc and circle commands, the colours,
+ *  the split of the points and vectors into pieces and the pieces read
+ *  again, and the errors of truncated and unknown commands.  Returns 0 if
+ *  all checks passed.
+ */
+
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "Plot3Reader.h"
+
+
+const float MaxFloat = std::numeric_limits<float>::max();
+
+
+// the commands as written by libplot3
+class Plot3File {
+public:
+    Plot3File(void) : m_bytes() {}
+
+    void Command(char command) {
+        m_bytes.push_back(command);
+    }
+
+    void Byte(unsigned char value) {
+        m_bytes.push_back(static_cast<char>(value));
+    }
+
+    // little endian
+    void Short(short value) {
+        m_bytes.push_back(static_cast<char>(value & 0xff));
+        m_bytes.push_back(static_cast<char>((value >> 8) & 0xff));
+    }
+
+    // big endian
+    void Double(double value) {
+        unsigned long long bits = 0;
+
+        memcpy(&bits, &value, sizeof(bits));
+
+        for (int i = 7; i >= 0; --i)
+            m_bytes.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+
+    void Bytes(size_t count) {
+        m_bytes.append(count, '\0');
+    }
+
+    void Text(const std::string& text) {
+        m_bytes.append(text);
+    }
+
+    bool Write(const QString& fileName) const {
+        QFile file(fileName);
+
+        return file.open(QIODevice::WriteOnly) && (file.write(m_bytes.data(), m_bytes.size()) == static_cast<qint64>(m_bytes.size()));
+    }
+
+private:
+    std::string m_bytes;
+};
+
+
+class Checks {
+public:
+    Checks(void) : m_failed(0) {}
+
+    void Check(bool        condition,
+               const char* test,
+               const char* description) {
+        if (!condition) {
+            std::cerr << test << ": " << description << "\n";
+            ++m_failed;
+        }
+    }
+
+    int Failed(void) const {
+        return m_failed;
+    }
+
+private:
+    int m_failed;
+};
+
+
+static std::vector<Geometry*> ReadFile
+(
+    const QTemporaryDir&     directory,
+    const Plot3File&         plot3File,
+    QString&                 error,
+    Plot3Reader::PlotPieces& pieces
+) {
+    QString                fileName = directory.filePath("test.plot3");
+    std::vector<Geometry*> ret;
+
+    if (plot3File.Write(fileName))
+        ret = Plot3Reader::Read(fileName, error, pieces);
+    else
+        error = "can't write " + fileName;
+
+    return ret;
+}
+
+
+static std::vector<Geometry*> ReadFile
+(
+    const QTemporaryDir& directory,
+    const Plot3File&     plot3File,
+    QString&             error
+) {
+    Plot3Reader::PlotPieces pieces;
+
+    return ReadFile(directory, plot3File, error, pieces);
+}
+
+
+static void FreeGeometries
+(
+    std::vector<Geometry*>& geometries
+) {
+    for (std::vector<Geometry*>::iterator it = geometries.begin(); it != geometries.end(); ++it)
+        delete *it;
+
+    geometries.clear();
+}
+
+
+// the points of all point clouds
+static size_t PointCount
+(
+    const std::vector<Geometry*>& geometries,
+    QVector3D&                    minCorner,
+    QVector3D&                    maxCorner
+) {
+    size_t ret = 0;
+
+    minCorner = QVector3D(MaxFloat, MaxFloat, MaxFloat);
+    maxCorner = QVector3D(-MaxFloat, -MaxFloat, -MaxFloat);
+
+    for (std::vector<Geometry*>::const_iterator it = geometries.begin(); it != geometries.end(); ++it) {
+        const PointCloudGeometry* pointCloud = dynamic_cast<const PointCloudGeometry*>(*it);
+
+        if (pointCloud != 0) {
+            ret += pointCloud->Size();
+            pointCloud->MinMax(minCorner, maxCorner);
+        }
+    }
+
+    return ret;
+}
+
+
+// the line moves and draws of a plot with their points
+static std::vector<std::pair<bool, QVector3D> > Vectors
+(
+    const PlotGeometry& plot
+) {
+    std::vector<std::pair<bool, QVector3D> > ret;
+
+    plot.VectorList().Iterate([&ret](const BRLCAD::VectorList::Element* element) {
+        if (element != 0) {
+            bool             draw  = (element->Type() == BRLCAD::VectorList::Element::ElementType::LineDraw);
+            BRLCAD::Vector3D point = draw ? static_cast<const BRLCAD::VectorList::LineDraw*>(element)->Point()
+                                          : static_cast<const BRLCAD::VectorList::LineMove*>(element)->Point();
+
+            ret.push_back(std::make_pair(draw, QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2]))));
+        }
+
+        return true;
+    });
+
+    return ret;
+}
+
+
+// a wrong operand size would make the commands after it unreadable
+static void TestCommandSizes
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    struct CommandSize {
+        char   command;
+        size_t bytes;
+    };
+
+    const CommandSize commandSizes[] = {{'e', 0},  {'F', 0},  {'C', 3},  {'m', 4},  {'n', 4},  {'p', 4},  {'M', 6},
+                                        {'N', 6},  {'P', 6},  {'c', 6},  {'l', 8},  {'s', 8},  {'L', 12}, {'S', 12},
+                                        {'a', 12}, {'o', 16}, {'q', 16}, {'x', 16}, {'O', 24}, {'Q', 24}, {'X', 24},
+                                        {'i', 24}, {'v', 32}, {'w', 32}, {'V', 48}, {'W', 48}, {'r', 48}};
+    Plot3File         plot3File;
+
+    for (size_t i = 0; i < sizeof(commandSizes) / sizeof(commandSizes[0]); ++i) {
+        plot3File.Command(commandSizes[i].command);
+        plot3File.Bytes(commandSizes[i].bytes);
+    }
+
+    plot3File.Command('f');
+    plot3File.Text("solid\n");
+    plot3File.Command('t');
+    plot3File.Text("a label\n");
+
+    // the last command has to be found where it was written
+    plot3File.Command('P');
+    plot3File.Short(1);
+    plot3File.Short(2);
+    plot3File.Short(3);
+
+    QString                error;
+    std::vector<Geometry*> geometries = ReadFile(directory, plot3File, error);
+    QVector3D              minCorner;
+    QVector3D              maxCorner;
+
+    checks.Check(error.isEmpty(), "command sizes", "the file wasn't read completely");
+    checks.Check(PointCount(geometries, minCorner, maxCorner) == 5, "command sizes", "the number of points is wrong");
+    checks.Check(maxCorner == QVector3D(1.f, 2.f, 3.f), "command sizes", "the last point is wrong");
+
+    FreeGeometries(geometries);
+}
+
+
+// the integers are little endian and signed, the doubles big endian
+static void TestByteOrder
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    Plot3File plot3File;
+
+    plot3File.Command('P');
+    plot3File.Short(258);
+    plot3File.Short(-2);
+    plot3File.Short(1);
+    plot3File.Command('X');
+    plot3File.Double(1.5);
+    plot3File.Double(-0.25);
+    plot3File.Double(1000000.);
+
+    QString                error;
+    std::vector<Geometry*> geometries = ReadFile(directory, plot3File, error);
+    QVector3D              minCorner;
+    QVector3D              maxCorner;
+
+    checks.Check(error.isEmpty(), "byte order", "the file wasn't read completely");
+    checks.Check(PointCount(geometries, minCorner, maxCorner) == 2, "byte order", "the number of points is wrong");
+    checks.Check(minCorner == QVector3D(1.5f, -2.f, 1.f), "byte order", "the minimum is wrong");
+    checks.Check(maxCorner == QVector3D(258.f, -0.25f, 1000000.f), "byte order", "the maximum is wrong");
+
+    FreeGeometries(geometries);
+}
+
+
+// a colour's points are split into point clouds of a limited size
+static void TestPointPieces
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    Plot3File plot3File;
+
+    for (short i = 0; i < 30000; ++i) {
+        for (short j = 0; j < 3; ++j) {
+            plot3File.Command('P');
+            plot3File.Short(i);
+            plot3File.Short(j);
+            plot3File.Short(0);
+        }
+    }
+
+    QString                error;
+    std::vector<Geometry*> geometries = ReadFile(directory, plot3File, error);
+    QVector3D              minCorner;
+    QVector3D              maxCorner;
+
+    checks.Check(error.isEmpty(), "point pieces", "the file wasn't read completely");
+    checks.Check(PointCount(geometries, minCorner, maxCorner) == 90000, "point pieces", "the number of points is wrong");
+    checks.Check(geometries.size() == 2, "point pieces", "the points aren't split into two point clouds");
+
+    FreeGeometries(geometries);
+}
+
+
+// a line opens a polyline which a continue extends, arcs and circles are split into segments
+static void TestVectors
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    Plot3File plot3File;
+
+    plot3File.Command('l');
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(10);
+    plot3File.Short(0);
+    plot3File.Command('n');
+    plot3File.Short(10);
+    plot3File.Short(5);
+    plot3File.Command('L');
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(7);
+
+    // a full circle has 64 segments, a quarter arc 16
+    plot3File.Command('c');
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(2);
+    plot3File.Command('a');
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(3);
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(3);
+    plot3File.Command('i');
+    plot3File.Double(0.);
+    plot3File.Double(0.);
+    plot3File.Double(4.);
+    plot3File.Command('r');
+    plot3File.Double(0.);
+    plot3File.Double(0.);
+    plot3File.Double(5.);
+    plot3File.Double(0.);
+    plot3File.Double(0.);
+    plot3File.Double(5.);
+
+    QString                error;
+    std::vector<Geometry*> geometries = ReadFile(directory, plot3File, error);
+    const PlotGeometry*    plot       = (geometries.size() == 1) ? dynamic_cast<const PlotGeometry*>(geometries.front()) : 0;
+
+    checks.Check(error.isEmpty(), "vectors", "the file wasn't read completely");
+    checks.Check(plot != 0, "vectors", "the vectors aren't in one plot");
+
+    if (plot != 0) {
+        std::vector<std::pair<bool, QVector3D> > vectors = Vectors(*plot);
+        size_t                                   moves   = 0;
+        QVector3D                                minCorner(MaxFloat, MaxFloat, MaxFloat);
+        QVector3D                                maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
+
+        for (std::vector<std::pair<bool, QVector3D> >::const_iterator it = vectors.begin(); it != vectors.end(); ++it) {
+            if (!it->first)
+                ++moves;
+        }
+
+        plot->MinMax(minCorner, maxCorner);
+
+        checks.Check(vectors.size() == 2 + 1 + 2 + 65 + 17 + 65 + 17, "vectors", "the number of vectors is wrong");
+        checks.Check(moves == 6, "vectors", "the continue doesn't extend the line");
+        checks.Check((vectors.size() > 2) && (vectors[2] == std::make_pair(true, QVector3D(10.f, 5.f, 0.f))), "vectors", "the continue is wrong");
+        checks.Check(maxCorner == QVector3D(10.f, 5.f, 7.f), "vectors", "the maximum is wrong");
+        checks.Check(minCorner.x() == -4.f, "vectors", "the circle of doubles is wrong");
+    }
+
+    FreeGeometries(geometries);
+}
+
+
+// every colour has plots of its own
+static void TestColors
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    Plot3File plot3File;
+
+    for (int i = 0; i < 3; ++i) {
+        plot3File.Command('C');
+        plot3File.Byte(0);
+        plot3File.Byte((i == 1) ? 255 : 0);
+        plot3File.Byte(0);
+        plot3File.Command('l');
+        plot3File.Short(i);
+        plot3File.Short(0);
+        plot3File.Short(i);
+        plot3File.Short(1);
+    }
+
+    QString                error;
+    std::vector<Geometry*> geometries = ReadFile(directory, plot3File, error);
+    const PlotGeometry*    black      = (geometries.size() == 2) ? dynamic_cast<const PlotGeometry*>(geometries[0]) : 0;
+    const PlotGeometry*    green      = (geometries.size() == 2) ? dynamic_cast<const PlotGeometry*>(geometries[1]) : 0;
+
+    checks.Check(error.isEmpty(), "colours", "the file wasn't read completely");
+    checks.Check((black != 0) && (green != 0), "colours", "there isn't one plot per colour");
+
+    if ((black != 0) && (green != 0)) {
+        checks.Check(black->Color() == QColor(0, 0, 0), "colours", "the first colour is wrong");
+        checks.Check(green->Color() == QColor(0, 255, 0), "colours", "the second colour is wrong");
+        checks.Check(Vectors(*black).size() == 4, "colours", "the lines of the first colour are wrong");
+        checks.Check(Vectors(*green).size() == 2, "colours", "the line of the second colour is wrong");
+    }
+
+    FreeGeometries(geometries);
+}
+
+
+// a polyline is split into plots of a limited size, here within a circle, the pieces give the same plots again
+static void TestPlotPieces
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    Plot3File plot3File;
+
+    plot3File.Command('M');
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(0);
+
+    for (int i = 1; i <= 65530; ++i) {
+        plot3File.Command('N');
+        plot3File.Short(static_cast<short>(i % 1000));
+        plot3File.Short(static_cast<short>(i / 1000));
+        plot3File.Short(0);
+    }
+
+    plot3File.Command('c');
+    plot3File.Short(0);
+    plot3File.Short(0);
+    plot3File.Short(100);
+
+    QString                 error;
+    Plot3Reader::PlotPieces pieces;
+    std::vector<Geometry*>  geometries = ReadFile(directory, plot3File, error, pieces);
+
+    checks.Check(error.isEmpty(), "plot pieces", "the file wasn't read completely");
+    checks.Check(geometries.size() == 2, "plot pieces", "the vectors aren't split into two plots");
+    checks.Check(pieces.size() == geometries.size(), "plot pieces", "a plot's piece is missing");
+
+    if ((geometries.size() == 2) && (pieces.size() == 2)) {
+        const PlotGeometry* first  = dynamic_cast<const PlotGeometry*>(geometries[0]);
+        const PlotGeometry* second = dynamic_cast<const PlotGeometry*>(geometries[1]);
+
+        checks.Check((first != 0) && (Vectors(*first).size() == 1 + 65530 + 1 + 6), "plot pieces", "the first plot is wrong");
+        checks.Check((second != 0) && (Vectors(*second).size() == 1 + 58), "plot pieces", "the second plot is wrong");
+        checks.Check(pieces[geometries[1]].skipped == 6, "plot pieces", "the second plot doesn't start within the circle");
+
+        for (std::vector<Geometry*>::const_iterator it = geometries.begin(); it != geometries.end(); ++it) {
+            const PlotGeometry* plot     = dynamic_cast<const PlotGeometry*>(*it);
+            PlotGeometry*       readPlot = Plot3Reader::ReadPiece(pieces[*it], error);
+
+            checks.Check(error.isEmpty() && (readPlot != 0), "plot pieces", "a piece can't be read again");
+
+            if ((plot != 0) && (readPlot != 0)) {
+                checks.Check(Vectors(*readPlot) == Vectors(*plot), "plot pieces", "a piece read again differs from its plot");
+                checks.Check(readPlot->Color() == plot->Color(), "plot pieces", "a piece read again has another colour");
+            }
+
+            delete readPlot;
+        }
+    }
+
+    FreeGeometries(geometries);
+}
+
+
+// the commands before the error are kept
+static void TestErrors
+(
+    const QTemporaryDir& directory,
+    Checks&              checks
+) {
+    Plot3File truncated;
+
+    truncated.Command('P');
+    truncated.Short(1);
+    truncated.Short(2);
+    truncated.Short(3);
+    truncated.Command('M');
+    truncated.Bytes(5);
+
+    QString                error;
+    std::vector<Geometry*> geometries = ReadFile(directory, truncated, error);
+    QVector3D              minCorner;
+    QVector3D              maxCorner;
+
+    checks.Check(error == "truncated command at byte 7", "truncated command", "the error is wrong");
+    checks.Check(PointCount(geometries, minCorner, maxCorner) == 1, "truncated command", "the point before the error is lost");
+    FreeGeometries(geometries);
+
+    Plot3File unterminated;
+
+    unterminated.Command('t');
+    unterminated.Text("a label");
+    geometries = ReadFile(directory, unterminated, error);
+    checks.Check(error == "unterminated text at byte 0", "unterminated text", "the error is wrong");
+    FreeGeometries(geometries);
+
+    Plot3File unknown;
+
+    unknown.Command('e');
+    unknown.Command('\x01');
+    geometries = ReadFile(directory, unknown, error);
+    checks.Check(error == "unknown command 0x01 at byte 1", "unknown command", "the error is wrong");
+    FreeGeometries(geometries);
+}
+
+
+int main(int argc, char* argv[])
+{
+    QTemporaryDir directory;
+    Checks        checks;
+
+    if (!directory.isValid()) {
+        std::cerr << "Can't create a temporary directory\n";
+        return 1;
+    }
+
+    TestCommandSizes(directory, checks);
+    TestByteOrder(directory, checks);
+    TestPointPieces(directory, checks);
+    TestVectors(directory, checks);
+    TestColors(directory, checks);
+    TestPlotPieces(directory, checks);
+    TestErrors(directory, checks);
+
+    if (checks.Failed() > 0) {
+        std::cerr << checks.Failed() << " checks failed\n";
+        return 1;
+    }
+
+    std::cout << "All checks passed\n";
+
+    return 0;
+}
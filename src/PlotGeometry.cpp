@@ -17,17 +17,45 @@
  *      a BRL-CAD plot (wire-frame) geometry model implementation
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <tuple>
+
+#include <brlcad/Database/Combination.h>
+
 #include "DisplayManager.h"
 #include "PlotGeometry.h"
 
 
-PlotGeometry::PlotGeometry(void) : Geometry(), m_vectorList() {}
+const float  MaxFloat               = std::numeric_limits<float>::max();
+const size_t MaxSize                = std::numeric_limits<size_t>::max();
+const float  FinestTolerance        = 1.f / 1024.f; // of the bounding box diagonal
+const size_t MinLevelSegments       = 16;
+const size_t VectorListElementBytes = 4 * sizeof(double);
+const size_t PartElements           = 262144; // of the vector list per recorded part
+const size_t ReleasedLevelShare     = 16;     // a released plot keeps the levels below this share of its elements
+
+
+PlotGeometry::PlotGeometry(void)
+    : Geometry(), m_vectorList(), m_name(), m_color(), m_levels(), m_levelsValid(false), m_elementCount(0),
+      m_released(false), m_releasedMin(), m_releasedMax() {}
 
 
 PlotGeometry::PlotGeometry
 (
     const PlotGeometry& original
-) : Geometry(original), m_vectorList(original.m_vectorList) {}
+) : Geometry(original),
+    m_vectorList(original.m_vectorList),
+    m_name(original.m_name),
+    m_color(original.m_color),
+    m_levels(original.m_levels),
+    m_levelsValid(original.m_levelsValid),
+    m_elementCount(original.m_elementCount),
+    m_released(original.m_released),
+    m_releasedMin(original.m_releasedMin),
+    m_releasedMax(original.m_releasedMax) {}
 
 
 PlotGeometry::~PlotGeometry(void) {}
@@ -38,14 +66,30 @@ Geometry* PlotGeometry::Clone(void) const {
 }
 
 
+// draws the elements first, ..., end - 1 of the vector list, the ones before only move to their point
 class DrawCallback {
 public:
-    DrawCallback(DisplayManager& displayManager) : m_displayManager(displayManager), m_lastPoint() {}
+    DrawCallback(DisplayManager& displayManager,
+                 size_t          first,
+                 size_t          end) : m_displayManager(displayManager), m_lastPoint(), m_first(first), m_end(end), m_index(0) {}
 
     bool operator()(const BRLCAD::VectorList::Element* element) {
+        if (m_index >= m_end)
+            return false;
+
         if (element != 0) {
+            bool draw = (m_index >= m_first);
+
+            ++m_index;
+
             switch (element->Type()) {
-                case BRLCAD::VectorList::Element::ElementType::PointDraw:
+                case BRLCAD::VectorList::Element::ElementType::PointDraw: {
+                        BRLCAD::Vector3D point = static_cast<const BRLCAD::VectorList::PointDraw*>(element)->Point();
+
+                        if (draw)
+                            m_displayManager.DrawPoint(QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2])));
+                    }
+
                     break;
 
                 case BRLCAD::VectorList::Element::ElementType::PointSize:
@@ -63,7 +107,9 @@ public:
                         BRLCAD::Vector3D point    = static_cast<const BRLCAD::VectorList::LineMove*>(element)->Point();
                         QVector3D        newPoint = QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2]));
 
-                        m_displayManager.DrawLine(m_lastPoint, newPoint);
+                        if (draw)
+                            m_displayManager.DrawLine(m_lastPoint, newPoint);
+
                         m_lastPoint = newPoint;
                     }
 
@@ -115,16 +161,91 @@ public:
 private:
     DisplayManager& m_displayManager;
     QVector3D       m_lastPoint;
+    size_t          m_first;
+    size_t          m_end;
+    size_t          m_index;
 };
 
 
+void PlotGeometry::Prepare(void) {
+    if (!m_levelsValid)
+        BuildLevels();
+}
+
+
 void PlotGeometry::Draw
 (
     DisplayManager& displayManager
-) {
-    DrawCallback callback(displayManager);
+) const {
+    for (size_t part = 0; part < Parts(); ++part)
+        DrawPart(displayManager, part);
+}
 
-    m_vectorList.Iterate(callback);
+
+// an unprepared plot is drawn exact in one part
+size_t PlotGeometry::Parts(void) const {
+    if (!m_levelsValid)
+        return 1;
+
+    return std::max<size_t>((m_elementCount + PartElements - 1) / PartElements, 1);
+}
+
+
+// a part has the elements of its share of the vector list, and its share of every level's segments and points
+// in a detail group of its own
+void PlotGeometry::DrawPart
+(
+    DisplayManager& displayManager,
+    size_t          part
+) const {
+    size_t       parts = Parts();
+    DrawCallback callback(displayManager, part * PartElements, (part + 1 < parts) ? (part + 1) * PartElements : MaxSize);
+
+    if (m_color.isValid())
+        displayManager.PushColor(m_color);
+
+    if (!m_levelsValid || m_levels.empty())
+        m_vectorList.Iterate(callback);
+    else {
+        // the display manager chooses one of the levels by the size of a pixel,
+        // the levels finer than the coarsest sufficient one are left out, and so the exact geometry
+        float                                    detailTolerance = displayManager.DetailTolerance();
+        std::vector<DetailLevel>::const_iterator firstLevel      = m_levels.begin();
+
+        while ((firstLevel + 1 != m_levels.end()) && ((firstLevel + 1)->tolerance <= detailTolerance))
+            ++firstLevel;
+
+        displayManager.BeginDetailLevels();
+
+        // a released plot draws its finest level left, the group waits for a refinement
+        if ((firstLevel->tolerance > detailTolerance) && !m_released) {
+            displayManager.DetailLevel(0.f);
+            m_vectorList.Iterate(callback);
+        }
+
+        for (std::vector<DetailLevel>::const_iterator level = firstLevel; level != m_levels.end(); ++level) {
+            size_t segmentCount = level->segments.size() / 6;
+            size_t pointCount   = level->points.size();
+            size_t pointsFirst  = pointCount * part / parts;
+            size_t pointsEnd    = pointCount * (part + 1) / parts;
+
+            displayManager.DetailLevel(level->tolerance);
+
+            for (size_t i = segmentCount * part / parts; i < segmentCount * (part + 1) / parts; ++i) {
+                const float* segment = level->segments.data() + 6 * i;
+
+                displayManager.DrawLine(QVector3D(segment[0], segment[1], segment[2]), QVector3D(segment[3], segment[4], segment[5]));
+            }
+
+            if (pointsEnd > pointsFirst)
+                displayManager.DrawPoints(level->points.data() + pointsFirst, pointsEnd - pointsFirst);
+        }
+
+        displayManager.EndDetailLevels();
+    }
+
+    if (m_color.isValid())
+        displayManager.PopAttribute();
 }
 
 
@@ -224,7 +345,531 @@ void PlotGeometry::MinMax
     QVector3D& minCorner,
     QVector3D& maxCorner
 ) const {
-    MinMaxCallback callback(minCorner, maxCorner);
+    if (m_released) {
+        if (m_releasedMin.x() <= m_releasedMax.x()) {
+            minCorner.setX(std::min(minCorner.x(), m_releasedMin.x()));
+            minCorner.setY(std::min(minCorner.y(), m_releasedMin.y()));
+            minCorner.setZ(std::min(minCorner.z(), m_releasedMin.z()));
+
+            maxCorner.setX(std::max(maxCorner.x(), m_releasedMax.x()));
+            maxCorner.setY(std::max(maxCorner.y(), m_releasedMax.y()));
+            maxCorner.setZ(std::max(maxCorner.z(), m_releasedMax.z()));
+        }
+    }
+    else {
+        MinMaxCallback callback(minCorner, maxCorner);
+
+        m_vectorList.Iterate(callback);
+    }
+}
+
+
+class PrimitivesCallback {
+public:
+    PrimitivesCallback(PrimitiveCallback& callback) : m_callback(callback), m_lastPoint(), m_polygon() {}
+
+    bool operator()(const BRLCAD::VectorList::Element* element) {
+        if (element != 0) {
+            switch (element->Type()) {
+                case BRLCAD::VectorList::Element::ElementType::PointDraw:
+                    m_callback.Point(ToQVector3D(static_cast<const BRLCAD::VectorList::PointDraw*>(element)->Point()));
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::LineMove:
+                    m_lastPoint = ToQVector3D(static_cast<const BRLCAD::VectorList::LineMove*>(element)->Point());
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::LineDraw: {
+                        QVector3D newPoint = ToQVector3D(static_cast<const BRLCAD::VectorList::LineDraw*>(element)->Point());
+
+                        m_callback.Line(m_lastPoint, newPoint);
+                        m_lastPoint = newPoint;
+                    }
+
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::TriangleStart:
+                case BRLCAD::VectorList::Element::ElementType::PolygonStart:
+                    m_polygon.clear();
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::TriangleMove:
+                    m_polygon.push_back(ToQVector3D(static_cast<const BRLCAD::VectorList::TriangleMove*>(element)->Point()));
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::TriangleDraw:
+                    m_polygon.push_back(ToQVector3D(static_cast<const BRLCAD::VectorList::TriangleDraw*>(element)->Point()));
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::TriangleEnd:
+                    m_polygon.push_back(ToQVector3D(static_cast<const BRLCAD::VectorList::TriangleEnd*>(element)->Point()));
+                    EmitPolygon();
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::PolygonMove:
+                    m_polygon.push_back(ToQVector3D(static_cast<const BRLCAD::VectorList::PolygonMove*>(element)->Point()));
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::PolygonDraw:
+                    m_polygon.push_back(ToQVector3D(static_cast<const BRLCAD::VectorList::PolygonDraw*>(element)->Point()));
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::PolygonEnd:
+                    m_polygon.push_back(ToQVector3D(static_cast<const BRLCAD::VectorList::PolygonEnd*>(element)->Point()));
+                    EmitPolygon();
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    PrimitiveCallback&     m_callback;
+    QVector3D              m_lastPoint;
+    std::vector<QVector3D> m_polygon;
+
+    static QVector3D ToQVector3D
+    (
+        const BRLCAD::Vector3D& point
+    ) {
+        return QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2]));
+    }
+
+    void EmitPolygon(void) {
+        // a triangle fan, the polygons are convex
+        for (size_t i = 2; i < m_polygon.size(); ++i)
+            m_callback.Triangle(m_polygon[0], m_polygon[i - 1], m_polygon[i]);
+
+        m_polygon.clear();
+    }
+};
+
+
+void PlotGeometry::Primitives
+(
+    PrimitiveCallback& callback
+) const {
+    PrimitivesCallback primitivesCallback(callback);
+
+    m_vectorList.Iterate(primitivesCallback);
+}
+
+
+class PolylinesCallback {
+public:
+    PolylinesCallback(std::vector<std::vector<QVector3D> >& polylines,
+                      std::vector<QVector3D>&               points) : m_polylines(polylines), m_points(points), m_elementCount(0) {}
+
+    bool operator()(const BRLCAD::VectorList::Element* element) {
+        if (element != 0) {
+            ++m_elementCount;
+
+            switch (element->Type()) {
+                case BRLCAD::VectorList::Element::ElementType::PointDraw: {
+                        BRLCAD::Vector3D point = static_cast<const BRLCAD::VectorList::PointDraw*>(element)->Point();
+
+                        m_points.push_back(QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2])));
+                    }
+
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::LineMove: {
+                        BRLCAD::Vector3D point = static_cast<const BRLCAD::VectorList::LineMove*>(element)->Point();
+
+                        m_polylines.push_back(std::vector<QVector3D>());
+                        m_polylines.back().push_back(QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2])));
+                    }
+
+                    break;
+
+                case BRLCAD::VectorList::Element::ElementType::LineDraw: {
+                        BRLCAD::Vector3D point = static_cast<const BRLCAD::VectorList::LineDraw*>(element)->Point();
+
+                        if (m_polylines.empty())
+                            m_polylines.push_back(std::vector<QVector3D>(1, QVector3D()));
+
+                        m_polylines.back().push_back(QVector3D(static_cast<float>(point.coordinates[0]), static_cast<float>(point.coordinates[1]), static_cast<float>(point.coordinates[2])));
+                    }
+
+                    break;
+
+                default:
+                    break;
+            }
+        }
 
+        return true;
+    }
+
+    size_t ElementCount(void) const {
+        return m_elementCount;
+    }
+
+private:
+    std::vector<std::vector<QVector3D> >& m_polylines;
+    std::vector<QVector3D>&               m_points;
+    size_t                                m_elementCount;
+};
+
+
+static float DistanceToSegment
+(
+    const QVector3D& point,
+    const QVector3D& start,
+    const QVector3D& end
+) {
+    QVector3D direction = end - start;
+    float     length    = direction.lengthSquared();
+    float     t         = 0.f;
+
+    if (length > 0.f)
+        t = std::min(std::max(QVector3D::dotProduct(point - start, direction) / length, 0.f), 1.f);
+
+    return (start + t * direction - point).length();
+}
+
+
+// Douglas-Peucker, marks the points to keep
+// the sections to split are kept on a stack of their own, a polyline may be longer than the thread's stack allows for recursion
+static void Simplify
+(
+    const std::vector<QVector3D>& polyline,
+    float                         tolerance,
+    std::vector<bool>&            keep
+) {
+    std::vector<std::pair<size_t, size_t> > sections;
+
+    keep.front() = true;
+    keep.back()  = true;
+    sections.push_back(std::make_pair(0, polyline.size() - 1));
+
+    while (!sections.empty()) {
+        size_t first = sections.back().first;
+        size_t last  = sections.back().second;
+
+        sections.pop_back();
+
+        float  maxDistance = 0.f;
+        size_t maxIndex    = first;
+
+        for (size_t i = first + 1; i < last; ++i) {
+            float distance = DistanceToSegment(polyline[i], polyline[first], polyline[last]);
+
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                maxIndex    = i;
+            }
+        }
+
+        if (maxDistance > tolerance) {
+            keep[maxIndex] = true;
+            sections.push_back(std::make_pair(first, maxIndex));
+            sections.push_back(std::make_pair(maxIndex, last));
+        }
+    }
+}
+
+
+void PlotGeometry::BuildLevels(void) {
+    std::vector<std::vector<QVector3D> > polylines;
+    std::vector<QVector3D>               points;
+    PolylinesCallback                    callback(polylines, points);
+    QVector3D                            minCorner(MaxFloat, MaxFloat, MaxFloat);
+    QVector3D                            maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
+    size_t                               segmentCount = 0;
+
+    m_levels.clear();
     m_vectorList.Iterate(callback);
+    m_elementCount = callback.ElementCount();
+    MinMax(minCorner, maxCorner);
+
+    for (size_t i = 0; i < polylines.size(); ++i) {
+        if (polylines[i].size() > 1)
+            segmentCount += polylines[i].size() - 1;
+    }
+
+    float diagonal = (minCorner.x() <= maxCorner.x()) ? (maxCorner - minCorner).length() : 0.f;
+
+    // every level has four times the tolerance of the previous one
+    for (float tolerance = diagonal * FinestTolerance; (segmentCount > MinLevelSegments) && (tolerance > 0.f) && (tolerance < diagonal); tolerance *= 4.f) {
+        DetailLevel                                         level;
+        std::set<std::tuple<int, int, int, int, int, int> > clusteredSegments;
+
+        level.tolerance = tolerance;
+
+        for (size_t i = 0; i < polylines.size(); ++i) {
+            const std::vector<QVector3D>& polyline = polylines[i];
+
+            if (polyline.size() < 2)
+                continue;
+
+            std::vector<bool> keep(polyline.size(), false);
+
+            Simplify(polyline, tolerance, keep);
+
+            // the points are clustered in cells of the tolerance's size, sub-pixel segments vanish and duplicates are merged
+            bool      started = false;
+            int       cell[3] = {0, 0, 0};
+            QVector3D lastPoint;
+
+            for (size_t j = 0; j < polyline.size(); ++j) {
+                if (!keep[j])
+                    continue;
+
+                int newCell[3] = {static_cast<int>(floor((polyline[j].x() - minCorner.x()) / tolerance)),
+                                  static_cast<int>(floor((polyline[j].y() - minCorner.y()) / tolerance)),
+                                  static_cast<int>(floor((polyline[j].z() - minCorner.z()) / tolerance))};
+                QVector3D newPoint(minCorner.x() + (newCell[0] + 0.5f) * tolerance,
+                                   minCorner.y() + (newCell[1] + 0.5f) * tolerance,
+                                   minCorner.z() + (newCell[2] + 0.5f) * tolerance);
+
+                if (started && ((newCell[0] != cell[0]) || (newCell[1] != cell[1]) || (newCell[2] != cell[2]))) {
+                    std::tuple<int, int, int, int, int, int> key = std::min(std::make_tuple(cell[0], cell[1], cell[2], newCell[0], newCell[1], newCell[2]),
+                                                                            std::make_tuple(newCell[0], newCell[1], newCell[2], cell[0], cell[1], cell[2]));
+
+                    if (clusteredSegments.insert(key).second) {
+                        level.segments.push_back(lastPoint.x());
+                        level.segments.push_back(lastPoint.y());
+                        level.segments.push_back(lastPoint.z());
+                        level.segments.push_back(newPoint.x());
+                        level.segments.push_back(newPoint.y());
+                        level.segments.push_back(newPoint.z());
+                    }
+                }
+
+                if (!started || (newCell[0] != cell[0]) || (newCell[1] != cell[1]) || (newCell[2] != cell[2])) {
+                    cell[0]   = newCell[0];
+                    cell[1]   = newCell[1];
+                    cell[2]   = newCell[2];
+                    lastPoint = newPoint;
+                    started   = true;
+                }
+            }
+        }
+
+        // the points are clustered the same way, a level without them would lose them
+        std::set<std::tuple<int, int, int> > clusteredPoints;
+
+        for (std::vector<QVector3D>::const_iterator point = points.begin(); point != points.end(); ++point) {
+            int cell[3] = {static_cast<int>(floor((point->x() - minCorner.x()) / tolerance)),
+                           static_cast<int>(floor((point->y() - minCorner.y()) / tolerance)),
+                           static_cast<int>(floor((point->z() - minCorner.z()) / tolerance))};
+
+            if (clusteredPoints.insert(std::make_tuple(cell[0], cell[1], cell[2])).second)
+                level.points.push_back(QVector3D(minCorner.x() + (cell[0] + 0.5f) * tolerance,
+                                                 minCorner.y() + (cell[1] + 0.5f) * tolerance,
+                                                 minCorner.z() + (cell[2] + 0.5f) * tolerance));
+        }
+
+        size_t levelSegmentCount = level.segments.size() / 6;
+
+        // a level has to be worth it
+        if (4 * levelSegmentCount > 3 * segmentCount)
+            continue;
+
+        segmentCount = levelSegmentCount;
+        m_levels.push_back(level);
+    }
+
+    m_levelsValid = true;
+}
+
+
+const std::string& PlotGeometry::Name(void) const {
+    return m_name;
+}
+
+
+void PlotGeometry::SetName
+(
+    const std::string& name
+) {
+    m_name = name;
+}
+
+
+const QColor& PlotGeometry::Color(void) const {
+    return m_color;
+}
+
+
+void PlotGeometry::SetColor
+(
+    const QColor& color
+) {
+    m_color = color;
+}
+
+
+static void CollectLeaves
+(
+    const BRLCAD::Combination::ConstTreeNode& tree,
+    std::vector<std::string>&                 leaves
+) {
+    switch (tree.Operation()) {
+        case BRLCAD::Combination::ConstTreeNode::Union:
+        case BRLCAD::Combination::ConstTreeNode::Intersection:
+        case BRLCAD::Combination::ConstTreeNode::Subtraction:
+        case BRLCAD::Combination::ConstTreeNode::ExclusiveOr:
+            CollectLeaves(tree.LeftOperand(), leaves);
+            CollectLeaves(tree.RightOperand(), leaves);
+            break;
+
+        case BRLCAD::Combination::ConstTreeNode::Not:
+            CollectLeaves(tree.Operand(), leaves);
+            break;
+
+        case BRLCAD::Combination::ConstTreeNode::Leaf:
+            leaves.push_back(tree.Name());
+    }
+}
+
+
+// the paths to the regions (or primitives outside of regions) below an object with their colors
+static void CollectRegions
+(
+    const BRLCAD::ConstDatabase&                  database,
+    const std::string&                            objectName,
+    const std::string&                            path,
+    const QColor&                                 parentColor,
+    std::vector<std::pair<std::string, QColor> >& regions
+) {
+    std::vector<std::string> leaves;
+    QColor                   color = parentColor;
+
+    database.Get(objectName.c_str(), [&path, &color, &leaves, &regions](const BRLCAD::Object& object) {
+        const BRLCAD::Combination* combination = dynamic_cast<const BRLCAD::Combination*>(&object);
+
+        if (combination != 0) {
+            if (combination->HasColor())
+                color = QColor::fromRgbF(combination->Red(), combination->Green(), combination->Blue());
+
+            if (combination->IsRegion())
+                regions.push_back(std::make_pair(path, color));
+            else
+                CollectLeaves(combination->Tree(), leaves);
+        }
+        else
+            regions.push_back(std::make_pair(path, color));
+    });
+
+    for (std::vector<std::string>::const_iterator it = leaves.begin(); it != leaves.end(); ++it)
+        CollectRegions(database, *it, path + "/" + *it, color, regions);
+}
+
+
+size_t PlotGeometry::Bytes(void) const {
+    size_t ret = sizeof(PlotGeometry) + m_name.capacity() + m_levels.capacity() * sizeof(DetailLevel);
+
+    // the vector list keeps a command and three doubles per element, BuildLevels() has counted them,
+    // a released plot has none left
+    if (!m_levelsValid) {
+        m_vectorList.Iterate([&ret](const BRLCAD::VectorList::Element*) {
+            ret += VectorListElementBytes;
+            return true;
+        });
+    }
+    else if (!m_released)
+        ret += m_elementCount * VectorListElementBytes;
+
+    for (std::vector<DetailLevel>::const_iterator it = m_levels.begin(); it != m_levels.end(); ++it)
+        ret += it->segments.capacity() * sizeof(float) + it->points.capacity() * sizeof(QVector3D);
+
+    return ret;
+}
+
+
+bool PlotGeometry::Releasable(void) const {
+    return !m_released && m_levelsValid && !m_levels.empty();
+}
+
+
+// the levels stay valid, a recording doesn't need the vector list for them
+PlotGeometry* PlotGeometry::ReleasedClone(void) const {
+    PlotGeometry* ret = 0;
+
+    if (Releasable()) {
+        ret = new PlotGeometry();
+
+        ret->m_name         = m_name;
+        ret->m_color        = m_color;
+        ret->m_levelsValid  = true;
+        ret->m_elementCount = m_elementCount;
+        ret->m_released     = true;
+        ret->m_releasedMin  = QVector3D(MaxFloat, MaxFloat, MaxFloat);
+        ret->m_releasedMax  = QVector3D(-MaxFloat, -MaxFloat, -MaxFloat);
+        MinMax(ret->m_releasedMin, ret->m_releasedMax);
+
+        // the coarsest level, and the finer ones as long as they are small
+        std::vector<DetailLevel>::const_iterator firstKept = m_levels.end() - 1;
+
+        while ((firstKept != m_levels.begin()) && ((firstKept - 1)->segments.size() / 6 + (firstKept - 1)->points.size() <= m_elementCount / ReleasedLevelShare))
+            --firstKept;
+
+        ret->m_levels.assign(firstKept, m_levels.end());
+    }
+
+    return ret;
+}
+
+
+bool PlotGeometry::Released(void) const {
+    return m_released;
+}
+
+
+PlotGeometry* PlotGeometry::RestoredClone
+(
+    const BRLCAD::ConstDatabase& database
+) const {
+    return PlotRegion(database, m_name, m_color);
+}
+
+
+std::vector<PlotGeometry*> PlotGeometry::PlotRegions
+(
+    const BRLCAD::ConstDatabase& database,
+    const char*                  objectName
+) {
+    std::vector<std::pair<std::string, QColor> > regions = Regions(database, objectName);
+    std::vector<PlotGeometry*>                   ret;
+
+    for (std::vector<std::pair<std::string, QColor> >::const_iterator it = regions.begin(); it != regions.end(); ++it)
+        ret.push_back(PlotRegion(database, it->first, it->second));
+
+    return ret;
+}
+
+
+std::vector<std::pair<std::string, QColor> > PlotGeometry::Regions
+(
+    const BRLCAD::ConstDatabase& database,
+    const char*                  objectName
+) {
+    std::vector<std::pair<std::string, QColor> > ret;
+
+    CollectRegions(database, objectName, objectName, QColor(), ret);
+
+    return ret;
+}
+
+
+PlotGeometry* PlotGeometry::PlotRegion
+(
+    const BRLCAD::ConstDatabase& database,
+    const std::string&           path,
+    const QColor&                color
+) {
+    PlotGeometry* ret = new PlotGeometry();
+
+    // the plot of a path applies the matrices along it
+    database.Plot(path.c_str(), ret->VectorList());
+    ret->SetName(path);
+    ret->SetColor(color);
+
+    return ret;
 }
@@ -20,7 +20,14 @@
 #ifndef PLOTGEOMETRY_INCLUDED
 #define PLOTGEOMETRY_INCLUDED
 
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QColor>
+
 #include <brlcad/VectorList.h>
+#include <brlcad/Database/ConstDatabase.h>
 
 #include "GeometryModel.h"
 
@@ -33,20 +40,71 @@ public:
 
     virtual Geometry*         Clone(void) const;
 
-    virtual void              Draw(DisplayManager& displayManager);
+    virtual void              Prepare(void);
+    virtual void              Draw(DisplayManager& displayManager) const;
+    virtual size_t            Parts(void) const;
+    virtual void              DrawPart(DisplayManager& displayManager,
+                                       size_t          part) const;
     virtual void              MinMax(QVector3D& minCorner,
                                      QVector3D& maxCorner) const;
+    virtual void              Primitives(PrimitiveCallback& callback) const;
 
     const BRLCAD::VectorList& VectorList(void) const {
         return m_vectorList;
     }
 
     BRLCAD::VectorList&       VectorList(void) {
+        m_levelsValid = false;
         return m_vectorList;
     }
 
+    // the plotted object, may be a path
+    const std::string&        Name(void) const;
+    void                      SetName(const std::string& name);
+
+    // an invalid color uses the display manager's one
+    const QColor&             Color(void) const;
+    void                      SetColor(const QColor& color);
+
+    // the vector list and the finer levels can be dropped when the scene has been uploaded:
+    // the released clone keeps the bounding box and the coarsest levels, a recording draws them
+    // until the restored clone, the object plotted again, takes its place in the model
+    size_t                    Bytes(void) const;         // the estimated memory usage
+    bool                      Releasable(void) const;    // a prepared plot with levels to draw in the meantime
+    PlotGeometry*             ReleasedClone(void) const; // 0 if not releasable
+    bool                      Released(void) const;
+    PlotGeometry*             RestoredClone(const BRLCAD::ConstDatabase& database) const;
+
+    // one plot per region below the object, in the color of the region or its nearest colored parent
+    static std::vector<PlotGeometry*> PlotRegions(const BRLCAD::ConstDatabase& database,
+                                                  const char*                  objectName);
+
+    // the steps of PlotRegions(): the paths to the regions with their colors, and the plot of one of them
+    static std::vector<std::pair<std::string, QColor> > Regions(const BRLCAD::ConstDatabase& database,
+                                                                const char*                  objectName);
+    static PlotGeometry*              PlotRegion(const BRLCAD::ConstDatabase& database,
+                                                 const std::string&           path,
+                                                 const QColor&                color);
+
 private:
-    BRLCAD::VectorList m_vectorList;
+    // a simplified representation of the wire-frame
+    struct DetailLevel {
+        float                  tolerance; // in model units
+        std::vector<float>     segments;  // start x, y, z and end x, y, z
+        std::vector<QVector3D> points;    // one per cell of the tolerance's size
+    };
+
+    BRLCAD::VectorList       m_vectorList;
+    std::string              m_name;
+    QColor                   m_color;
+    std::vector<DetailLevel> m_levels;
+    bool                     m_levelsValid;
+    size_t                   m_elementCount; // of the vector list, valid with the levels
+    bool                     m_released;
+    QVector3D                m_releasedMin; // the bounding box of a released plot
+    QVector3D                m_releasedMax;
+
+    void BuildLevels(void);
 
     PlotGeometry& operator=(const PlotGeometry& original);
 };
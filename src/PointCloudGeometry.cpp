@@ -0,0 +1,357 @@
+/*                P O I N T C L O U D G E O M E T R Y . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file PointCloudGeometry.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a point cloud geometry model implementation
+ */
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+#include "DisplayManager.h"
+#include "PointCloudGeometry.h"
+
+
+const float  MaxFloat        = std::numeric_limits<float>::max();
+const size_t NodePoints      = 65536;         // the octree splits larger nodes
+const int    MaxDepth        = 16;            // for the nodes of many equal points
+const size_t PartPoints      = 262144;        // per recorded part, in whole nodes
+const float  CoarsestCells   = 8.f;           // along the node's extent
+const float  FinestTolerance = 1.f / 1024.f;  // of the node's extent
+
+
+PointCloudGeometry::PointCloudGeometry(void)
+    : Geometry(), m_points(), m_color(), m_minCorner(MaxFloat, MaxFloat, MaxFloat), m_maxCorner(-MaxFloat, -MaxFloat, -MaxFloat),
+      m_nodes(), m_partNodes(), m_nodesValid(false) {}
+
+
+PointCloudGeometry::PointCloudGeometry
+(
+    const PointCloudGeometry& original
+) : Geometry(original),
+    m_points(original.m_points),
+    m_color(original.m_color),
+    m_minCorner(original.m_minCorner),
+    m_maxCorner(original.m_maxCorner),
+    m_nodes(original.m_nodes),
+    m_partNodes(original.m_partNodes),
+    m_nodesValid(original.m_nodesValid) {}
+
+
+PointCloudGeometry::~PointCloudGeometry(void) {}
+
+
+Geometry* PointCloudGeometry::Clone(void) const {
+    return new PointCloudGeometry(*this);
+}
+
+
+void PointCloudGeometry::Prepare(void) {
+    if (!m_nodesValid)
+        BuildNodes();
+}
+
+
+void PointCloudGeometry::Draw
+(
+    DisplayManager& displayManager
+) const {
+    for (size_t part = 0; part < Parts(); ++part)
+        DrawPart(displayManager, part);
+}
+
+
+// an unprepared point cloud draws all its points in one part
+size_t PointCloudGeometry::Parts(void) const {
+    if (!m_nodesValid)
+        return 1;
+
+    return std::max<size_t>(m_partNodes.size(), 1);
+}
+
+
+void PointCloudGeometry::DrawPart
+(
+    DisplayManager& displayManager,
+    size_t          part
+) const {
+    if (m_nodesValid && (part >= m_partNodes.size()))
+        return;
+
+    if (m_color.isValid())
+        displayManager.PushColor(m_color);
+
+    if (!m_nodesValid) {
+        if (!m_points.empty())
+            displayManager.DrawPoints(m_points.data(), m_points.size());
+    }
+    else {
+        float               detailTolerance = displayManager.DetailTolerance();
+        size_t              endNode         = (part + 1 < m_partNodes.size()) ? m_partNodes[part + 1] : m_nodes.size();
+        std::vector<float>  tolerances;
+        std::vector<size_t> counts;
+
+        for (std::vector<Node>::const_iterator node = m_nodes.begin() + m_partNodes[part]; node != m_nodes.begin() + endNode; ++node) {
+            const QVector3D* points = m_points.data() + node->first;
+
+            if (node->levels.empty())
+                displayManager.DrawPoints(points, node->count);
+            else {
+                // as with the plots: the coarsest sufficient level and the coarser ones, all points only if no level suffices,
+                // every level is the first points of the finer one, this way the points are recorded once
+                std::vector<DetailLevel>::const_iterator firstLevel = node->levels.begin();
+
+                while ((firstLevel + 1 != node->levels.end()) && ((firstLevel + 1)->tolerance <= detailTolerance))
+                    ++firstLevel;
+
+                tolerances.clear();
+                counts.clear();
+
+                if (firstLevel->tolerance > detailTolerance) {
+                    tolerances.push_back(0.f);
+                    counts.push_back(node->count);
+                }
+
+                for (std::vector<DetailLevel>::const_iterator level = firstLevel; level != node->levels.end(); ++level) {
+                    tolerances.push_back(level->tolerance);
+                    counts.push_back(level->count);
+                }
+
+                displayManager.DrawNestedPoints(points, tolerances, counts);
+            }
+        }
+    }
+
+    if (m_color.isValid())
+        displayManager.PopAttribute();
+}
+
+
+void PointCloudGeometry::MinMax
+(
+    QVector3D& minCorner,
+    QVector3D& maxCorner
+) const {
+    if (m_minCorner.x() <= m_maxCorner.x()) {
+        minCorner.setX(std::min(minCorner.x(), m_minCorner.x()));
+        minCorner.setY(std::min(minCorner.y(), m_minCorner.y()));
+        minCorner.setZ(std::min(minCorner.z(), m_minCorner.z()));
+
+        maxCorner.setX(std::max(maxCorner.x(), m_maxCorner.x()));
+        maxCorner.setY(std::max(maxCorner.y(), m_maxCorner.y()));
+        maxCorner.setZ(std::max(maxCorner.z(), m_maxCorner.z()));
+    }
+}
+
+
+void PointCloudGeometry::Primitives
+(
+    PrimitiveCallback& callback
+) const {
+    for (std::vector<QVector3D>::const_iterator it = m_points.begin(); it != m_points.end(); ++it)
+        callback.Point(*it);
+}
+
+
+void PointCloudGeometry::Append
+(
+    const QVector3D& point
+) {
+    m_points.push_back(point);
+
+    m_minCorner.setX(std::min(m_minCorner.x(), point.x()));
+    m_minCorner.setY(std::min(m_minCorner.y(), point.y()));
+    m_minCorner.setZ(std::min(m_minCorner.z(), point.z()));
+
+    m_maxCorner.setX(std::max(m_maxCorner.x(), point.x()));
+    m_maxCorner.setY(std::max(m_maxCorner.y(), point.y()));
+    m_maxCorner.setZ(std::max(m_maxCorner.z(), point.z()));
+
+    m_nodesValid = false;
+}
+
+
+size_t PointCloudGeometry::Size(void) const {
+    return m_points.size();
+}
+
+
+const QColor& PointCloudGeometry::Color(void) const {
+    return m_color;
+}
+
+
+void PointCloudGeometry::SetColor
+(
+    const QColor& color
+) {
+    m_color = color;
+}
+
+
+size_t PointCloudGeometry::Bytes(void) const {
+    size_t ret = sizeof(PointCloudGeometry) + m_points.capacity() * sizeof(QVector3D) + m_nodes.capacity() * sizeof(Node) +
+                 m_partNodes.capacity() * sizeof(size_t);
+
+    for (std::vector<Node>::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it)
+        ret += it->levels.capacity() * sizeof(DetailLevel);
+
+    return ret;
+}
+
+
+void PointCloudGeometry::BuildNodes(void) {
+    m_nodes.clear();
+
+    if (!m_points.empty()) {
+        // the octree's cells are cubes
+        QVector3D size   = m_maxCorner - m_minCorner;
+        float     extent = std::max(std::max(size.x(), size.y()), size.z());
+
+        Split(0, m_points.size(), m_minCorner, m_minCorner + QVector3D(extent, extent, extent), 0);
+    }
+
+    // the nodes are consecutive in m_points, a part takes them until it has enough points
+    m_partNodes.clear();
+
+    size_t partPoints = 0;
+
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        if (m_partNodes.empty() || (partPoints >= PartPoints)) {
+            m_partNodes.push_back(i);
+            partPoints = 0;
+        }
+
+        partPoints += m_nodes[i].count;
+    }
+
+    m_nodesValid = true;
+}
+
+
+void PointCloudGeometry::Split
+(
+    size_t           first,
+    size_t           count,
+    const QVector3D& minCorner,
+    const QVector3D& maxCorner,
+    int              depth
+) {
+    if ((count <= NodePoints) || (depth >= MaxDepth)) {
+        Node node;
+
+        node.first = first;
+        node.count = count;
+        BuildLevels(node);
+        m_nodes.push_back(node);
+    }
+    else {
+        // the octants in place: x is the highest bit of their index, z the lowest
+        QVector3D                        centre = (minCorner + maxCorner) / 2.f;
+        std::vector<QVector3D>::iterator bounds[9];
+
+        bounds[0] = m_points.begin() + first;
+        bounds[8] = bounds[0] + count;
+        bounds[4] = std::partition(bounds[0], bounds[8], [&centre](const QVector3D& point) { return point.x() < centre.x(); });
+
+        for (int i = 0; i < 8; i += 4)
+            bounds[i + 2] = std::partition(bounds[i], bounds[i + 4], [&centre](const QVector3D& point) { return point.y() < centre.y(); });
+
+        for (int i = 0; i < 8; i += 2)
+            bounds[i + 1] = std::partition(bounds[i], bounds[i + 2], [&centre](const QVector3D& point) { return point.z() < centre.z(); });
+
+        for (int i = 0; i < 8; ++i) {
+            QVector3D childMin(((i & 4) != 0) ? centre.x() : minCorner.x(),
+                               ((i & 2) != 0) ? centre.y() : minCorner.y(),
+                               ((i & 1) != 0) ? centre.z() : minCorner.z());
+            QVector3D childMax(((i & 4) != 0) ? maxCorner.x() : centre.x(),
+                               ((i & 2) != 0) ? maxCorner.y() : centre.y(),
+                               ((i & 1) != 0) ? maxCorner.z() : centre.z());
+
+            if (bounds[i + 1] != bounds[i])
+                Split(bounds[i] - m_points.begin(), bounds[i + 1] - bounds[i], childMin, childMax, depth + 1);
+        }
+    }
+}
+
+
+static unsigned long long CellKey
+(
+    const QVector3D& point,
+    const QVector3D& origin,
+    float            cell
+) {
+    unsigned long long x = static_cast<unsigned long long>((point.x() - origin.x()) / cell);
+    unsigned long long y = static_cast<unsigned long long>((point.y() - origin.y()) / cell);
+    unsigned long long z = static_cast<unsigned long long>((point.z() - origin.z()) / cell);
+
+    return (x << 42) | (y << 21) | z;
+}
+
+
+void PointCloudGeometry::BuildLevels
+(
+    Node& node
+) {
+    QVector3D minCorner(MaxFloat, MaxFloat, MaxFloat);
+    QVector3D maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
+
+    for (size_t i = node.first; i < node.first + node.count; ++i) {
+        minCorner.setX(std::min(minCorner.x(), m_points[i].x()));
+        minCorner.setY(std::min(minCorner.y(), m_points[i].y()));
+        minCorner.setZ(std::min(minCorner.z(), m_points[i].z()));
+
+        maxCorner.setX(std::max(maxCorner.x(), m_points[i].x()));
+        maxCorner.setY(std::max(maxCorner.y(), m_points[i].y()));
+        maxCorner.setZ(std::max(maxCorner.z(), m_points[i].z()));
+    }
+
+    QVector3D                size    = maxCorner - minCorner;
+    float                    extent  = std::max(std::max(size.x(), size.y()), size.z());
+    size_t                   sampled = 0; // the points of the coarser levels, they are moved to the front
+    std::vector<DetailLevel> levels;      // the coarsest first
+
+    // every level has a quarter of the tolerance of the previous one
+    for (float cell = extent / CoarsestCells; (cell > 0.f) && (cell >= extent * FinestTolerance); cell /= 4.f) {
+        std::unordered_set<unsigned long long> occupiedCells;
+
+        for (size_t i = 0; i < node.count; ++i) {
+            bool newCell = occupiedCells.insert(CellKey(m_points[node.first + i], minCorner, cell)).second;
+
+            if ((i >= sampled) && newCell) {
+                std::swap(m_points[node.first + i], m_points[node.first + sampled]);
+                ++sampled;
+            }
+        }
+
+        // the level has to be worth it, otherwise all points are drawn
+        if (2 * sampled > node.count)
+            break;
+
+        // the same points with a finer grid
+        if (!levels.empty() && (levels.back().count == sampled))
+            levels.back().tolerance = cell;
+        else {
+            DetailLevel level;
+
+            level.tolerance = cell;
+            level.count     = sampled;
+            levels.push_back(level);
+        }
+    }
+
+    node.levels.assign(levels.rbegin(), levels.rend());
+}
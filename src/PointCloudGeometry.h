@@ -0,0 +1,96 @@
+/*                  P O I N T C L O U D G E O M E T R Y . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file PointCloudGeometry.h
+ *
+ *  BRL-CAD GUI:
+ *      a point cloud geometry model declaration
+ *
+ *  The points are split by an octree into nodes of a limited size.  A node is
+ *  a detail group of the scene: its levels keep one point per cell of a grid,
+ *  with the cells four times smaller from level to level.  The points of a
+ *  node are sorted such that every level is a prefix of them and includes the
+ *  coarser ones, i.e. the levels need no memory of their own, neither here
+ *  nor in the scene.
+ */
+
+#ifndef POINTCLOUDGEOMETRY_INCLUDED
+#define POINTCLOUDGEOMETRY_INCLUDED
+
+#include <vector>
+
+#include <QColor>
+#include <QVector3D>
+
+#include "GeometryModel.h"
+
+
+class PointCloudGeometry : public Geometry {
+public:
+    PointCloudGeometry(void);
+    PointCloudGeometry(const PointCloudGeometry& original);
+    virtual ~PointCloudGeometry(void);
+
+    virtual Geometry*         Clone(void) const;
+
+    virtual void              Prepare(void);
+    virtual void              Draw(DisplayManager& displayManager) const;
+    virtual size_t            Parts(void) const;
+    virtual void              DrawPart(DisplayManager& displayManager,
+                                       size_t          part) const;
+    virtual void              MinMax(QVector3D& minCorner,
+                                     QVector3D& maxCorner) const;
+    virtual void              Primitives(PrimitiveCallback& callback) const;
+
+    void                      Append(const QVector3D& point);
+    size_t                    Size(void) const;
+
+    // an invalid color uses the display manager's one
+    const QColor&             Color(void) const;
+    void                      SetColor(const QColor& color);
+
+    size_t                    Bytes(void) const; // the estimated memory usage
+
+private:
+    struct DetailLevel {
+        float  tolerance; // in model units, the size of the grid's cells
+        size_t count;     // the first points of the node
+    };
+
+    struct Node {
+        size_t                   first;
+        size_t                   count;
+        std::vector<DetailLevel> levels; // the finest first
+    };
+
+    std::vector<QVector3D> m_points;    // sorted by the nodes
+    QColor                 m_color;
+    QVector3D              m_minCorner;
+    QVector3D              m_maxCorner;
+    std::vector<Node>      m_nodes;
+    std::vector<size_t>    m_partNodes; // the first node of every part
+    bool                   m_nodesValid;
+
+    void BuildNodes(void);
+    void Split(size_t           first,
+               size_t           count,
+               const QVector3D& minCorner,
+               const QVector3D& maxCorner,
+               int              depth);
+    void BuildLevels(Node& node);
+
+    PointCloudGeometry& operator=(const PointCloudGeometry& original);
+};
+
+
+#endif // POINTCLOUDGEOMETRY_INCLUDED
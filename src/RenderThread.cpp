@@ -0,0 +1,314 @@
+/*                      R E N D E R T H R E A D . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file RenderThread.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the render thread class implementation
+ */
+
+#include <algorithm>
+
+#include <QElapsedTimer>
+#include <QMetaObject>
+
+#include "DisplayManager.h"
+#include "RenderThread.h"
+
+
+// the state DisplayManager::initializeGL() sets for the views
+static void InitializeState(void) {
+    glClearColor(1.f, 1.f, 1.f, 1.f);
+    glColor4f(0.5f, 0.5f, 0.5f, 1.f);
+    glEnable(GL_NORMALIZE);
+
+    float lightColor[] = {1.f, 1.f, 1.f, 1.f};
+
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+    glLightModeli(GL_LIGHT_MODEL_LOCAL_VIEWER, GL_FALSE);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, lightColor);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, lightColor);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+
+RenderThread::RenderThread
+(
+    std::shared_ptr<SceneBuffers> scene
+) : QThread(),
+    m_scene(scene),
+    m_surface(0),
+    m_context(0),
+    m_mutex(),
+    m_wakeUp(),
+    m_finished(),
+    m_pending(),
+    m_forgotten(),
+    m_current(0),
+    m_targets(),
+    m_stop(false) {
+    // the surface has to be created on the GUI thread, the context is handed over to this one
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(QOpenGLContext::globalShareContext()->format());
+    m_surface->create();
+
+    m_context = new QOpenGLContext();
+    m_context->setFormat(m_surface->format());
+    m_context->setShareContext(QOpenGLContext::globalShareContext());
+    m_context->create();
+    m_context->moveToThread(this);
+
+    start();
+}
+
+
+RenderThread::~RenderThread(void) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_stop = true;
+    }
+
+    m_wakeUp.notify_one();
+    wait();
+
+    delete m_context;
+    delete m_surface;
+}
+
+
+void RenderThread::Post
+(
+    const Frame& frame
+) {
+    if (frame.size.isEmpty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<Frame>::iterator it = m_pending.begin();
+
+        while ((it != m_pending.end()) && (it->view != frame.view))
+            ++it;
+
+        if (it != m_pending.end()) {
+            // the replaced frame's upload is reported with the new one
+            FrameStatistics statistics = it->statistics;
+
+            *it = frame;
+            it->statistics.uploadedFloats   += statistics.uploadedFloats;
+            it->statistics.copiedFloats     += statistics.copiedFloats;
+            it->statistics.peakStagingBytes  = std::max(it->statistics.peakStagingBytes, statistics.peakStagingBytes);
+        }
+        else
+            m_pending.push_back(frame);
+    }
+
+    m_wakeUp.notify_one();
+}
+
+
+void RenderThread::Forget
+(
+    DisplayManager* view
+) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::vector<Frame>::iterator it = m_pending.begin();
+
+        while (it != m_pending.end()) {
+            if (it->view == view)
+                it = m_pending.erase(it);
+            else
+                ++it;
+        }
+
+        while (m_current == view)
+            m_finished.wait(lock);
+
+        // the framebuffers belong to this thread's context
+        m_forgotten.push_back(view);
+    }
+
+    m_wakeUp.notify_one();
+}
+
+
+bool RenderThread::Present
+(
+    DisplayManager*   view,
+    const QMatrix4x4& projection,
+    const QMatrix4x4& model2Display
+) {
+    std::lock_guard<std::mutex>                        lock(m_mutex);
+    std::map<DisplayManager*, Targets>::const_iterator it  = m_targets.find(view);
+    bool                                               ret = (it != m_targets.end()) && (it->second.front != 0);
+
+    if (ret) {
+        const Frame& frame = it->second.frame;
+
+        // the frame's display plane as seen in the current view:
+        // exact for shifts and zooms, close enough for the rotation until the next frame is done
+        QMatrix4x4 reprojection = model2Display * frame.model2Display.inverted();
+
+        glPushAttrib(GL_ENABLE_BIT);
+        glDisable(GL_LIGHTING);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, it->second.front->texture());
+
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glLoadMatrixf(projection.constData());
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glLoadMatrixf(reprojection.constData());
+
+        // the minimal display y is the top of the view, that's the top row of the texture
+        glColor4f(1.f, 1.f, 1.f, 1.f);
+        glBegin(GL_QUADS);
+        glTexCoord2f(0.f, 1.f);
+        glVertex2f(frame.viewMin.x(), frame.viewMin.y());
+        glTexCoord2f(1.f, 1.f);
+        glVertex2f(frame.viewMax.x(), frame.viewMin.y());
+        glTexCoord2f(1.f, 0.f);
+        glVertex2f(frame.viewMax.x(), frame.viewMax.y());
+        glTexCoord2f(0.f, 0.f);
+        glVertex2f(frame.viewMin.x(), frame.viewMax.y());
+        glEnd();
+
+        glPopMatrix();
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPopAttrib();
+
+        // the texture becomes the back buffer after the next frame, it has to be read by then
+        glFinish();
+    }
+
+    return ret;
+}
+
+
+void RenderThread::run(void) {
+    m_context->makeCurrent(m_surface);
+    InitializeState();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_stop) {
+        for (std::vector<DisplayManager*>::const_iterator it = m_forgotten.begin(); it != m_forgotten.end(); ++it) {
+            std::map<DisplayManager*, Targets>::iterator targets = m_targets.find(*it);
+
+            if (targets != m_targets.end()) {
+                delete targets->second.front;
+                delete targets->second.back;
+                m_targets.erase(targets);
+            }
+        }
+
+        m_forgotten.clear();
+
+        if (m_pending.empty()) {
+            m_wakeUp.wait(lock);
+            continue;
+        }
+
+        Frame frame = m_pending.front();
+
+        m_pending.erase(m_pending.begin());
+        m_current = frame.view;
+
+        // only this thread changes the back buffers, and Forget() waits for m_current
+        Targets& targets = m_targets[frame.view];
+
+        if ((targets.back == 0) || (targets.back->size() != frame.size)) {
+            delete targets.back;
+            targets.back = new QOpenGLFramebufferObject(frame.size, QOpenGLFramebufferObject::CombinedDepthStencil);
+        }
+
+        lock.unlock();
+        FrameStatistics statistics = Draw(frame, *targets.back);
+        lock.lock();
+
+        std::swap(targets.front, targets.back);
+        targets.frame = frame;
+        m_current     = 0;
+        m_finished.notify_all();
+
+        // the view is told on the GUI thread, the call is dropped if it's gone meanwhile
+        DisplayManager* view = frame.view;
+
+        QMetaObject::invokeMethod(view, [view, statistics]() { view->FrameRendered(statistics); }, Qt::QueuedConnection);
+    }
+
+    for (std::map<DisplayManager*, Targets>::iterator it = m_targets.begin(); it != m_targets.end(); ++it) {
+        delete it->second.front;
+        delete it->second.back;
+    }
+
+    m_targets.clear();
+    lock.unlock();
+
+    m_context->doneCurrent();
+    delete m_context;
+    m_context = 0;
+}
+
+
+FrameStatistics RenderThread::Draw
+(
+    const Frame&              frame,
+    QOpenGLFramebufferObject& target
+) {
+    FrameStatistics ret = frame.statistics;
+    QElapsedTimer   timer;
+
+    timer.start();
+    target.bind();
+
+    glViewport(0, 0, frame.size.width(), frame.size.height());
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(frame.projection.constData());
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glColor4f(0.5f, 0.5f, 0.5f, 1.f);
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(frame.model2Display.constData());
+
+    {
+        std::lock_guard<std::mutex> lock(m_scene->Mutex());
+
+        m_scene->Draw(frame.model2Display, frame.viewMin, frame.viewMax, ret);
+    }
+
+    // the view's context reads the texture next
+    glFinish();
+    target.release();
+
+    ret.frameTime = timer.nsecsElapsed();
+
+    return ret;
+}
@@ -0,0 +1,114 @@
+/*                        R E N D E R T H R E A D . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file RenderThread.h
+ *
+ *  BRL-CAD GUI:
+ *      the render thread class declaration
+ *
+ *  Draws the scene buffers for the display managers off the GUI thread.  It
+ *  has an OpenGL context of its own in the display managers' share group and
+ *  two framebuffer objects per view: one is drawn while the view presents the
+ *  texture of the other one, they are swapped when the frame is done.
+ *
+ *  The display managers post their frames into a queue, a frame which wasn't
+ *  started yet is replaced by a newer one of the same view.  The recording of
+ *  the model stays with the GUI thread, the scene buffers are locked against
+ *  the drawing meanwhile.
+ */
+
+#ifndef RENDERTHREAD_INCLUDED
+#define RENDERTHREAD_INCLUDED
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QSize>
+#include <QThread>
+#include <QVector3D>
+
+#include "FrameStatistics.h"
+#include "SceneBuffers.h"
+
+
+class DisplayManager;
+
+
+class RenderThread : public QThread {
+public:
+    // a view's request, everything the drawing needs to know about it
+    struct Frame {
+        DisplayManager* view;
+        QSize           size;          // in device pixels
+        QMatrix4x4      projection;    // display to normalized device coordinates
+        QMatrix4x4      model2Display;
+        QVector3D       viewMin;       // the view volume in display coordinates
+        QVector3D       viewMax;
+        FrameStatistics statistics;    // the upload before the frame, if there was one
+
+        Frame(void) : view(0), size(), projection(), model2Display(), viewMin(), viewMax(), statistics() {}
+    };
+
+    // needs the GUI thread, the context and the surface are created there
+    RenderThread(std::shared_ptr<SceneBuffers> scene);
+    ~RenderThread(void);
+
+    void Post(const Frame& frame);
+    void Forget(DisplayManager* view); // waits for the view's frame in progress
+
+    // draws the last finished frame of the view in its current projection, needs the view's context
+    bool Present(DisplayManager*   view,
+                 const QMatrix4x4& projection,
+                 const QMatrix4x4& model2Display);
+
+protected:
+    void run(void);
+
+private:
+    struct Targets {
+        QOpenGLFramebufferObject* front; // presented, 0 until the first frame is done
+        QOpenGLFramebufferObject* back;  // drawn
+        Frame                     frame; // the one in front
+
+        Targets(void) : front(0), back(0), frame() {}
+    };
+
+    std::shared_ptr<SceneBuffers>       m_scene;
+    QOffscreenSurface*                  m_surface;
+    QOpenGLContext*                     m_context;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_wakeUp;   // a frame was posted or the thread shall stop
+    std::condition_variable             m_finished; // a frame is done
+    std::vector<Frame>                  m_pending;
+    std::vector<DisplayManager*>        m_forgotten;
+    DisplayManager*                     m_current;  // the view of the frame in progress
+    std::map<DisplayManager*, Targets>  m_targets;
+    bool                                m_stop;
+
+    FrameStatistics Draw(const Frame&              frame,
+                         QOpenGLFramebufferObject& target);
+
+    RenderThread(const RenderThread&);
+    RenderThread& operator=(const RenderThread&);
+};
+
+
+#endif // RENDERTHREAD_INCLUDED
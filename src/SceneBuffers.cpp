@@ -0,0 +1,998 @@
+/*                    S C E N E B U F F E R S . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file SceneBuffers.cpp
+ *
+ *  BRL-CAD GUI:
+ *      the uploaded geometry buffers implementation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "DisplayManager.h"
+#include "Parallel.h"
+#include "SceneBuffers.h"
+
+
+const GLsizei ChunkSize = 2048;  // primitives per chunk
+const GLsizei BlockSize = 65532; // vertices per buffer object, a multiple of 2 and 3: a full block ends with a complete line or triangle
+
+const size_t StagingBudget = 4 * BlockSize * 6; // floats in all batches' staging blocks
+const size_t NoGroups      = static_cast<size_t>(-1); // a refinement which doesn't match the scene
+const float  NestedLevels  = -1.f;                    // the tolerance of the batch of a group's nested levels
+const float   MaxFloat  = std::numeric_limits<float>::max();
+
+const float MaxPixelError    = 0.5f; // the allowed deviation of a detail level in pixels
+const float RefinementMargin = 4.f;  // the recorded detail allows zooming in this far before a refinement
+
+// the material of DisplayManager::SetColor(): the diffuse part is 0.8 of the colour, the ambient one 0.2
+// the vertex colour is the diffuse part, a quarter of OpenGL's default ambient light makes up for the ambient one
+const float DiffuseFactor         = 0.8f;
+const float AmbientLight[]        = {0.05f, 0.05f, 0.05f, 1.f};
+const float DefaultAmbientLight[] = {0.2f, 0.2f, 0.2f, 1.f};
+
+
+static GLsizei VerticesPerPrimitive
+(
+    GLenum mode
+) {
+    GLsizei ret = 1;
+
+    if (mode == GL_LINES)
+        ret = 2;
+    else if (mode == GL_TRIANGLES)
+        ret = 3;
+
+    return ret;
+}
+
+
+// the colour is the last one
+static GLsizei FloatsPerVertex
+(
+    GLenum mode
+) {
+    GLsizei ret = 4;
+
+    if (mode == GL_TRIANGLES)
+        ret = 7;
+
+    return ret;
+}
+
+
+// the four bytes of the diffuse colour in the place of a float, for glColorPointer(4, GL_UNSIGNED_BYTE, ...)
+// the vertices are only copied around, i.e. the bits stay as they are
+static float PackedColor
+(
+    const QColor& color
+) {
+    unsigned char rgba[] = {static_cast<unsigned char>(color.red() * DiffuseFactor + 0.5f),
+                            static_cast<unsigned char>(color.green() * DiffuseFactor + 0.5f),
+                            static_cast<unsigned char>(color.blue() * DiffuseFactor + 0.5f),
+                            static_cast<unsigned char>(color.alpha())};
+    float         ret;
+
+    memcpy(&ret, rgba, sizeof(ret));
+
+    return ret;
+}
+
+
+// interleaves the bits of the three 10 bit coordinates
+static unsigned int MortonCode
+(
+    const QVector3D& point,
+    const QVector3D& minCorner,
+    const QVector3D& size
+) {
+    unsigned int ret = 0;
+    unsigned int cell[3];
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float relative = 0.f;
+
+        if (size[axis] > 0.f)
+            relative = (point[axis] - minCorner[axis]) / size[axis];
+
+        cell[axis] = static_cast<unsigned int>(std::min(std::max(relative * 1023.f, 0.f), 1023.f));
+    }
+
+    for (unsigned int bit = 0; bit < 10; ++bit) {
+        for (int axis = 0; axis < 3; ++axis)
+            ret |= ((cell[axis] >> bit) & 1u) << (3 * bit + axis);
+    }
+
+    return ret;
+}
+
+
+// does the box, transformed by an affine trafo, overlap the view volume?
+static bool Visible
+(
+    const QVector3D&  minCorner,
+    const QVector3D&  maxCorner,
+    const QMatrix4x4& trafo,
+    const QVector3D&  viewMin,
+    const QVector3D&  viewMax
+) {
+    QVector3D center = trafo.map((minCorner + maxCorner) / 2.f);
+    QVector3D extent = (maxCorner - minCorner) / 2.f;
+
+    for (int row = 0; row < 3; ++row) {
+        float radius = fabs(trafo(row, 0)) * extent.x() + fabs(trafo(row, 1)) * extent.y() + fabs(trafo(row, 2)) * extent.z();
+
+        if ((center[row] + radius < viewMin[row]) || (center[row] - radius > viewMax[row]))
+            return false;
+    }
+
+    return true;
+}
+
+
+SceneRecording::SceneRecording(void)
+    : m_batches(), m_batchIndices(), m_currentGroup(0), m_currentTolerance(0.f), m_groupTolerances(), m_groupCounts() {}
+
+
+void SceneRecording::AddPoint
+(
+    const QVector3D& point,
+    const QColor&    color
+) {
+    std::vector<float>& vertices = Vertices(GL_POINTS);
+
+    vertices.push_back(point.x());
+    vertices.push_back(point.y());
+    vertices.push_back(point.z());
+    vertices.push_back(PackedColor(color));
+}
+
+
+void SceneRecording::AddPoints
+(
+    const QVector3D* points,
+    size_t           count,
+    const QColor&    color
+) {
+    std::vector<float>& vertices    = Vertices(GL_POINTS);
+    float               packedColor = PackedColor(color);
+
+    vertices.reserve(vertices.size() + 4 * count);
+
+    for (size_t i = 0; i < count; ++i) {
+        vertices.push_back(points[i].x());
+        vertices.push_back(points[i].y());
+        vertices.push_back(points[i].z());
+        vertices.push_back(packedColor);
+    }
+}
+
+
+void SceneRecording::AddLine
+(
+    const QVector3D& start,
+    const QVector3D& end,
+    const QColor&    color
+) {
+    std::vector<float>& vertices    = Vertices(GL_LINES);
+    float               packedColor = PackedColor(color);
+    const float         line[]      = {start.x(), start.y(), start.z(), packedColor,
+                                       end.x(),   end.y(),   end.z(),   packedColor};
+
+    vertices.insert(vertices.end(), line, line + 8);
+}
+
+
+void SceneRecording::AddTriangle
+(
+    const QVector3D& a,
+    const QVector3D& b,
+    const QVector3D& c,
+    const QVector3D& normal,
+    const QColor&    color
+) {
+    std::vector<float>& vertices    = Vertices(GL_TRIANGLES);
+    float               packedColor = PackedColor(color);
+    const float         triangle[]  = {a.x(), a.y(), a.z(), normal.x(), normal.y(), normal.z(), packedColor,
+                                       b.x(), b.y(), b.z(), normal.x(), normal.y(), normal.z(), packedColor,
+                                       c.x(), c.y(), c.z(), normal.x(), normal.y(), normal.z(), packedColor};
+
+    vertices.insert(vertices.end(), triangle, triangle + 21);
+}
+
+
+void SceneRecording::BeginDetailGroup(void) {
+    m_groupTolerances.push_back(std::vector<float>());
+    m_groupCounts.push_back(std::vector<size_t>());
+    m_currentGroup     = m_groupTolerances.size();
+    m_currentTolerance = 0.f;
+}
+
+
+void SceneRecording::DetailLevel
+(
+    float tolerance
+) {
+    if (m_currentGroup > 0) {
+        m_currentTolerance = tolerance;
+        m_groupTolerances[m_currentGroup - 1].push_back(tolerance);
+    }
+}
+
+
+void SceneRecording::EndDetailGroup(void) {
+    m_currentGroup     = 0;
+    m_currentTolerance = 0.f;
+}
+
+
+// the points of the finest level are recorded in their order, the coarser levels are their first ones
+void SceneRecording::AddNestedPoints
+(
+    const QVector3D*           points,
+    const std::vector<float>&  tolerances,
+    const std::vector<size_t>& counts,
+    const QColor&              color
+) {
+    BeginDetailGroup();
+    m_groupTolerances.back() = tolerances;
+    m_groupCounts.back()     = counts;
+    m_currentTolerance       = NestedLevels;
+
+    if (!counts.empty())
+        AddPoints(points, *std::max_element(counts.begin(), counts.end()), color);
+
+    EndDetailGroup();
+}
+
+
+size_t SceneRecording::Bytes(void) const {
+    size_t ret = 0;
+
+    for (std::vector<Batch>::const_iterator it = m_batches.begin(); it != m_batches.end(); ++it)
+        ret += it->vertices.capacity() * sizeof(float);
+
+    return ret;
+}
+
+
+std::vector<float>& SceneRecording::Vertices
+(
+    GLenum mode
+) {
+    BatchKey                                   key(mode, m_currentGroup, m_currentTolerance);
+    std::map<BatchKey, size_t>::const_iterator batchIndex = m_batchIndices.find(key);
+
+    if (batchIndex != m_batchIndices.end())
+        return m_batches[batchIndex->second].vertices;
+
+    Batch batch;
+
+    batch.mode      = mode;
+    batch.group     = m_currentGroup;
+    batch.tolerance = m_currentTolerance;
+
+    m_batches.push_back(batch);
+    m_batchIndices[key] = m_batches.size() - 1;
+
+    return m_batches.back().vertices;
+}
+
+
+SceneBuffers::SceneBuffers(void)
+    : m_views(), m_batches(), m_batchIndices(), m_valid(false), m_generation(0), m_groupTolerances(), m_groupCounts(), m_geometryGroups(), m_mutex(),
+      m_stagedFloats(0), m_pendingBlocks(), m_uploadedFloats(0), m_copiedFloats(0), m_peakStagingBytes(0),
+      m_recordingBytes(0) {}
+
+
+SceneBuffers::~SceneBuffers(void) {
+    Release();
+}
+
+
+void SceneBuffers::Attach
+(
+    DisplayManager* displayManager
+) {
+    m_views.push_back(displayManager);
+}
+
+
+void SceneBuffers::Detach
+(
+    DisplayManager* displayManager
+) {
+    m_views.erase(std::remove(m_views.begin(), m_views.end(), displayManager), m_views.end());
+
+    // the buffers have to go with the last context of the share group
+    bool contextLeft = false;
+
+    for (std::vector<DisplayManager*>::const_iterator it = m_views.begin(); it != m_views.end(); ++it) {
+        if ((*it)->context() != 0) {
+            contextLeft = true;
+            break;
+        }
+    }
+
+    if (!contextLeft)
+        Release();
+}
+
+
+void SceneBuffers::UpdateViews(void) {
+    for (std::vector<DisplayManager*>::const_iterator it = m_views.begin(); it != m_views.end(); ++it)
+        (*it)->update();
+}
+
+
+float SceneBuffers::DetailTolerance(void) const {
+    float ret = MaxFloat;
+
+    for (std::vector<DisplayManager*>::const_iterator it = m_views.begin(); it != m_views.end(); ++it) {
+        if ((*it)->isVisible())
+            ret = std::min(ret, (*it)->ViewTolerance() / RefinementMargin);
+    }
+
+    // no view to go by
+    if (ret == MaxFloat)
+        ret = 0.f;
+
+    return ret;
+}
+
+
+float SceneBuffers::PixelTolerance
+(
+    const QMatrix4x4& model2Display
+) {
+    // the size of a model unit on the display, the largest one of the three axes
+    float pixelsPerUnit = 0.f;
+
+    for (int column = 0; column < 3; ++column)
+        pixelsPerUnit = std::max(pixelsPerUnit, sqrtf(model2Display(0, column) * model2Display(0, column) + model2Display(1, column) * model2Display(1, column)));
+
+    return (pixelsPerUnit > 0.f) ? MaxPixelError / pixelsPerUnit : MaxFloat;
+}
+
+
+void SceneBuffers::Invalidate(void) {
+    m_valid = false;
+}
+
+
+bool SceneBuffers::Valid(void) const {
+    return m_valid;
+}
+
+
+size_t SceneBuffers::Generation(void) const {
+    return m_generation;
+}
+
+
+void SceneBuffers::Clear(void) {
+    Release();
+    m_batches.clear();
+    m_groupTolerances.clear();
+    m_groupCounts.clear();
+    m_geometryGroups.clear();
+    m_batchIndices.clear();
+    m_stagedFloats     = 0;
+    m_pendingBlocks.clear();
+    m_uploadedFloats   = 0;
+    m_copiedFloats     = 0;
+    m_peakStagingBytes = 0;
+}
+
+
+// the detail groups of the recording come after the ones there are
+void SceneBuffers::Merge
+(
+    SceneRecording& recording,
+    const Geometry* geometry
+) {
+    size_t firstGroup = m_groupTolerances.size();
+
+    if (recording.m_groupTolerances.size() > 0) {
+        std::map<const Geometry*, GroupRange>::iterator groups = m_geometryGroups.find(geometry);
+
+        // the next part of the geometry
+        if ((groups != m_geometryGroups.end()) && (groups->second.first + groups->second.second == firstGroup))
+            groups->second.second += recording.m_groupTolerances.size();
+        else
+            m_geometryGroups[geometry] = std::make_pair(firstGroup, recording.m_groupTolerances.size());
+    }
+
+    m_groupTolerances.insert(m_groupTolerances.end(), recording.m_groupTolerances.begin(), recording.m_groupTolerances.end());
+    m_groupCounts.insert(m_groupCounts.end(), recording.m_groupCounts.begin(), recording.m_groupCounts.end());
+    MergeBatches(recording, firstGroup);
+}
+
+
+void SceneBuffers::Merge
+(
+    std::vector<SceneRecording>&        recordings,
+    const std::vector<const Geometry*>& geometries
+) {
+    m_recordingBytes = 0;
+
+    for (std::vector<SceneRecording>::const_iterator it = recordings.begin(); it != recordings.end(); ++it)
+        m_recordingBytes += it->Bytes();
+
+    m_peakStagingBytes = std::max(m_peakStagingBytes, m_stagedFloats * sizeof(float) + m_recordingBytes);
+
+    for (size_t i = 0; (i < recordings.size()) && (i < geometries.size()); ++i) {
+        size_t bytes = recordings[i].Bytes();
+
+        Merge(recordings[i], geometries[i]);
+        m_recordingBytes -= bytes;
+    }
+
+    m_recordingBytes = 0;
+}
+
+
+std::vector<const Geometry*> SceneBuffers::CoarseGeometries(void) const {
+    std::vector<const Geometry*> ret;
+    float                        pixelTolerance = MaxFloat;
+
+    for (std::vector<DisplayManager*>::const_iterator it = m_views.begin(); it != m_views.end(); ++it) {
+        if ((*it)->isVisible())
+            pixelTolerance = std::min(pixelTolerance, (*it)->ViewTolerance());
+    }
+
+    if (pixelTolerance == MaxFloat)
+        return ret;
+
+    for (std::map<const Geometry*, GroupRange>::const_iterator it = m_geometryGroups.begin(); it != m_geometryGroups.end(); ++it) {
+        for (size_t group = it->second.first; group < it->second.first + it->second.second; ++group) {
+            const std::vector<float>& tolerances = m_groupTolerances[group];
+
+            if (!tolerances.empty() && (*std::min_element(tolerances.begin(), tolerances.end()) > pixelTolerance)) {
+                ret.push_back(it->first);
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+// the geometries keep their group numbers, the batches of the replaced levels go
+void SceneBuffers::Refine
+(
+    const std::vector<const Geometry*>& geometries,
+    std::vector<SceneRecording>&       recordings,
+    FrameStatistics&                   statistics
+) {
+    m_uploadedFloats   = 0;
+    m_copiedFloats     = 0;
+    m_peakStagingBytes = 0;
+    m_recordingBytes   = 0;
+
+    for (std::vector<SceneRecording>::const_iterator it = recordings.begin(); it != recordings.end(); ++it)
+        m_recordingBytes += it->Bytes();
+
+    m_peakStagingBytes = m_recordingBytes;
+
+    std::vector<bool>   replaced(m_groupTolerances.size() + 1, false); // by the batches' group numbers
+    std::vector<size_t> firstGroups(recordings.size(), NoGroups);
+
+    for (size_t i = 0; (i < geometries.size()) && (i < recordings.size()); ++i) {
+        std::map<const Geometry*, GroupRange>::const_iterator groups = m_geometryGroups.find(geometries[i]);
+
+        // the geometry has to come with the same groups, e.g. the nodes of a point cloud
+        if ((groups == m_geometryGroups.end()) || (groups->second.second != recordings[i].m_groupTolerances.size()))
+            continue;
+
+        firstGroups[i] = groups->second.first;
+        std::fill(replaced.begin() + groups->second.first + 1, replaced.begin() + groups->second.first + groups->second.second + 1, true);
+    }
+
+    // the indices of the remaining batches change, nothing else holds them now:
+    // the last upload has packed all pending blocks
+    size_t keptBatches = 0;
+
+    m_batchIndices.clear();
+
+    for (size_t i = 0; i < m_batches.size(); ++i) {
+        Batch& batch = m_batches[i];
+
+        if (replaced[batch.group]) {
+            for (std::vector<Block>::iterator block = batch.blocks.begin(); block != batch.blocks.end(); ++block)
+                block->buffer.destroy();
+        }
+        else {
+            if (keptBatches != i)
+                std::swap(m_batches[keptBatches], batch);
+
+            m_batchIndices[BatchKey(m_batches[keptBatches].mode, m_batches[keptBatches].group, m_batches[keptBatches].tolerance)] = keptBatches;
+            ++keptBatches;
+        }
+    }
+
+    m_batches.erase(m_batches.begin() + keptBatches, m_batches.end());
+
+    for (size_t i = 0; i < recordings.size(); ++i) {
+        SceneRecording& recording = recordings[i];
+        size_t          bytes     = recording.Bytes();
+
+        if (firstGroups[i] == NoGroups)
+            continue;
+
+        std::copy(recording.m_groupTolerances.begin(), recording.m_groupTolerances.end(), m_groupTolerances.begin() + firstGroups[i]);
+        std::copy(recording.m_groupCounts.begin(), recording.m_groupCounts.end(), m_groupCounts.begin() + firstGroups[i]);
+
+        // the primitives outside of the detail groups are in the scene already
+        recording.m_batches.erase(std::remove_if(recording.m_batches.begin(), recording.m_batches.end(), [](const SceneRecording::Batch& batch) {
+                                      return batch.group == 0;
+                                  }),
+                                  recording.m_batches.end());
+
+        MergeBatches(recording, firstGroups[i]);
+        m_recordingBytes -= bytes;
+    }
+
+    m_recordingBytes = 0;
+    UploadStaging(statistics);
+}
+
+
+void SceneBuffers::ReplaceOwners
+(
+    const std::vector<GeometryModel::Replacement>& replacements
+) {
+    for (std::vector<GeometryModel::Replacement>::const_iterator it = replacements.begin(); it != replacements.end(); ++it) {
+        std::map<const Geometry*, GroupRange>::iterator groups = m_geometryGroups.find(it->first);
+
+        if (groups != m_geometryGroups.end()) {
+            GroupRange range = groups->second;
+
+            m_geometryGroups.erase(groups);
+            m_geometryGroups[it->second] = range;
+        }
+    }
+}
+
+
+void SceneBuffers::Upload
+(
+    FrameStatistics& statistics
+) {
+    UploadStaging(statistics);
+    m_valid = true;
+}
+
+
+void SceneBuffers::Draw
+(
+    const QMatrix4x4& model2Display,
+    const QVector3D&  viewMin,
+    const QVector3D&  viewMax,
+    FrameStatistics&  statistics
+) {
+    float pixelTolerance = PixelTolerance(model2Display);
+
+    // every detail group draws its coarsest level with an error below MaxPixelError,
+    // a group recorded for a coarser view draws its finest level until it's refined
+    std::vector<float> selectedTolerances(m_groupTolerances.size(), 0.f);
+    std::vector<GLint> selectedCounts(m_groupTolerances.size(), 0); // of the nested levels
+
+    for (size_t group = 0; group < m_groupTolerances.size(); ++group) {
+        const std::vector<float>& tolerances = m_groupTolerances[group];
+        bool                      sufficient = false;
+        size_t                    selected   = 0;
+        size_t                    finest     = 0;
+
+        for (size_t level = 0; level < tolerances.size(); ++level) {
+            if (tolerances[level] < tolerances[finest])
+                finest = level;
+
+            if ((tolerances[level] <= pixelTolerance) && (!sufficient || (tolerances[level] > tolerances[selected]))) {
+                selected   = level;
+                sufficient = true;
+            }
+        }
+
+        if (!tolerances.empty()) {
+            if (!sufficient) {
+                selected = finest;
+                ++statistics.coarseGroups;
+            }
+
+            selectedTolerances[group] = tolerances[selected];
+
+            if (selected < m_groupCounts[group].size())
+                selectedCounts[group] = static_cast<GLint>(m_groupCounts[group][selected]);
+        }
+    }
+
+    // the vertex colours are the material, for all batches
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, AmbientLight);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glNormal3f(0.f, 0.f, 1.f);
+
+    for (std::vector<Batch>::iterator it = m_batches.begin(); it != m_batches.end(); ++it) {
+        if (it->blocks.empty() || ((it->group > 0) && !it->ordered && (it->tolerance != selectedTolerances[it->group - 1])))
+            continue;
+
+        // nested levels: the first vertices of the batch
+        GLint   levelCount = it->ordered ? selectedCounts[it->group - 1] : std::numeric_limits<GLint>::max();
+        GLsizei stride     = FloatsPerVertex(it->mode) * sizeof(float);
+
+        ++statistics.drawnBatches;
+
+        if (it->mode == GL_TRIANGLES)
+            glEnableClientState(GL_NORMAL_ARRAY);
+
+        for (std::vector<Block>::iterator block = it->blocks.begin(); block != it->blocks.end(); ++block) {
+            GLint blockCount = std::min<GLint>(block->count, levelCount - block->first);
+
+            if ((blockCount <= 0) || !block->buffer.isCreated() || !block->buffer.bind())
+                continue;
+
+            glVertexPointer(3, GL_FLOAT, stride, 0);
+            glColorPointer(4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<const void*>(stride - sizeof(float)));
+
+            if (it->mode == GL_TRIANGLES)
+                glNormalPointer(GL_FLOAT, stride, reinterpret_cast<const void*>(3 * sizeof(float)));
+
+            // neighboring visible chunks go into one draw call
+            GLint   rangeFirst = 0;
+            GLsizei rangeCount = 0;
+
+            for (std::vector<Chunk>::const_iterator chunk = block->chunks.begin(); (chunk != block->chunks.end()) && (chunk->first < blockCount); ++chunk) {
+                GLsizei chunkCount = std::min<GLsizei>(chunk->count, blockCount - chunk->first);
+
+                if (Visible(chunk->minCorner, chunk->maxCorner, model2Display, viewMin, viewMax)) {
+                    if ((rangeCount > 0) && (rangeFirst + rangeCount == chunk->first))
+                        rangeCount += chunkCount;
+                    else {
+                        if (rangeCount > 0) {
+                            glDrawArrays(it->mode, rangeFirst, rangeCount);
+                            ++statistics.drawCalls;
+                            statistics.drawnVertices += rangeCount;
+                        }
+
+                        rangeFirst = chunk->first;
+                        rangeCount = chunkCount;
+                    }
+
+                    ++statistics.drawnChunks;
+                }
+                else
+                    ++statistics.culledChunks;
+            }
+
+            if (rangeCount > 0) {
+                glDrawArrays(it->mode, rangeFirst, rangeCount);
+                ++statistics.drawCalls;
+                statistics.drawnVertices += rangeCount;
+            }
+
+            block->buffer.release();
+        }
+
+        if (it->mode == GL_TRIANGLES) {
+            glDisableClientState(GL_NORMAL_ARRAY);
+            glNormal3f(0.f, 0.f, 1.f);
+        }
+    }
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, DefaultAmbientLight);
+    glDisable(GL_COLOR_MATERIAL);
+}
+
+
+void SceneBuffers::Release(void) {
+    for (std::vector<Batch>::iterator it = m_batches.begin(); it != m_batches.end(); ++it) {
+        for (std::vector<Block>::iterator block = it->blocks.begin(); block != it->blocks.end(); ++block)
+            block->buffer.destroy();
+    }
+
+    m_valid = false;
+}
+
+
+size_t SceneBuffers::GpuBytes(void) const {
+    size_t ret = 0;
+
+    for (std::vector<Batch>::const_iterator it = m_batches.begin(); it != m_batches.end(); ++it) {
+        for (std::vector<Block>::const_iterator block = it->blocks.begin(); block != it->blocks.end(); ++block)
+            ret += static_cast<size_t>(block->count) * FloatsPerVertex(it->mode) * sizeof(GLfloat);
+    }
+
+    return ret;
+}
+
+
+std::mutex& SceneBuffers::Mutex(void) {
+    return m_mutex;
+}
+
+
+size_t SceneBuffers::BatchIndex
+(
+    GLenum mode,
+    size_t group,
+    float  tolerance
+) {
+    size_t                                     ret        = 0;
+    BatchKey                                   key(mode, group, tolerance);
+    std::map<BatchKey, size_t>::const_iterator batchIndex = m_batchIndices.find(key);
+
+    if (batchIndex != m_batchIndices.end())
+        ret = batchIndex->second;
+    else {
+        Batch batch;
+
+        batch.mode      = mode;
+        batch.group     = group;
+        batch.tolerance = tolerance;
+        batch.ordered   = (tolerance == NestedLevels);
+        batch.flushed   = 0;
+
+        m_batches.push_back(batch);
+        ret                 = m_batches.size() - 1;
+        m_batchIndices[key] = ret;
+    }
+
+    return ret;
+}
+
+
+// appends whole primitives to the staging block of a batch, a full block goes to the packing
+void SceneBuffers::AddVertices
+(
+    size_t       batchIndex,
+    const float* vertices,
+    size_t       count
+) {
+    size_t blockFloats = static_cast<size_t>(BlockSize * FloatsPerVertex(m_batches[batchIndex].mode));
+
+    while (count > 0) {
+        std::vector<float>& staging = m_batches[batchIndex].staging;
+        size_t              part    = std::min(count, blockFloats - staging.size());
+
+        staging.insert(staging.end(), vertices, vertices + part);
+
+        vertices       += part;
+        count          -= part;
+        m_stagedFloats += part;
+        m_copiedFloats += part;
+
+        if (staging.size() >= blockFloats)
+            FlushBlock(batchIndex);
+        else if (m_stagedFloats > StagingBudget)
+            FlushBlocks();
+    }
+}
+
+
+// hands the staged vertices of a batch over to the packing
+void SceneBuffers::MergeBatches
+(
+    SceneRecording& recording,
+    size_t          firstGroup
+) {
+    for (std::vector<SceneRecording::Batch>::iterator it = recording.m_batches.begin(); it != recording.m_batches.end(); ++it) {
+        size_t group = (it->group > 0) ? firstGroup + it->group : 0;
+
+        m_copiedFloats += it->vertices.size(); // written by the recording
+        AddVertices(BatchIndex(it->mode, group, it->tolerance), it->vertices.data(), it->vertices.size());
+        std::vector<float>().swap(it->vertices);
+    }
+
+    recording.m_batches.clear();
+    recording.m_batchIndices.clear();
+    recording.m_groupTolerances.clear();
+    recording.m_groupCounts.clear();
+}
+
+
+void SceneBuffers::UploadStaging
+(
+    FrameStatistics& statistics
+) {
+    FlushBlocks();
+    PackPendingBlocks();
+
+    for (std::vector<Batch>::iterator it = m_batches.begin(); it != m_batches.end(); ++it)
+        std::vector<float>().swap(it->staging);
+
+    statistics.uploadedFloats   = m_uploadedFloats;
+    statistics.copiedFloats     = m_copiedFloats;
+    statistics.peakStagingBytes = m_peakStagingBytes;
+
+    ++m_generation;
+}
+
+
+void SceneBuffers::FlushBlock
+(
+    size_t batchIndex
+) {
+    Batch&              batch   = m_batches[batchIndex];
+    std::vector<float>& staging = batch.staging;
+
+    if (staging.empty())
+        return;
+
+    m_peakStagingBytes = std::max(m_peakStagingBytes, m_stagedFloats * sizeof(float) + m_recordingBytes);
+    m_stagedFloats    -= staging.size();
+
+    PendingBlock pendingBlock;
+
+    pendingBlock.batch       = batchIndex;
+    pendingBlock.target      = 0;
+    pendingBlock.block.first = batch.flushed;
+    batch.flushed           += static_cast<GLint>(staging.size() / FloatsPerVertex(batch.mode));
+    pendingBlock.vertices.swap(staging);
+
+    m_pendingBlocks.push_back(pendingBlock);
+
+    // one block per worker thread
+    if (m_pendingBlocks.size() >= WorkerCount())
+        PackPendingBlocks();
+}
+
+
+void SceneBuffers::FlushBlocks(void) {
+    for (size_t i = 0; i < m_batches.size(); ++i)
+        FlushBlock(i);
+}
+
+
+// the buffer objects are handled in the OpenGL thread, the packing itself runs in parallel
+void SceneBuffers::PackPendingBlocks(void) {
+    if (m_pendingBlocks.empty())
+        return;
+
+    size_t stagingBytes = m_stagedFloats * sizeof(float) + m_recordingBytes;
+
+    for (std::vector<PendingBlock>::iterator it = m_pendingBlocks.begin(); it != m_pendingBlocks.end(); ++it) {
+        stagingBytes += it->vertices.size() * sizeof(float);
+
+        if (it->block.buffer.create() && it->block.buffer.bind()) {
+            it->block.buffer.allocate(static_cast<int>(it->vertices.size() * sizeof(float)));
+            it->target = static_cast<float*>(it->block.buffer.map(QOpenGLBuffer::WriteOnly));
+            it->block.buffer.release();
+        }
+    }
+
+    m_peakStagingBytes = std::max(m_peakStagingBytes, stagingBytes);
+
+    ParallelFor(m_pendingBlocks.size(), [this](size_t i) {
+        PackBlock(m_pendingBlocks[i]);
+    });
+
+    for (std::vector<PendingBlock>::iterator it = m_pendingBlocks.begin(); it != m_pendingBlocks.end(); ++it) {
+        if (it->block.buffer.isCreated() && it->block.buffer.bind()) {
+            if (it->target != 0)
+                it->block.buffer.unmap();
+            else {
+                // no buffer mapping available, PackBlock() has sorted the vertices in place
+                it->block.buffer.write(0, it->vertices.data(), static_cast<int>(it->vertices.size() * sizeof(float)));
+                m_copiedFloats += it->vertices.size();
+            }
+
+            it->block.buffer.release();
+
+            m_copiedFloats   += it->vertices.size();
+            m_uploadedFloats += it->vertices.size();
+
+            m_batches[it->batch].blocks.push_back(it->block);
+        }
+    }
+
+    m_pendingBlocks.clear();
+}
+
+
+// sorts the primitives of a block into chunks, and writes them into the mapped buffer
+void SceneBuffers::PackBlock
+(
+    PendingBlock& pendingBlock
+) const {
+    const Batch&              batch           = m_batches[pendingBlock.batch];
+    const std::vector<float>& vertices        = pendingBlock.vertices;
+    Block&                    block           = pendingBlock.block;
+    GLsizei                   vertexCount     = VerticesPerPrimitive(batch.mode);
+    GLsizei                   floatCount      = FloatsPerVertex(batch.mode);
+    GLsizei                   primitiveFloats = vertexCount * floatCount;
+    size_t                    primitiveCount  = vertices.size() / primitiveFloats;
+
+    // sort the primitives along a space filling curve, this way consecutive ones are close to each other
+    // the vertices of nested levels keep their order
+    std::vector<QVector3D> centroids(primitiveCount);
+    QVector3D              minCorner(MaxFloat, MaxFloat, MaxFloat);
+    QVector3D              maxCorner(-MaxFloat, -MaxFloat, -MaxFloat);
+
+    for (size_t i = 0; i < primitiveCount; ++i) {
+        const float* primitive = vertices.data() + i * primitiveFloats;
+        QVector3D    centroid;
+
+        for (GLsizei vertex = 0; vertex < vertexCount; ++vertex)
+            centroid += QVector3D(primitive[vertex * floatCount], primitive[vertex * floatCount + 1], primitive[vertex * floatCount + 2]);
+
+        centroids[i] = centroid / static_cast<float>(vertexCount);
+
+        for (int axis = 0; axis < 3; ++axis) {
+            minCorner[axis] = std::min(minCorner[axis], centroids[i][axis]);
+            maxCorner[axis] = std::max(maxCorner[axis], centroids[i][axis]);
+        }
+    }
+
+    std::vector<std::pair<unsigned int, unsigned int> > order(primitiveCount);
+    QVector3D                                          size = maxCorner - minCorner;
+
+    for (size_t i = 0; i < primitiveCount; ++i)
+        order[i] = std::make_pair(batch.ordered ? 0u : MortonCode(centroids[i], minCorner, size), static_cast<unsigned int>(i));
+
+    if (!batch.ordered)
+        std::sort(order.begin(), order.end());
+
+    block.count = static_cast<GLsizei>(primitiveCount * vertexCount);
+    block.chunks.clear();
+
+    for (size_t i = 0; i < primitiveCount; ++i) {
+        const float* primitive = vertices.data() + order[i].second * primitiveFloats;
+
+        if ((i % ChunkSize) == 0) {
+            Chunk chunk = {QVector3D(MaxFloat, MaxFloat, MaxFloat), QVector3D(-MaxFloat, -MaxFloat, -MaxFloat), static_cast<GLint>(i * vertexCount), 0};
+
+            block.chunks.push_back(chunk);
+        }
+
+        Chunk& chunk = block.chunks.back();
+
+        for (GLsizei vertex = 0; vertex < vertexCount; ++vertex) {
+            for (int axis = 0; axis < 3; ++axis) {
+                chunk.minCorner[axis] = std::min(chunk.minCorner[axis], primitive[vertex * floatCount + axis]);
+                chunk.maxCorner[axis] = std::max(chunk.maxCorner[axis], primitive[vertex * floatCount + axis]);
+            }
+        }
+
+        chunk.count += vertexCount;
+    }
+
+    // the sorted primitives go straight into the mapped buffer, there is no sorted copy in between
+    if (pendingBlock.target != 0) {
+        for (size_t i = 0; i < primitiveCount; ++i) {
+            const float* primitive = vertices.data() + order[i].second * primitiveFloats;
+
+            std::copy(primitive, primitive + primitiveFloats, pendingBlock.target + i * primitiveFloats);
+        }
+    }
+    else {
+        std::vector<float> sorted;
+        sorted.reserve(vertices.size());
+
+        for (size_t i = 0; i < primitiveCount; ++i) {
+            const float* primitive = vertices.data() + order[i].second * primitiveFloats;
+
+            sorted.insert(sorted.end(), primitive, primitive + primitiveFloats);
+        }
+
+        pendingBlock.vertices.swap(sorted);
+    }
+}
@@ -0,0 +1,257 @@
+/*                      S C E N E B U F F E R S . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file SceneBuffers.h
+ *
+ *  BRL-CAD GUI:
+ *      the uploaded geometry buffers declaration
+ *
+ *  The vertices of the geometry model in model coordinates, held in OpenGL
+ *  buffer objects.  All display managers of a window share one OpenGL
+ *  context group and one instance of this class, every one of them draws
+ *  it with its own transformation.
+ *
+ *  The primitives are sorted into batches by their mode and detail level.
+ *  The colour is a part of every vertex and goes to the ambient and diffuse
+ *  material with GL_COLOR_MATERIAL, i.e. the objects of all colours share
+ *  their batches and a frame doesn't change the material between them.
+ *
+ *  The geometries are recorded on the worker threads, every part of a
+ *  geometry into its own SceneRecording, and merged into the staging blocks
+ *  on the OpenGL thread in their order.
+ *
+ *  The vertices are collected in staging blocks of a fixed size.  The full
+ *  blocks are sorted into spatial chunks and written directly into mapped
+ *  buffer objects by the worker threads, this way the memory needed does not
+ *  grow with the model.
+ *
+ *  Geometry can come in detail groups: the same object with several
+ *  tolerances, where every view draws the coarsest level whose error stays
+ *  below a pixel.  The levels finer than the visible views need may be left
+ *  out of the recording, a view zoomed in beyond them draws the finest level
+ *  there is and counts the group in its statistics as waiting for a
+ *  refinement.  A refinement records only the geometries owning such groups
+ *  again and replaces the batches of their groups, the old ones are
+ *  removed.
+ *
+ *  The levels of a group may be nested, where every level is the first
+ *  vertices of the finer one, like the levels of a point cloud's node.  The
+ *  finest level is recorded once, in its order, and a view draws the first
+ *  vertices of the level it selects.
+ */
+
+#ifndef SCENEBUFFERS_INCLUDED
+#define SCENEBUFFERS_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QVector3D>
+
+#include "FrameStatistics.h"
+#include "GeometryModel.h"
+
+
+class DisplayManager;
+
+
+// the primitives of one geometry, collected on a worker thread
+// the detail groups are numbered within the recording, SceneBuffers::Merge() takes them into the scene's
+class SceneRecording {
+public:
+    SceneRecording(void);
+
+    void AddPoint(const QVector3D& point,
+                  const QColor&    color);
+    void AddPoints(const QVector3D* points,
+                   size_t           count,
+                   const QColor&    color);
+    void AddLine(const QVector3D& start,
+                 const QVector3D& end,
+                 const QColor&    color);
+    void AddTriangle(const QVector3D& a,
+                     const QVector3D& b,
+                     const QVector3D& c,
+                     const QVector3D& normal,
+                     const QColor&    color);
+
+    // the following primitives are alternative representations of one object
+    void BeginDetailGroup(void);
+    void DetailLevel(float tolerance); // in model units, 0 is the exact geometry
+    void EndDetailGroup(void);
+
+    // a detail group of its own, the first counts[i] points are the level of tolerances[i]
+    void AddNestedPoints(const QVector3D*           points,
+                         const std::vector<float>&  tolerances,
+                         const std::vector<size_t>& counts,
+                         const QColor&              color);
+
+    size_t Bytes(void) const; // the memory held by the vertices
+
+private:
+    struct Batch {
+        GLenum             mode;
+        size_t             group;     // 0 if not in a detail group
+        float              tolerance;
+        std::vector<float> vertices;  // x, y, z (the normal for triangles), the colour
+    };
+
+    typedef std::tuple<GLenum, size_t, float> BatchKey;
+
+    std::vector<Batch>                m_batches;
+    std::map<BatchKey, size_t>        m_batchIndices;
+    size_t                            m_currentGroup;
+    float                             m_currentTolerance;
+    std::vector<std::vector<float> >  m_groupTolerances; // the levels of the groups 1, 2, ...
+    std::vector<std::vector<size_t> > m_groupCounts;     // the vertices of the nested levels, empty for the other groups
+
+    std::vector<float>& Vertices(GLenum mode);
+
+    friend class SceneBuffers;
+};
+
+
+class SceneBuffers {
+public:
+    SceneBuffers(void);
+    ~SceneBuffers(void);
+
+    // the display managers sharing the buffers
+    void Attach(DisplayManager* displayManager);
+    void Detach(DisplayManager* displayManager);
+    void UpdateViews(void);
+
+    // the model has changed
+    void   Invalidate(void);
+    bool   Valid(void) const;
+    size_t Generation(void) const; // counts the uploads, a view's frame is outdated with a new one
+
+    // collecting the geometry
+    void Clear(void);
+    void Merge(SceneRecording& recording,  // takes the recording's vertices, leaves it empty
+               const Geometry* geometry);  // the owner of the recording's detail groups
+    // the recordings of a wave in their order, the ones waiting for their merge count as staged,
+    // consecutive parts of a geometry own its detail groups together
+    void Merge(std::vector<SceneRecording>&        recordings,
+               const std::vector<const Geometry*>& geometries);
+
+    // the geometries with a detail group whose levels are all too coarse for a visible view
+    std::vector<const Geometry*> CoarseGeometries(void) const;
+
+    // replaces the detail groups of the geometries by the ones of their new recordings,
+    // needs a current context like Upload()
+    void Refine(const std::vector<const Geometry*>& geometries,
+                std::vector<SceneRecording>&       recordings,
+                FrameStatistics&                   statistics);
+
+    // the successors in the model take the detail groups of their geometries over, the vertices stay as recorded
+    void ReplaceOwners(const std::vector<GeometryModel::Replacement>& replacements);
+
+    // the finest level the visible views need, with a margin for zooming in, 0 for the exact geometry
+    float        DetailTolerance(void) const;
+
+    // the coarsest level which looks exact in a projection
+    static float PixelTolerance(const QMatrix4x4& model2Display);
+
+    // needs a current context of the display managers' share group, also for the collecting
+    void Upload(FrameStatistics& statistics);
+    void Draw(const QMatrix4x4& model2Display,
+              const QVector3D&  viewMin,
+              const QVector3D&  viewMax,
+              FrameStatistics&  statistics);
+    void Release(void);
+
+    size_t GpuBytes(void) const;
+
+    // held by a render thread while it draws, and by the GUI thread while it records for it
+    std::mutex& Mutex(void);
+
+private:
+    // a spatially coherent range of a batch's vertices
+    struct Chunk {
+        QVector3D minCorner;
+        QVector3D maxCorner;
+        GLint     first;
+        GLsizei   count;
+    };
+
+    struct Block {
+        QOpenGLBuffer      buffer;
+        GLint              first;     // the batch's vertices before
+        GLsizei            count;
+        std::vector<Chunk> chunks;
+    };
+
+    struct Batch {
+        GLenum             mode;
+        size_t             group;     // 0 if not in a detail group
+        float              tolerance;
+        bool               ordered;   // nested levels, the vertices aren't sorted
+        GLint              flushed;   // the vertices handed to the packing
+        std::vector<Block> blocks;
+        std::vector<float> staging;   // the vertices not yet uploaded: x, y, z (the normal for triangles), the colour
+    };
+
+    typedef std::tuple<GLenum, size_t, float> BatchKey;
+    typedef std::pair<size_t, size_t>         GroupRange; // the offset of a geometry's groups and their number
+
+    std::vector<DisplayManager*>     m_views;
+    std::vector<Batch>               m_batches;
+    std::map<BatchKey, size_t>       m_batchIndices;
+    bool                             m_valid;
+    size_t                           m_generation;
+    std::vector<std::vector<float> > m_groupTolerances; // the levels of the groups 1, 2, ...
+    std::vector<std::vector<size_t> > m_groupCounts;    // the vertices of the nested levels, empty for the other groups
+    std::map<const Geometry*, GroupRange> m_geometryGroups;
+    std::mutex                       m_mutex;
+
+    // a full staging block waiting for its packing
+    struct PendingBlock {
+        size_t             batch;
+        std::vector<float> vertices;
+        Block              block;
+        float*             target;   // the mapped buffer
+    };
+
+    size_t                           m_stagedFloats;    // in all batches
+    std::vector<PendingBlock>        m_pendingBlocks;
+    size_t                           m_uploadedFloats;
+    size_t                           m_copiedFloats;    // every float written on the way to the buffers
+    size_t                           m_peakStagingBytes;
+    size_t                           m_recordingBytes;  // of the recordings waiting for their merge
+
+    size_t BatchIndex(GLenum mode,
+                      size_t group,
+                      float  tolerance);
+    void   AddVertices(size_t       batchIndex,
+                       const float* vertices,
+                       size_t       count);
+    void   MergeBatches(SceneRecording& recording,
+                        size_t          firstGroup);
+    void   UploadStaging(FrameStatistics& statistics); // a new generation, the validity stays
+    void   FlushBlock(size_t batchIndex);
+    void   FlushBlocks(void);
+    void   PackPendingBlocks(void);
+    void   PackBlock(PendingBlock& pendingBlock) const;
+
+    SceneBuffers(const SceneBuffers&);
+    SceneBuffers& operator=(const SceneBuffers&);
+};
+
+
+#endif // SCENEBUFFERS_INCLUDED
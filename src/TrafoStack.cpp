@@ -0,0 +1,277 @@
+/*                      T R A F O S T A C K . C P P
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file TrafoStack.cpp
+ *
+ *  BRL-CAD GUI:
+ *      a stack of transformations with their inverses implementation
+ */
+
+#include <cmath>
+
+#include "TrafoStack.h"
+
+
+TrafoStack::TrafoStack(void) : m_levels(), m_firstDirty(0) {}
+
+
+size_t TrafoStack::Size(void) const {
+    return m_levels.size();
+}
+
+
+void TrafoStack::Clear(void) {
+    m_levels.clear();
+    m_firstDirty = 0;
+}
+
+
+void TrafoStack::Push
+(
+    const QMatrix4x4& trafo
+) {
+    Push(trafo, trafo.inverted());
+}
+
+
+void TrafoStack::Push
+(
+    const QMatrix4x4& trafo,
+    const QMatrix4x4& inverse
+) {
+    Level level;
+
+    level.trafo   = trafo;
+    level.inverse = inverse;
+
+    m_levels.push_back(level);
+    Invalidate(m_levels.size() - 1);
+}
+
+
+void TrafoStack::Pop(void) {
+    if (m_levels.size() > 0) {
+        m_levels.pop_back();
+
+        if (m_firstDirty > m_levels.size())
+            m_firstDirty = m_levels.size();
+    }
+}
+
+
+void TrafoStack::Set
+(
+    size_t            level,
+    const QMatrix4x4& trafo,
+    const QMatrix4x4& inverse
+) {
+    m_levels[level].trafo   = trafo;
+    m_levels[level].inverse = inverse;
+    Invalidate(level);
+}
+
+
+void TrafoStack::SetScale
+(
+    size_t           level,
+    const QVector3D& factors
+) {
+    QMatrix4x4 trafo;
+
+    trafo.scale(factors);
+
+    // an unchanged level keeps the accumulated transformations above it valid
+    if (trafo != m_levels[level].trafo)
+        Set(level, trafo, ScaleInverse(factors));
+}
+
+
+void TrafoStack::Translate
+(
+    size_t           level,
+    const QVector3D& vector
+) {
+    // T^-1 is T(-v) and (A * T)^-1 = T^-1 * A^-1
+    m_levels[level].trafo.translate(vector);
+    m_levels[level].inverse = TranslationInverse(vector) * m_levels[level].inverse;
+    Invalidate(level);
+}
+
+
+void TrafoStack::Scale
+(
+    size_t           level,
+    const QVector3D& center,
+    const QVector3D& factors
+) {
+    QMatrix4x4 scaling;
+    scaling.translate(center);
+    scaling.scale(factors);
+    scaling.translate(-center);
+
+    QMatrix4x4 inverse;
+    inverse.translate(center);
+    inverse *= ScaleInverse(factors);
+    inverse.translate(-center);
+
+    m_levels[level].trafo   *= scaling;
+    m_levels[level].inverse  = inverse * m_levels[level].inverse;
+    Invalidate(level);
+}
+
+
+void TrafoStack::PreMultiply
+(
+    size_t            level,
+    const QMatrix4x4& trafo,
+    const QMatrix4x4& inverse
+) {
+    m_levels[level].trafo   = trafo * m_levels[level].trafo;
+    m_levels[level].inverse = m_levels[level].inverse * inverse;
+    Invalidate(level);
+}
+
+
+const QMatrix4x4& TrafoStack::Forward
+(
+    size_t level
+) const {
+    Compose(level);
+
+    return m_levels[level].forward;
+}
+
+
+const QMatrix4x4& TrafoStack::Inverse
+(
+    size_t level
+) const {
+    Compose(level);
+
+    return m_levels[level].backward;
+}
+
+
+const QMatrix4x4& TrafoStack::Top(void) const {
+    return Forward(m_levels.size() - 1);
+}
+
+
+const QMatrix4x4& TrafoStack::TopInverse(void) const {
+    return Inverse(m_levels.size() - 1);
+}
+
+
+QMatrix4x4 TrafoStack::Map
+(
+    size_t from,
+    size_t to
+) const {
+    QMatrix4x4 ret;
+
+    if (from > to) {
+        // the product of the local transformations is cheaper than the accumulated ones
+        for (size_t i = to + 1; i <= from; ++i)
+            ret *= m_levels[i].trafo;
+    }
+    else if (from < to) {
+        for (size_t i = to; i > from; --i)
+            ret *= m_levels[i].inverse;
+    }
+
+    return ret;
+}
+
+
+QMatrix4x4 TrafoStack::TranslationInverse
+(
+    const QVector3D& vector
+) {
+    QMatrix4x4 ret;
+
+    ret.translate(-vector);
+
+    return ret;
+}
+
+
+QMatrix4x4 TrafoStack::ScaleInverse
+(
+    const QVector3D& factors
+) {
+    QMatrix4x4 ret;
+
+    if ((factors.x() != 0.f) && (factors.y() != 0.f) && (factors.z() != 0.f))
+        ret.scale(1.f / factors.x(), 1.f / factors.y(), 1.f / factors.z());
+    else {
+        ret.scale(factors);
+        ret = ret.inverted();
+    }
+
+    return ret;
+}
+
+
+QMatrix4x4 TrafoStack::RigidInverse
+(
+    const QMatrix4x4& trafo
+) {
+    // for R * T: (R * T)^-1 = R^T * (-R^T * t)
+    QMatrix4x4 ret;
+
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column)
+            ret(row, column) = trafo(column, row);
+    }
+
+    for (int row = 0; row < 3; ++row) {
+        float translation = 0.f;
+
+        for (int column = 0; column < 3; ++column)
+            translation -= ret(row, column) * trafo(column, 3);
+
+        ret(row, 3) = translation;
+    }
+
+    return ret;
+}
+
+
+void TrafoStack::Invalidate
+(
+    size_t level
+) {
+    if (level < m_firstDirty)
+        m_firstDirty = level;
+}
+
+
+void TrafoStack::Compose
+(
+    size_t level
+) const {
+    for (; m_firstDirty <= level; ++m_firstDirty) {
+        Level& current = m_levels[m_firstDirty];
+
+        if (m_firstDirty > 0) {
+            const Level& below = m_levels[m_firstDirty - 1];
+
+            current.forward  = below.forward * current.trafo;
+            current.backward = current.inverse * below.backward;
+        }
+        else {
+            current.forward  = current.trafo;
+            current.backward = current.inverse;
+        }
+    }
+}
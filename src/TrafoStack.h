@@ -0,0 +1,96 @@
+/*                        T R A F O S T A C K . H
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** @file TrafoStack.h
+ *
+ *  BRL-CAD GUI:
+ *      a stack of transformations with their inverses declaration
+ *
+ *  Every level holds its local transformation together with the inverse.
+ *  The accumulated transformations are composed lazily when requested, the
+ *  inverses are maintained analytically and never computed by inversion.
+ *
+ *  The const accessors write the composed transformations into a cache, i.e.
+ *  a stack must not be shared between threads, not even for reading.  The
+ *  display managers use theirs on the GUI thread only and hand copies of the
+ *  matrices to the render thread.
+ */
+
+#ifndef TRAFOSTACK_INCLUDED
+#define TRAFOSTACK_INCLUDED
+
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+
+class TrafoStack {
+public:
+    TrafoStack(void);
+
+    size_t            Size(void) const;
+    void              Clear(void);
+
+    void              Push(const QMatrix4x4& trafo);
+    void              Push(const QMatrix4x4& trafo,
+                           const QMatrix4x4& inverse);
+    void              Pop(void);
+
+    // modify the local transformation of a level
+    void              Set(size_t            level,
+                          const QMatrix4x4& trafo,
+                          const QMatrix4x4& inverse);
+    void              SetScale(size_t           level,
+                               const QVector3D& factors);
+    void              Translate(size_t           level,
+                                const QVector3D& vector);
+    void              Scale(size_t           level,
+                            const QVector3D& center,
+                            const QVector3D& factors);
+    void              PreMultiply(size_t            level,
+                                  const QMatrix4x4& trafo,
+                                  const QMatrix4x4& inverse);
+
+    // the accumulated transformations from the coordinates of a level into the device coordinates and back
+    const QMatrix4x4& Forward(size_t level) const;
+    const QMatrix4x4& Inverse(size_t level) const;
+    const QMatrix4x4& Top(void) const;
+    const QMatrix4x4& TopInverse(void) const;
+
+    // from the coordinates of one level into the coordinates of another one
+    QMatrix4x4        Map(size_t from,
+                          size_t to) const;
+
+    // analytic inverses of the elementary transformations
+    static QMatrix4x4 TranslationInverse(const QVector3D& vector);
+    static QMatrix4x4 ScaleInverse(const QVector3D& factors);
+    static QMatrix4x4 RigidInverse(const QMatrix4x4& trafo);
+
+private:
+    struct Level {
+        QMatrix4x4 trafo;
+        QMatrix4x4 inverse;
+        QMatrix4x4 forward;  // accumulated, valid below m_firstDirty
+        QMatrix4x4 backward; // accumulated inverse, valid below m_firstDirty
+    };
+
+    mutable std::vector<Level> m_levels;
+    mutable size_t             m_firstDirty;
+
+    void Invalidate(size_t level);
+    void Compose(size_t level) const;
+};
+
+
+#endif // TRAFOSTACK_INCLUDED
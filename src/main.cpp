@@ -18,19 +18,162 @@
  */
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QTextStream>
 
+#include "BatchExport.h"
 #include "MainWindow.h"
+#include "PerformanceGate.h"
+
+
+const size_t BenchmarkFrames  = 20;
+const int    BenchmarkSkipped = 77; // the exit code if there is no baseline, CTest counts the gate as skipped
 
 
 int main(int argc, char *argv[])
 {
-    QApplication application(argc, argv);
-    char*        file = 0;
+    // the display managers share their geometry buffers
+    QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
+    QApplication       application(argc, argv);
+    QCommandLineParser parser;
+    QCommandLineOption exportOption("export", "Renders the objects into PNG files instead of opening a window.");
+    QCommandLineOption objectsOption("objects", "The objects to export, separated by commas (default: all top objects).", "names");
+    QCommandLineOption viewsOption("views", "The views to export: top, side, front and iso, separated by commas.", "views", "top,side,front,iso");
+    QCommandLineOption sizeOption("size", "The size of the images.", "widthxheight", "800x600");
+    QCommandLineOption outputOption("output", "The directory for the images.", "directory", ".");
+    QCommandLineOption reportOption("report", "Writes the timings and the memory usage of the export into a JSON file.", "file");
+    QCommandLineOption renderThreadOption("render-thread", "Draws the views on a thread of their own, the window stays responsive with large models.");
+    QCommandLineOption plotOption("plot", "Shows a UNIX-plot (plot3) file, may be given more than once.", "file");
+    QCommandLineOption budgetOption("memory-budget", "The main memory the plots may use before they are released, in MiB.", "megabytes");
+    QCommandLineOption benchmarkOption("benchmark", "Times loading, tree building, plotting and drawing of the whole database, writes them into a JSON file.", "file");
+    QCommandLineOption baselineOption("baseline", "Fails the benchmark if a step is slower than in this JSON file.", "file");
+    QCommandLineOption toleranceOption("tolerance", "The slowdown the baseline allows, relative.", "ratio", "0.25");
+
+    parser.setApplicationDescription("BRL-CAD GUI");
+    parser.addHelpOption();
+    parser.addOption(exportOption);
+    parser.addOption(objectsOption);
+    parser.addOption(viewsOption);
+    parser.addOption(sizeOption);
+    parser.addOption(outputOption);
+    parser.addOption(reportOption);
+    parser.addOption(plotOption);
+    parser.addOption(renderThreadOption);
+    parser.addOption(budgetOption);
+    parser.addOption(benchmarkOption);
+    parser.addOption(baselineOption);
+    parser.addOption(toleranceOption);
+    parser.addPositionalArgument("file", "The BRL-CAD .g database file to open.");
+    parser.process(application);
+
+    QStringList arguments = parser.positionalArguments();
+
+    if (parser.isSet(exportOption)) {
+        QTextStream                    err(stderr);
+        std::vector<BatchExport::View> views;
+        QStringList                    viewNames = parser.value(viewsOption).split(",");
+        QStringList                    size      = parser.value(sizeOption).split("x");
+        QStringList                    objects;
+
+        if (arguments.isEmpty()) {
+            err << "The export needs a database file\n";
+            return 1;
+        }
+
+        for (QStringList::const_iterator it = viewNames.begin(); it != viewNames.end(); ++it) {
+            BatchExport::View view;
+
+            if (!BatchExport::ParseView(*it, view)) {
+                err << "Unknown view " << *it << "\n";
+                return 1;
+            }
+
+            views.push_back(view);
+        }
+
+        if ((size.size() != 2) || (size[0].toInt() <= 0) || (size[1].toInt() <= 0)) {
+            err << "Invalid image size " << parser.value(sizeOption) << "\n";
+            return 1;
+        }
+
+        if (parser.isSet(objectsOption))
+            objects = parser.value(objectsOption).split(",");
+
+        BatchExport batchExport(arguments[0], objects, views, QSize(size[0].toInt(), size[1].toInt()), parser.value(outputOption));
+
+        if (parser.isSet(reportOption))
+            batchExport.SetReportFile(parser.value(reportOption));
+
+        return batchExport.Run();
+    }
+
+    QByteArray file;
+
+    if (!arguments.isEmpty())
+        file = arguments[0].toUtf8();
+
+    if (parser.isSet(benchmarkOption)) {
+        QTextStream out(stdout);
+        QTextStream err(stderr);
+
+        if (file.isEmpty()) {
+            err << "The benchmark needs a database file\n";
+            return 1;
+        }
+
+        MainWindow  mainWindow(0);
+        QJsonObject report = mainWindow.Benchmark(file.data(), BenchmarkFrames);
+
+        if (report.isEmpty()) {
+            err << "Can't load " << arguments[0] << "\n";
+            return 1;
+        }
+
+        if (!PerformanceGate::WriteJson(parser.value(benchmarkOption), report)) {
+            err << "Can't write " << parser.value(benchmarkOption) << "\n";
+            return 1;
+        }
+
+        if (parser.isSet(baselineOption)) {
+            // the report above is the baseline to be stored
+            if (!QFileInfo::exists(parser.value(baselineOption))) {
+                out << "No baseline " << parser.value(baselineOption) << ", the benchmark isn't checked\n";
+                return BenchmarkSkipped;
+            }
+
+            QJsonObject baseline = PerformanceGate::ReadJson(parser.value(baselineOption));
+
+            if (baseline.isEmpty()) {
+                err << "Can't read " << parser.value(baselineOption) << "\n";
+                return 1;
+            }
+
+            PerformanceGate gate(baseline, parser.value(toleranceOption).toDouble());
+
+            out << "Benchmark of " << arguments[0] << " against " << parser.value(baselineOption) << ":\n";
+
+            if (!gate.Check(report, out))
+                return 1;
+        }
+
+        return 0;
+    }
+
+    MainWindow mainWindow(file.isEmpty() ? 0 : file.data());
+
+    if (parser.isSet(budgetOption))
+        mainWindow.SetMemoryBudget(parser.value(budgetOption).toUInt());
+
+    if (parser.isSet(renderThreadOption))
+        mainWindow.SetRenderThread(true);
+
+    QStringList plots = parser.values(plotOption);
 
-    if (argc > 1)
-        file = argv[1];
+    for (QStringList::const_iterator it = plots.begin(); it != plots.end(); ++it)
+        mainWindow.ImportPlot(*it);
 
-    MainWindow mainWindow(file);
     mainWindow.show();
 
     return application.exec();